@@ -0,0 +1,207 @@
+
+// IDA utility support: Double buffered asynchronous file writer
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <AsyncFileWriter.h>
+
+// Buffers are page aligned for the OS copy
+static const size_t BUFFER_ALIGN = 4096;
+
+
+AsyncFileWriter::AsyncFileWriter() : m_fp(NULL), m_bufferSize(0), m_fill(0), m_pending(-1), m_quit(FALSE), m_error(FALSE), m_stats(), m_openTime(0)
+{
+	m_buffer[0] = m_buffer[1] = NULL;
+	m_used[0] = m_used[1] = 0;
+}
+
+BOOL AsyncFileWriter::open(LPCSTR path, size_t bufferSize)
+{
+	close();
+
+	bufferSize = ((max(bufferSize, BUFFER_ALIGN) + (BUFFER_ALIGN - 1)) & ~(BUFFER_ALIGN - 1));
+	m_buffer[0] = (BYTE *) _aligned_malloc(bufferSize, BUFFER_ALIGN);
+	m_buffer[1] = (BYTE *) _aligned_malloc(bufferSize, BUFFER_ALIGN);
+	if (m_buffer[0] && m_buffer[1])
+	{
+		if ((m_fp = fopen(path, "wb")))
+		{
+			// We only ever write whole buffers
+			setvbuf(m_fp, NULL, _IONBF, 0);
+
+			m_bufferSize = bufferSize;
+			m_used[0] = m_used[1] = 0;
+			m_fill = 0, m_pending = -1;
+			m_quit = FALSE;
+			m_error = FALSE;
+			m_stats = {};
+			m_openTime = GetTimeStamp();
+			m_thread = std::thread(&AsyncFileWriter::writerThread, this);
+			return TRUE;
+		}
+	}
+
+	close();
+	return FALSE;
+}
+
+void AsyncFileWriter::writerThread()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	for (;;)
+	{
+		m_signal.wait(lock, [this] { return ((m_pending != -1) || m_quit); });
+		if (m_pending == -1)
+			break;
+
+		// Write outside the lock so the producer can keep filling
+		int index = m_pending;
+		size_t size = m_used[index];
+		lock.unlock();
+		BOOL ok = (fwrite(m_buffer[index], 1, size, m_fp) == size);
+		lock.lock();
+
+		if (!ok)
+			m_error = TRUE;
+		m_stats.bytes += size;
+		m_stats.writes++;
+		m_used[index] = 0;
+		m_pending = -1;
+		m_signal.notify_all();
+	}
+}
+
+// Hand the fill buffer to the writer thread and switch to the other, waiting while it's still being written
+void AsyncFileWriter::submit()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	if (m_pending != -1)
+	{
+		TIMESTAMP start = GetTimeStamp();
+		m_signal.wait(lock, [this] { return (m_pending == -1); });
+		m_stats.stallTime += (GetTimeStamp() - start);
+	}
+	m_pending = m_fill;
+	m_fill ^= 1;
+	m_signal.notify_all();
+}
+
+BOOL AsyncFileWriter::write(LPCVOID data, size_t size)
+{
+	if (!m_fp || m_error)
+		return FALSE;
+
+	const BYTE *src = (const BYTE *) data;
+	while (size)
+	{
+		size_t room = (m_bufferSize - m_used[m_fill]);
+		size_t copy = min(size, room);
+		memcpy(m_buffer[m_fill] + m_used[m_fill], src, copy);
+		m_used[m_fill] += copy;
+		src += copy, size -= copy;
+
+		if (m_used[m_fill] == m_bufferSize)
+			submit();
+	}
+	return !m_error;
+}
+
+BOOL AsyncFileWriter::print(LPCSTR format, ...)
+{
+	if (!m_fp || m_error)
+		return FALSE;
+
+	va_list vl;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		// Format straight into the fill buffer when it fits
+		size_t room = (m_bufferSize - m_used[m_fill]);
+		va_start(vl, format);
+		int length = vsnprintf((LPSTR) m_buffer[m_fill] + m_used[m_fill], room, format, vl);
+		va_end(vl);
+		if (length < 0)
+			return FALSE;
+		if ((size_t) length < room)
+		{
+			m_used[m_fill] += length;
+			return TRUE;
+		}
+
+		// Else start a fresh buffer, where it fits on the second pass, or for text larger than a buffer format on the heap
+		if ((size_t) length >= m_bufferSize)
+		{
+			LPSTR text = (LPSTR) malloc(length + 1);
+			if (!text)
+				return FALSE;
+			va_start(vl, format);
+			vsnprintf(text, (length + 1), format, vl);
+			va_end(vl);
+			BOOL result = write(text, length);
+			free(text);
+			return result;
+		}
+		if (m_used[m_fill])
+			submit();
+	}
+	return !m_error;
+}
+
+BOOL AsyncFileWriter::close(__out_opt STATS *stats, BOOL report)
+{
+	BOOL result = !m_error;
+	if (m_fp)
+	{
+		if (m_used[m_fill])
+			submit();
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_quit = TRUE;
+			m_signal.notify_all();
+		}
+		m_thread.join();
+
+		if (fclose(m_fp) != 0)
+			m_error = TRUE;
+		m_fp = NULL;
+		result = !m_error;
+		m_stats.time = (GetTimeStamp() - m_openTime);
+
+		if (report)
+		{
+			char sizeStr[32], timeStr[64], rateStr[32], stallStr[64];
+			strcpy_s(sizeStr, sizeof(sizeStr), byteSizeString(m_stats.bytes));
+			strcpy_s(timeStr, sizeof(timeStr), TimeString(m_stats.time));
+			strcpy_s(rateStr, sizeof(rateStr), byteSizeString((UINT64) ((TIMESTAMP) m_stats.bytes / max(m_stats.time, (TIMESTAMP) 0.000001))));
+			strcpy_s(stallStr, sizeof(stallStr), TimeString(m_stats.stallTime));
+			msg("AsyncFileWriter: Wrote %s in %s, %s/s, producer stalled %s.%s\n", sizeStr, timeStr, rateStr, stallStr, (result ? "" : " ** Write error **"));
+		}
+	}
+	if (stats)
+		*stats = m_stats;
+
+	if (m_buffer[0])
+		_aligned_free(m_buffer[0]);
+	if (m_buffer[1])
+		_aligned_free(m_buffer[1]);
+	m_buffer[0] = m_buffer[1] = NULL;
+	return result;
+}
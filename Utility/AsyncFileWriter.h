@@ -0,0 +1,62 @@
+
+// IDA utility support: Double buffered asynchronous file writer
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Buffered file writer that moves disk I/O off the calling thread.
+// The producer formats into one large aligned buffer while a background thread writes the other; when both are full
+// write() waits for the writer thread (backpressure). Each full buffer goes out as a single unbuffered write.
+// One producer thread only.
+class AsyncFileWriter
+{
+public:
+	struct STATS
+	{
+		UINT64 bytes;			// Bytes written
+		UINT32 writes;			// Buffer writes
+		TIMESTAMP time;			// Open to close time
+		TIMESTAMP stallTime;	// Time the producer waited on the disk
+	};
+
+	AsyncFileWriter();
+	~AsyncFileWriter() { close(); }
+
+	// Create/truncate file and start the writer thread
+	BOOL open(LPCSTR path, size_t bufferSize = (4 * 1024 * 1024));
+
+	// Append data, returns FALSE if not open or a write failed
+	BOOL write(LPCVOID data, size_t size);
+	BOOL write(LPCSTR str) { return write(str, strlen(str)); }
+
+	// Append printf style formatted text
+	BOOL print(LPCSTR format, ...);
+
+	// Flush remaining data, stop the writer thread and close the file.
+	// Returns FALSE if any write failed. Optionally print a throughput report.
+	BOOL close(__out_opt STATS *stats = NULL, BOOL report = FALSE);
+
+	BOOL isOpen() { return (m_fp != NULL); }
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(AsyncFileWriter);
+
+	void submit();
+	void writerThread();
+
+	FILE *m_fp;
+	BYTE *m_buffer[2];
+	size_t m_bufferSize, m_used[2];
+	int m_fill;			// Buffer being filled
+	int m_pending;		// Buffer handed to the writer thread, or -1
+	BOOL m_quit;
+	std::atomic<BOOL> m_error;	// Set by the writer thread, read by the producer
+	std::thread m_thread;
+	std::mutex m_lock;
+	std::condition_variable m_signal;
+	STATS m_stats;
+	TIMESTAMP m_openTime;
+};
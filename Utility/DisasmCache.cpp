@@ -0,0 +1,314 @@
+
+// IDA utility support: Disassembly text line cache
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <idp.hpp>
+#include <bytes.hpp>
+#include <funcs.hpp>
+#include <lines.hpp>
+#include <xref.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <DisasmCache.h>
+
+// Slot text capacity; most lines fit, longer ones go to the heap
+static const UINT32 INLINE_TEXT = (128 - (sizeof(ea_t) + sizeof(UINT32) + sizeof(UINT32)));
+// Ranges larger than this are invalidated by a scan of all slots instead of per address lookups
+static const asize_t RANGE_SCAN = 4096;
+
+struct SLOT
+{
+	ea_t ea;			// BADADDR when free
+	UINT32 length;
+	UINT32 ref;			// CLOCK referenced bit
+	union
+	{
+		char text[INLINE_TEXT];
+		LPSTR heapText;	// When length >= INLINE_TEXT
+	};
+};
+static_assert(sizeof(SLOT) == 128, "SLOT size");
+
+static SLOT *slots = NULL;
+static UINT32 slotCount = 0, slotsUsed = 0, clockHand = 0;
+static EaHashMap<UINT32> *lineIndex = NULL;
+static DisasmCache::STATS stats = {};
+static MemTrack::TAG memTag = MemTrack::UNTAGGED;
+
+static void freeSlot(UINT32 i)
+{
+	SLOT &s = slots[i];
+	if (s.length >= INLINE_TEXT)
+	{
+		free(s.heapText);
+		MemTrack::onFree(memTag, s.length);
+	}
+	s.ea = BADADDR;
+	s.length = s.ref = 0;
+}
+
+// Get a slot for a new line, evicting by CLOCK order when full
+static UINT32 allocSlot()
+{
+	if (slotsUsed < slotCount)
+		return slotsUsed++;
+
+	for (;;)
+	{
+		UINT32 i = clockHand;
+		clockHand = ((clockHand + 1) % slotCount);
+
+		SLOT &s = slots[i];
+		if (s.ea == BADADDR)
+			return i;
+		if (s.ref)
+			s.ref = 0;
+		else
+		{
+			lineIndex->erase(s.ea);
+			freeSlot(i);
+			stats.evictions++;
+			return i;
+		}
+	}
+}
+
+// Cached getDisasmText() line source
+static void getCachedText(ea_t ea, __out qstring &s)
+{
+	if (UINT32 *i = lineIndex->find(ea))
+	{
+		SLOT &slot = slots[*i];
+		slot.ref = 1;
+		s.resize(slot.length);
+		memcpy(s.begin(), ((slot.length >= INLINE_TEXT) ? slot.heapText : slot.text), slot.length);
+		stats.hits++;
+		return;
+	}
+
+	idbAccess->getDisasmLine(ea, s);
+	stats.misses++;
+
+	UINT32 i = allocSlot();
+	SLOT &slot = slots[i];
+	UINT32 length = (UINT32) s.length();
+	if (length >= INLINE_TEXT)
+	{
+		if (!(slot.heapText = (LPSTR) malloc(length)))
+		{
+			slot.ea = BADADDR;
+			slot.length = slot.ref = 0;
+			return;
+		}
+		MemTrack::onAlloc(memTag, length);
+		memcpy(slot.heapText, s.c_str(), length);
+	}
+	else
+		memcpy(slot.text, s.c_str(), length);
+	slot.ea = ea;
+	slot.length = length;
+	slot.ref = 1;
+	lineIndex->insert(ea, i);
+}
+
+static void invalidateRange(ea_t start, ea_t end)
+{
+	if ((end - start) <= RANGE_SCAN)
+	{
+		for (ea_t ea = start; ea < end; ea++)
+			DisasmCache::invalidate(ea);
+	}
+	else
+	{
+		for (UINT32 i = 0; i < slotsUsed; i++)
+		{
+			if ((slots[i].ea >= start) && (slots[i].ea < end))
+				DisasmCache::invalidate(slots[i].ea);
+		}
+	}
+}
+
+// Lines that show the name of a renamed address
+static void invalidateReferences(ea_t ea)
+{
+	DisasmCache::invalidate(ea);
+	xrefblk_t xb;
+	for (bool ok = xb.first_to(ea, XREF_ALL); ok; ok = xb.next_to())
+		DisasmCache::invalidate(xb.from);
+}
+
+// Lines of a function, I.E. operands showing its stack variable names
+static void invalidateFunction(ea_t ea)
+{
+	if (func_t *f = get_func(ea))
+	{
+		func_tail_iterator_t fti(f);
+		for (bool ok = fti.first(); ok; ok = fti.next())
+			invalidateRange(fti.chunk().start_ea, fti.chunk().end_ea);
+	}
+}
+
+// IDB change events that can change the text of lines
+struct idb_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case idb_event::byte_patched:
+			{
+				ea_t ea = va_arg(va, ea_t);
+				DisasmCache::invalidate(get_item_head(ea));
+			}
+			break;
+
+			case idb_event::op_type_changed:
+			case idb_event::ti_changed:
+			case idb_event::cmt_changed:
+			case idb_event::extra_cmt_changed:
+			case idb_event::make_data:
+			case idb_event::op_ti_changed:
+			DisasmCache::invalidate(va_arg(va, ea_t));
+			break;
+
+			case idb_event::make_code:
+			DisasmCache::invalidate(va_arg(va, const insn_t *)->ea);
+			break;
+
+			case idb_event::renamed:
+			invalidateReferences(va_arg(va, ea_t));
+			break;
+
+			// Stack variables, shown in the operands of their function
+			case idb_event::frame_udm_created:
+			case idb_event::frame_udm_deleted:
+			case idb_event::frame_udm_renamed:
+			case idb_event::frame_udm_changed:
+			invalidateFunction(va_arg(va, ea_t));
+			break;
+
+			case idb_event::destroyed_items:
+			{
+				ea_t ea1 = va_arg(va, ea_t);
+				ea_t ea2 = va_arg(va, ea_t);
+				invalidateRange(ea1, ea2);
+			}
+			break;
+
+			// Changes that can touch any line
+			case idb_event::segm_added:
+			case idb_event::segm_deleted:
+			case idb_event::segm_moved:
+			case idb_event::allsegs_moved:
+			case idb_event::local_types_changed:
+			case idb_event::lt_udm_renamed:
+			case idb_event::lt_edm_renamed:
+			case idb_event::closebase:
+			DisasmCache::flush();
+			break;
+		};
+		return 0;
+	}
+} static idbListener;
+
+
+BOOL DisasmCache::start(UINT32 maxLines)
+{
+	stop();
+	if (!maxLines)
+		return FALSE;
+
+	if (!(slots = (SLOT *) _aligned_malloc((sizeof(SLOT) * maxLines), 64)))
+		return FALSE;
+	memTag = MemTrack::registerTag("DisasmCache");
+	MemTrack::onAlloc(memTag, (sizeof(SLOT) * maxLines));
+	slotCount = maxLines;
+	slotsUsed = clockHand = 0;
+	lineIndex = new EaHashMap<UINT32>(maxLines, memTag);
+	stats = {};
+
+	hook_event_listener(HT_IDB, &idbListener);
+	getDisasmTextHook = getCachedText;
+	return TRUE;
+}
+
+void DisasmCache::stop()
+{
+	if (slots)
+	{
+		getDisasmTextHook = NULL;
+		unhook_event_listener(HT_IDB, &idbListener);
+
+		flush();
+		_aligned_free(slots);
+		MemTrack::onFree(memTag, (sizeof(SLOT) * slotCount));
+		slots = NULL;
+		delete lineIndex;
+		lineIndex = NULL;
+		slotCount = 0;
+	}
+}
+
+BOOL DisasmCache::isStarted() { return (slots != NULL); }
+
+void DisasmCache::invalidate(ea_t ea)
+{
+	if (slots)
+	{
+		if (UINT32 *i = lineIndex->find(ea))
+		{
+			freeSlot(*i);
+			lineIndex->erase(ea);
+			stats.invalidations++;
+		}
+	}
+}
+
+void DisasmCache::flush()
+{
+	if (slots)
+	{
+		for (UINT32 i = 0; i < slotsUsed; i++)
+			freeSlot(i);
+		slotsUsed = clockHand = 0;
+		lineIndex->clear();
+	}
+}
+
+void DisasmCache::getStats(__out STATS &statsOut) { statsOut = stats; }
+
+
+size_t getDisasmRange(ea_t start, ea_t end, __out qstrvec_t &lines, __out_opt eavec_t *addresses)
+{
+	lines.clear();
+	if (addresses)
+		addresses->clear();
+
+	// Heads through idbAccess, so it works on a stand-in backend too
+	ea_t ea = ((start < end) ? start : BADADDR);
+	if ((ea != BADADDR) && !is_head(idbAccess->getFlags(ea)))
+		ea = idbAccess->nextHead(ea, end);
+	for (; ea != BADADDR; ea = idbAccess->nextHead(ea, end))
+	{
+		getDisasmText(ea, lines.push_back());
+		if (addresses)
+			addresses->push_back(ea);
+	}
+	return lines.size();
+}
@@ -0,0 +1,37 @@
+
+// IDA utility support: Disassembly text line cache
+#pragma once
+
+// Bounded cache of getDisasmText() lines, keyed by address.
+// Lines live in one preallocated block of fixed size slots (long lines spill to the heap) and are replaced in CLOCK
+// order when full. Entries are invalidated through IDB change events: patches, operand type, type info and comment
+// changes, item creation/deletion, renames (including the lines that reference the renamed address), stack variable
+// changes (the lines of their function) and struct/enum member renames (all lines).
+// While started, getDisasmText() and getDisasmRange() go through the cache. Main thread only like the IDA API.
+namespace DisasmCache
+{
+	struct STATS
+	{
+		UINT64 hits;
+		UINT64 misses;
+		UINT64 evictions;
+		UINT64 invalidations;
+	};
+
+	// Start caching up to 'maxLines' lines. Returns FALSE on allocation failure.
+	BOOL start(UINT32 maxLines = (256 * 1024));
+
+	// Stop caching and free. Must be called before the plugin unloads.
+	void stop();
+
+	BOOL isStarted();
+
+	// Drop cached line for address, or all lines
+	void invalidate(ea_t ea);
+	void flush();
+
+	void getStats(__out STATS &stats);
+};
+
+// Get the lines for every head in range [start, end), with optional matching addresses
+size_t getDisasmRange(ea_t start, ea_t end, __out qstrvec_t &lines, __out_opt eavec_t *addresses = NULL);
@@ -0,0 +1,717 @@
+
+// IDA utility support: Compressed address bitmap
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+#include <algorithm>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <EaBitmap.h>
+
+// Run containers convert to bitmaps past this count, the point where both are 8KB
+static const UINT32 RUN_MAX = 2048;
+static const UINT32 FULL = 0x10000;
+
+
+// Set bits [start, end] inclusive
+static void setBitRange(UINT64 *bitmap, UINT32 start, UINT32 end)
+{
+	UINT32 firstWord = (start >> 6), lastWord = (end >> 6);
+	UINT64 firstMask = (~0ull << (start & 63)), lastMask = (~0ull >> (63 - (end & 63)));
+	if (firstWord == lastWord)
+		bitmap[firstWord] |= (firstMask & lastMask);
+	else
+	{
+		bitmap[firstWord] |= firstMask;
+		for (UINT32 w = (firstWord + 1); w < lastWord; w++)
+			bitmap[w] = ~0ull;
+		bitmap[lastWord] |= lastMask;
+	}
+}
+
+static UINT32 bitmapCount(const UINT64 *bitmap)
+{
+	UINT64 count = 0;
+	for (UINT32 w = 0; w < (FULL / 64); w++)
+		count += __popcnt64(bitmap[w]);
+	return (UINT32) count;
+}
+
+// Find next bit index from 'from' that is set or clear, returns FULL if none
+UINT32 EaBitmap::nextBit(const UINT64 *bitmap, UINT32 from, BOOL set)
+{
+	UINT32 w = (from >> 6);
+	UINT64 word = ((set ? bitmap[w] : ~bitmap[w]) & (~0ull << (from & 63)));
+	for (;;)
+	{
+		if (word)
+		{
+			unsigned long bit;
+			_BitScanForward64(&bit, word);
+			return ((w << 6) + bit);
+		}
+		if (++w >= BITMAP_WORDS)
+			return FULL;
+		word = (set ? bitmap[w] : ~bitmap[w]);
+	}
+}
+
+// Count of runs in a bitmap, the number of set bits with a clear bit below them
+UINT32 EaBitmap::bitmapRuns(const UINT64 *bitmap)
+{
+	UINT64 runs = 0, carry = 0;
+	for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+	{
+		UINT64 word = bitmap[w];
+		runs += __popcnt64(word & ~((word << 1) | carry));
+		carry = (word >> 63);
+	}
+	return (UINT32) runs;
+}
+
+// ----------------------------------------------------------------------------
+
+void EaBitmap::freeContainer(CONTAINER &c)
+{
+	if (c.type == TYPE_BITMAP)
+		_aligned_free(c.bitmap);
+	else
+	if (c.array)
+		free(c.array);
+	c.array = NULL;
+	c.count = c.capacity = c.cardinality = 0;
+}
+
+// Ensure array or run container room for 'count' elements
+void EaBitmap::reserve(CONTAINER &c, UINT32 count)
+{
+	if (count > c.capacity)
+	{
+		UINT32 capacity = max((c.capacity * 2), max(count, 4u));
+		size_t elementSize = ((c.type == TYPE_ARRAY) ? sizeof(UINT16) : sizeof(RUN));
+		PVOID data = realloc(c.array, (capacity * elementSize));
+		if (!data)
+			throw std::bad_alloc();
+		c.array = (UINT16 *) data;
+		c.capacity = capacity;
+	}
+}
+
+// Expand any container type to a bitmap
+void EaBitmap::bitmapOf(const CONTAINER &c, __out UINT64 *bitmap)
+{
+	if (c.type == TYPE_BITMAP)
+		memcpy(bitmap, c.bitmap, (BITMAP_WORDS * sizeof(UINT64)));
+	else
+	{
+		memset(bitmap, 0, (BITMAP_WORDS * sizeof(UINT64)));
+		if (c.type == TYPE_ARRAY)
+		{
+			for (UINT32 i = 0; i < c.count; i++)
+				bitmap[c.array[i] >> 6] |= (1ull << (c.array[i] & 63));
+		}
+		else
+		{
+			for (UINT32 i = 0; i < c.count; i++)
+				setBitRange(bitmap, c.runs[i].start, (c.runs[i].start + c.runs[i].length));
+		}
+	}
+}
+
+// Dense bitmaps that became sparse go back to arrays
+void EaBitmap::normalize(CONTAINER &c)
+{
+	if ((c.type == TYPE_BITMAP) && (c.cardinality <= ARRAY_MAX))
+	{
+		UINT16 *array = (UINT16 *) malloc(max(c.cardinality, 1u) * sizeof(UINT16));
+		if (!array)
+			throw std::bad_alloc();
+
+		UINT32 count = 0;
+		for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+		{
+			UINT64 bits = c.bitmap[w];
+			while (bits)
+			{
+				unsigned long bit;
+				_BitScanForward64(&bit, bits);
+				array[count++] = (UINT16) ((w << 6) + bit);
+				bits &= (bits - 1);
+			}
+		}
+		_aligned_free(c.bitmap);
+		c.array = array;
+		c.type = TYPE_ARRAY;
+		c.count = c.capacity = count;
+	}
+}
+
+// Runs of a bitmap, 'runs' sized from bitmapRuns()
+void EaBitmap::runsOf(const UINT64 *bitmap, __out RUN *runs)
+{
+	UINT32 count = 0;
+	for (UINT32 v = 0; v < FULL;)
+	{
+		UINT32 start = nextBit(bitmap, v, TRUE);
+		if (start >= FULL)
+			break;
+		v = nextBit(bitmap, start, FALSE);
+		runs[count].start = (UINT16) start;
+		runs[count].length = (UINT16) ((v - start) - 1);
+		count++;
+	}
+}
+
+// Replace the container contents with a bitmap's, in the smallest encoding by cardinality and run count
+void EaBitmap::setFromBitmap(CONTAINER &c, const UINT64 *bitmap)
+{
+	UINT32 cardinality = bitmapCount(bitmap), runs = bitmapRuns(bitmap);
+	size_t arraySize = ((cardinality <= ARRAY_MAX) ? (cardinality * sizeof(UINT16)) : SIZE_MAX);
+	size_t runSize = ((runs <= RUN_MAX) ? (runs * sizeof(RUN)) : SIZE_MAX);
+	size_t bitmapSize = (BITMAP_WORDS * sizeof(UINT64));
+
+	CONTAINER r = {};
+	r.key = c.key;
+	r.cardinality = cardinality;
+	if ((arraySize <= runSize) && (arraySize <= bitmapSize))
+	{
+		if (!(r.array = (UINT16 *) malloc(max(cardinality, 1u) * sizeof(UINT16))))
+			throw std::bad_alloc();
+		UINT32 count = 0;
+		for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+		{
+			UINT64 bits = bitmap[w];
+			while (bits)
+			{
+				unsigned long bit;
+				_BitScanForward64(&bit, bits);
+				r.array[count++] = (UINT16) ((w << 6) + bit);
+				bits &= (bits - 1);
+			}
+		}
+		r.type = TYPE_ARRAY;
+		r.count = r.capacity = count;
+	}
+	else
+	if (runSize < bitmapSize)
+	{
+		if (!(r.runs = (RUN *) malloc(max(runs, 1u) * sizeof(RUN))))
+			throw std::bad_alloc();
+		runsOf(bitmap, r.runs);
+		r.type = TYPE_RUN;
+		r.count = r.capacity = runs;
+	}
+	else
+	{
+		if (!(r.bitmap = (UINT64 *) _aligned_malloc(bitmapSize, 16)))
+			throw std::bad_alloc();
+		memcpy(r.bitmap, bitmap, bitmapSize);
+		r.type = TYPE_BITMAP;
+	}
+	freeContainer(c);
+	c = r;
+}
+
+void EaBitmap::toBitmap(CONTAINER &c)
+{
+	if (c.type != TYPE_BITMAP)
+	{
+		UINT64 *bitmap = (UINT64 *) _aligned_malloc((BITMAP_WORDS * sizeof(UINT64)), 16);
+		if (!bitmap)
+			throw std::bad_alloc();
+		bitmapOf(c, bitmap);
+		UINT32 cardinality = c.cardinality;
+		freeContainer(c);
+		c.bitmap = bitmap;
+		c.type = TYPE_BITMAP;
+		c.cardinality = cardinality;
+	}
+}
+
+BOOL EaBitmap::containerContains(const CONTAINER &c, UINT16 low)
+{
+	switch (c.type)
+	{
+		case TYPE_ARRAY:
+		return std::binary_search(c.array, (c.array + c.count), low);
+
+		case TYPE_BITMAP:
+		return ((c.bitmap[low >> 6] >> (low & 63)) & 1);
+
+		case TYPE_RUN:
+		{
+			// Last run starting at or before 'low'
+			const RUN *run = std::upper_bound(c.runs, (c.runs + c.count), low, [](UINT16 v, const RUN &r) { return (v < r.start); });
+			if (run == c.runs)
+				return FALSE;
+			--run;
+			return ((UINT32) low <= ((UINT32) run->start + run->length));
+		}
+	};
+	return FALSE;
+}
+
+void EaBitmap::containerAdd(CONTAINER &c, UINT16 low)
+{
+	switch (c.type)
+	{
+		case TYPE_ARRAY:
+		{
+			UINT16 *pos = std::lower_bound(c.array, (c.array + c.count), low);
+			if ((pos < (c.array + c.count)) && (*pos == low))
+				return;
+			if (c.count >= ARRAY_MAX)
+			{
+				toBitmap(c);
+				containerAdd(c, low);
+				return;
+			}
+			size_t index = (pos - c.array);
+			reserve(c, (c.count + 1));
+			memmove(&c.array[index + 1], &c.array[index], ((c.count - index) * sizeof(UINT16)));
+			c.array[index] = low;
+			c.count++, c.cardinality++;
+		}
+		break;
+
+		case TYPE_BITMAP:
+		{
+			UINT64 bit = (1ull << (low & 63));
+			if (!(c.bitmap[low >> 6] & bit))
+			{
+				c.bitmap[low >> 6] |= bit;
+				c.cardinality++;
+			}
+		}
+		break;
+
+		case TYPE_RUN:
+		{
+			if (containerContains(c, low))
+				return;
+
+			// Extend or merge neighbor runs when adjacent, else insert a new one
+			size_t next = (std::upper_bound(c.runs, (c.runs + c.count), low, [](UINT16 v, const RUN &r) { return (v < r.start); }) - c.runs);
+			BOOL extendPrev = ((next > 0) && (((UINT32) c.runs[next - 1].start + c.runs[next - 1].length + 1) == low));
+			BOOL extendNext = ((next < c.count) && (c.runs[next].start == ((UINT32) low + 1)));
+			if (extendPrev && extendNext)
+			{
+				c.runs[next - 1].length += (c.runs[next].length + 2);
+				memmove(&c.runs[next], &c.runs[next + 1], ((c.count - (next + 1)) * sizeof(RUN)));
+				c.count--;
+			}
+			else
+			if (extendPrev)
+				c.runs[next - 1].length++;
+			else
+			if (extendNext)
+			{
+				c.runs[next].start--;
+				c.runs[next].length++;
+			}
+			else
+			{
+				if (c.count >= RUN_MAX)
+				{
+					toBitmap(c);
+					containerAdd(c, low);
+					return;
+				}
+				reserve(c, (c.count + 1));
+				memmove(&c.runs[next + 1], &c.runs[next], ((c.count - next) * sizeof(RUN)));
+				c.runs[next].start = low;
+				c.runs[next].length = 0;
+				c.count++;
+			}
+			c.cardinality++;
+		}
+		break;
+	};
+}
+
+BOOL EaBitmap::containerRemove(CONTAINER &c, UINT16 low)
+{
+	switch (c.type)
+	{
+		case TYPE_ARRAY:
+		{
+			UINT16 *pos = std::lower_bound(c.array, (c.array + c.count), low);
+			if ((pos == (c.array + c.count)) || (*pos != low))
+				return FALSE;
+			size_t index = (pos - c.array);
+			memmove(&c.array[index], &c.array[index + 1], ((c.count - (index + 1)) * sizeof(UINT16)));
+			c.count--, c.cardinality--;
+		}
+		return TRUE;
+
+		case TYPE_BITMAP:
+		{
+			UINT64 bit = (1ull << (low & 63));
+			if (!(c.bitmap[low >> 6] & bit))
+				return FALSE;
+			c.bitmap[low >> 6] &= ~bit;
+			c.cardinality--;
+			normalize(c);
+		}
+		return TRUE;
+
+		case TYPE_RUN:
+		{
+			if (!containerContains(c, low))
+				return FALSE;
+
+			// Trim or split the containing run
+			size_t index = ((std::upper_bound(c.runs, (c.runs + c.count), low, [](UINT16 v, const RUN &r) { return (v < r.start); }) - c.runs) - 1);
+			RUN &run = c.runs[index];
+			UINT32 end = ((UINT32) run.start + run.length);
+			if (run.length == 0)
+			{
+				memmove(&c.runs[index], &c.runs[index + 1], ((c.count - (index + 1)) * sizeof(RUN)));
+				c.count--;
+			}
+			else
+			if (low == run.start)
+			{
+				run.start++;
+				run.length--;
+			}
+			else
+			if (low == end)
+				run.length--;
+			else
+			{
+				if (c.count >= RUN_MAX)
+				{
+					toBitmap(c);
+					return containerRemove(c, low);
+				}
+				reserve(c, (c.count + 1));
+				RUN &split = c.runs[index];
+				memmove(&c.runs[index + 2], &c.runs[index + 1], ((c.count - (index + 1)) * sizeof(RUN)));
+				c.runs[index + 1].start = (low + 1);
+				c.runs[index + 1].length = (UINT16) (end - (low + 1));
+				split.length = (UINT16) (low - (split.start + 1));
+				c.count++;
+			}
+			c.cardinality--;
+		}
+		return TRUE;
+	};
+	return FALSE;
+}
+
+// ----------------------------------------------------------------------------
+
+EaBitmap::CONTAINER *EaBitmap::findContainer(UINT64 key)
+{
+	if ((m_lastIndex < m_containers.size()) && (m_containers[m_lastIndex].key == key))
+		return &m_containers[m_lastIndex];
+
+	auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const CONTAINER &c, UINT64 k) { return (c.key < k); });
+	if ((it != m_containers.end()) && (it->key == key))
+	{
+		m_lastIndex = (it - m_containers.begin());
+		return &*it;
+	}
+	return NULL;
+}
+
+// Get container for key, creating an empty array container as needed
+EaBitmap::CONTAINER &EaBitmap::getContainer(UINT64 key)
+{
+	if (CONTAINER *c = findContainer(key))
+		return *c;
+
+	auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const CONTAINER &c, UINT64 k) { return (c.key < k); });
+	CONTAINER c = {};
+	c.key = key;
+	c.type = TYPE_ARRAY;
+	it = m_containers.insert(it, c);
+	m_lastIndex = (it - m_containers.begin());
+	return *it;
+}
+
+void EaBitmap::removeContainer(CONTAINER &c)
+{
+	freeContainer(c);
+	m_containers.erase(m_containers.begin() + (&c - m_containers.data()));
+	m_lastIndex = 0;
+}
+
+void EaBitmap::clear()
+{
+	for (CONTAINER &c : m_containers)
+		freeContainer(c);
+	m_containers.clear();
+	m_lastIndex = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void EaBitmap::add(ea_t ea)
+{
+	containerAdd(getContainer(ea >> 16), (UINT16) ea);
+}
+
+BOOL EaBitmap::contains(ea_t ea)
+{
+	if (CONTAINER *c = findContainer(ea >> 16))
+		return containerContains(*c, (UINT16) ea);
+	return FALSE;
+}
+
+BOOL EaBitmap::remove(ea_t ea)
+{
+	if (CONTAINER *c = findContainer(ea >> 16))
+	{
+		if (containerRemove(*c, (UINT16) ea))
+		{
+			if (c->cardinality == 0)
+				removeContainer(*c);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void EaBitmap::addRange(ea_t start, ea_t end)
+{
+	if (start >= end)
+		return;
+
+	UINT64 lastKey = ((end - 1) >> 16);
+	for (UINT64 key = (start >> 16);; key++)
+	{
+		UINT32 low = ((key == (start >> 16)) ? (UINT32) (start & 0xFFFF) : 0);
+		UINT32 high = ((key == lastKey) ? (UINT32) ((end - 1) & 0xFFFF) : 0xFFFF);
+		CONTAINER *c = findContainer(key);
+
+		if (!c || (c->cardinality == 0) || ((low == 0) && (high == 0xFFFF)))
+		{
+			// New or fully covered container becomes a single run
+			CONTAINER &r = (c ? *c : getContainer(key));
+			freeContainer(r);
+			r.type = TYPE_RUN;
+			reserve(r, 1);
+			r.runs[0].start = (UINT16) low;
+			r.runs[0].length = (UINT16) (high - low);
+			r.count = 1;
+			r.cardinality = ((high - low) + 1);
+		}
+		else
+		{
+			// Merge through a bitmap, then re-pick the encoding so a small range or another run doesn't leave an
+			// 8KB bitmap behind
+			ALIGN(16) UINT64 bitmap[BITMAP_WORDS];
+			bitmapOf(*c, bitmap);
+			setBitRange(bitmap, low, high);
+			setFromBitmap(*c, bitmap);
+		}
+
+		if (key == lastKey)
+			break;
+	}
+}
+
+void EaBitmap::addSegments(int segType)
+{
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+		{
+			if ((segType == -1) || ((int) segment.type == segType))
+				addRange(segment.start, segment.end);
+		}
+	}
+}
+
+// Deep copy container data
+static void copyContainerData(PVOID &data, const PVOID source, size_t size, BOOL aligned)
+{
+	data = (aligned ? _aligned_malloc(size, 16) : malloc(max(size, (size_t) 1)));
+	if (!data)
+		throw std::bad_alloc();
+	memcpy(data, source, size);
+}
+
+void EaBitmap::orWith(const EaBitmap &other)
+{
+	std::vector<CONTAINER> result;
+	result.reserve(m_containers.size() + other.m_containers.size());
+	ALIGN(16) UINT64 a[BITMAP_WORDS], b[BITMAP_WORDS];
+
+	size_t i = 0, j = 0;
+	while ((i < m_containers.size()) || (j < other.m_containers.size()))
+	{
+		if ((j >= other.m_containers.size()) || ((i < m_containers.size()) && (m_containers[i].key < other.m_containers[j].key)))
+			result.push_back(m_containers[i++]);
+		else
+		if ((i >= m_containers.size()) || (other.m_containers[j].key < m_containers[i].key))
+		{
+			// Only in other, copy it
+			const CONTAINER &oc = other.m_containers[j++];
+			CONTAINER c = oc;
+			size_t size = ((oc.type == TYPE_BITMAP) ? (BITMAP_WORDS * sizeof(UINT64)) : (oc.count * ((oc.type == TYPE_ARRAY) ? sizeof(UINT16) : sizeof(RUN))));
+			copyContainerData((PVOID &) c.array, oc.array, size, (oc.type == TYPE_BITMAP));
+			c.capacity = oc.count;
+			result.push_back(c);
+		}
+		else
+		{
+			CONTAINER c = m_containers[i++];
+			const CONTAINER &oc = other.m_containers[j++];
+			if ((c.cardinality < FULL) && (oc.cardinality > 0))
+			{
+				bitmapOf(c, a);
+				bitmapOf(oc, b);
+				for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+					a[w] |= b[w];
+				toBitmap(c);
+				memcpy(c.bitmap, a, sizeof(a));
+				c.cardinality = bitmapCount(c.bitmap);
+				normalize(c);
+			}
+			result.push_back(c);
+		}
+	}
+	m_containers.swap(result);
+	m_lastIndex = 0;
+}
+
+void EaBitmap::andWith(const EaBitmap &other)
+{
+	std::vector<CONTAINER> result;
+	result.reserve(min(m_containers.size(), other.m_containers.size()));
+	ALIGN(16) UINT64 b[BITMAP_WORDS];
+
+	size_t i = 0, j = 0;
+	for (; i < m_containers.size(); i++)
+	{
+		CONTAINER c = m_containers[i];
+		while ((j < other.m_containers.size()) && (other.m_containers[j].key < c.key))
+			j++;
+
+		if ((j < other.m_containers.size()) && (other.m_containers[j].key == c.key))
+		{
+			const CONTAINER &oc = other.m_containers[j];
+			if (oc.cardinality < FULL)
+			{
+				if (c.type == TYPE_ARRAY)
+				{
+					// Filter sparse array in place
+					UINT32 count = 0;
+					for (UINT32 k = 0; k < c.count; k++)
+					{
+						if (containerContains(oc, c.array[k]))
+							c.array[count++] = c.array[k];
+					}
+					c.count = c.cardinality = count;
+				}
+				else
+				{
+					// Expand other first, for a.andWith(a) toBitmap() frees the storage both share
+					bitmapOf(oc, b);
+					toBitmap(c);
+					for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+						c.bitmap[w] &= b[w];
+					c.cardinality = bitmapCount(c.bitmap);
+					normalize(c);
+				}
+			}
+
+			if (c.cardinality)
+			{
+				result.push_back(c);
+				continue;
+			}
+		}
+
+		// Not in both
+		freeContainer(c);
+	}
+	m_containers.swap(result);
+	m_lastIndex = 0;
+}
+
+void EaBitmap::optimize()
+{
+	ALIGN(16) UINT64 bitmap[BITMAP_WORDS];
+	for (CONTAINER &c : m_containers)
+	{
+		if (c.type == TYPE_RUN)
+			continue;
+
+		bitmapOf(c, bitmap);
+		UINT32 runs = bitmapRuns(bitmap);
+		size_t currentSize = ((c.type == TYPE_BITMAP) ? sizeof(bitmap) : (c.cardinality * sizeof(UINT16)));
+		if ((runs * sizeof(RUN)) < currentSize)
+		{
+			RUN *data = (RUN *) malloc(runs * sizeof(RUN));
+			if (!data)
+				throw std::bad_alloc();
+			runsOf(bitmap, data);
+			UINT32 count = runs;
+
+			UINT32 cardinality = c.cardinality;
+			if (c.type == TYPE_BITMAP)
+				_aligned_free(c.bitmap);
+			else
+				free(c.array);
+			c.runs = data;
+			c.type = TYPE_RUN;
+			c.count = c.capacity = count;
+			c.cardinality = cardinality;
+		}
+		else
+		if (c.type == TYPE_ARRAY)
+		{
+			// Trim unused array capacity
+			if (UINT16 *array = (UINT16 *) realloc(c.array, (max(c.count, 1u) * sizeof(UINT16))))
+			{
+				c.array = array;
+				c.capacity = c.count;
+			}
+		}
+	}
+	m_containers.shrink_to_fit();
+}
+
+UINT64 EaBitmap::count()
+{
+	UINT64 total = 0;
+	for (const CONTAINER &c : m_containers)
+		total += c.cardinality;
+	return total;
+}
+
+size_t EaBitmap::memoryUsage()
+{
+	size_t total = (m_containers.capacity() * sizeof(CONTAINER));
+	for (const CONTAINER &c : m_containers)
+	{
+		switch (c.type)
+		{
+			case TYPE_ARRAY:  total += (c.capacity * sizeof(UINT16)); break;
+			case TYPE_BITMAP: total += (BITMAP_WORDS * sizeof(UINT64)); break;
+			case TYPE_RUN:    total += (c.capacity * sizeof(RUN)); break;
+		};
+	}
+	return total;
+}
@@ -0,0 +1,182 @@
+
+// IDA utility support: Compressed address bitmap
+#pragma once
+
+#include <vector>
+
+// Roaring style compressed bitmap keyed on ea_t for visited/marked address sets.
+// The high 48 bits of an address select a 64K address container; each container picks the smallest of three
+// encodings for its low 16 bits: a sorted UINT16 array (sparse), a 8KB bitmap (dense), or start/length runs
+// (contiguous ranges like whole segments). Not thread safe.
+class EaBitmap
+{
+public:
+	EaBitmap() : m_lastIndex(0) {}
+	~EaBitmap() { clear(); }
+
+	void add(ea_t ea);
+	// Add range [start, end)
+	void addRange(ea_t start, ea_t end);
+	// Returns TRUE if address was in the set
+	BOOL remove(ea_t ea);
+	BOOL contains(ea_t ea);
+
+	// Union and intersection in place
+	void orWith(const EaBitmap &other);
+	void andWith(const EaBitmap &other);
+
+	// Add all idbAccess segment ranges, or only those of segment type (SEG_CODE, SEG_DATA, etc.)
+	void addSegments(int segType = -1);
+
+	// Convert containers to run encoding where it is smaller. Worth calling after bulk adds.
+	void optimize();
+
+	void clear();
+	UINT64 count();
+	BOOL empty() { return m_containers.empty(); }
+	size_t memoryUsage();
+
+	// Call f(ea_t ea) for every address in ascending order
+	template <class F> void forEach(F f)
+	{
+		for (const CONTAINER &c : m_containers)
+		{
+			ea_t base = (c.key << 16);
+			switch (c.type)
+			{
+				case TYPE_ARRAY:
+				for (UINT32 i = 0; i < c.count; i++)
+					f(base | c.array[i]);
+				break;
+
+				case TYPE_BITMAP:
+				for (UINT32 w = 0; w < BITMAP_WORDS; w++)
+				{
+					UINT64 bits = c.bitmap[w];
+					while (bits)
+					{
+						unsigned long bit;
+						_BitScanForward64(&bit, bits);
+						f(base | ((w << 6) + bit));
+						bits &= (bits - 1);
+					}
+				}
+				break;
+
+				case TYPE_RUN:
+				for (UINT32 i = 0; i < c.count; i++)
+				{
+					UINT32 start = c.runs[i].start, end = (start + c.runs[i].length);
+					for (UINT32 v = start; v <= end; v++)
+						f(base | v);
+				}
+				break;
+			};
+		}
+	}
+
+	// Call f(ea_t start, ea_t end) for every maximal [start, end) range in ascending order
+	template <class F> void forEachRange(F f)
+	{
+		ea_t rangeStart = BADADDR, rangeEnd = BADADDR;
+		auto addRun = [&](ea_t start, ea_t end)
+		{
+			if (start == rangeEnd)
+				rangeEnd = end;
+			else
+			{
+				if (rangeStart != BADADDR)
+					f(rangeStart, rangeEnd);
+				rangeStart = start, rangeEnd = end;
+			}
+		};
+
+		for (const CONTAINER &c : m_containers)
+		{
+			ea_t base = (c.key << 16);
+			switch (c.type)
+			{
+				case TYPE_ARRAY:
+				for (UINT32 i = 0; i < c.count; i++)
+					addRun(base | c.array[i], (base | c.array[i]) + 1);
+				break;
+
+				case TYPE_BITMAP:
+				for (UINT32 v = 0; v < 0x10000;)
+				{
+					// Skip to the next set bit, then the next clear bit
+					UINT32 start = nextBit(c.bitmap, v, TRUE);
+					if (start >= 0x10000)
+						break;
+					v = nextBit(c.bitmap, start, FALSE);
+					addRun(base + start, base + v);
+				}
+				break;
+
+				case TYPE_RUN:
+				for (UINT32 i = 0; i < c.count; i++)
+					addRun(base + c.runs[i].start, base + c.runs[i].start + c.runs[i].length + 1);
+				break;
+			};
+		}
+		if (rangeStart != BADADDR)
+			f(rangeStart, rangeEnd);
+	}
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(EaBitmap);
+
+	// Array containers convert to bitmaps past this count, the point where both are 8KB
+	static const UINT32 ARRAY_MAX = 4096;
+	static const UINT32 BITMAP_WORDS = (0x10000 / 64);
+
+	enum CONTAINER_TYPE : BYTE
+	{
+		TYPE_ARRAY,
+		TYPE_BITMAP,
+		TYPE_RUN
+	};
+
+	// Inclusive run, length is the count minus one so a full 64K run fits
+	struct RUN
+	{
+		UINT16 start;
+		UINT16 length;
+	};
+
+	struct CONTAINER
+	{
+		UINT64 key;				// Address >> 16
+		union
+		{
+			UINT16 *array;
+			UINT64 *bitmap;
+			RUN *runs;
+		};
+		UINT32 cardinality;
+		UINT32 count;			// Array or run element count
+		UINT32 capacity;		// Array or run element capacity
+		CONTAINER_TYPE type;
+	};
+
+	static UINT32 nextBit(const UINT64 *bitmap, UINT32 from, BOOL set);
+
+	CONTAINER *findContainer(UINT64 key);
+	CONTAINER &getContainer(UINT64 key);
+	void removeContainer(CONTAINER &c);
+
+	static void freeContainer(CONTAINER &c);
+	static void reserve(CONTAINER &c, UINT32 count);
+	static BOOL containerContains(const CONTAINER &c, UINT16 low);
+	static void containerAdd(CONTAINER &c, UINT16 low);
+	static BOOL containerRemove(CONTAINER &c, UINT16 low);
+	static void toBitmap(CONTAINER &c);
+	static void normalize(CONTAINER &c);
+	static void bitmapOf(const CONTAINER &c, __out UINT64 *bitmap);
+	static UINT32 bitmapRuns(const UINT64 *bitmap);
+	static void runsOf(const UINT64 *bitmap, __out RUN *runs);
+	static void setFromBitmap(CONTAINER &c, const UINT64 *bitmap);
+
+	std::vector<CONTAINER> m_containers; // Sorted by key
+	size_t m_lastIndex;                  // Last container accessed, for address locality
+};
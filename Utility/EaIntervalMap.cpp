@@ -0,0 +1,62 @@
+
+// IDA utility support: Address interval map
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <funcs.hpp>
+#include <segment.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <EaIntervalMap.h>
+
+
+void buildFunctionRangeMap(__out EaIntervalMap<ea_t> &map, BOOL withTails)
+{
+	map.clear();
+	size_t count = get_func_qty();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (func_t *pfn = getn_func(i))
+		{
+			if (withTails && (pfn->tailqty > 0))
+			{
+				func_tail_iterator_t fti(pfn);
+				for (bool ok = fti.first(); ok; ok = fti.next())
+				{
+					const range_t &chunk = fti.chunk();
+					map.add(chunk.start_ea, chunk.end_ea, pfn->start_ea);
+				}
+			}
+			else
+				map.add(pfn->start_ea, pfn->end_ea, pfn->start_ea);
+		}
+	}
+	map.build();
+}
+
+void buildSegmentRangeMap(__out EaIntervalMap<ea_t> &map)
+{
+	map.clear();
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+			map.add(segment.start, segment.end, segment.start);
+	}
+	map.build();
+}
@@ -0,0 +1,214 @@
+
+// IDA utility support: Address interval map
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Static map of [start, end) address ranges to values for fast classification lookups.
+// Ranges are kept sorted by start in separate (SoA) start, end and value arrays with a small top level index of
+// every 64th start, so a lookup is two short binary searches over cache dense data.
+// Overlapping ranges are supported via a max tree of the per 64 range block max ends, so ranges below an enclosing
+// one cost O(64 + log n) per hit rather than a scan back to its start. For the common disjoint case a lookup is the
+// two searches and one compare.
+// Add ranges then build(), or use buildSorted() for already sorted input. The const queries are safe from any
+// number of threads once built; add(), build(), buildSorted() and clear() need exclusive access.
+template <class T> class EaIntervalMap
+{
+public:
+	EaIntervalMap() : m_leaves(1), m_disjoint(TRUE) {}
+
+	// Stage a range for the next build()
+	void add(ea_t start, ea_t end, const T &value)
+	{
+		if (start < end)
+			m_pending.push_back({ start, end, value });
+	}
+
+	// Sort and index staged ranges, merged with any current ones
+	void build()
+	{
+		for (size_t i = 0; i < m_starts.size(); i++)
+			m_pending.push_back({ m_starts[i], m_ends[i], m_values[i] });
+		std::stable_sort(m_pending.begin(), m_pending.end(), [](const PENDING &a, const PENDING &b) { return (a.start < b.start); });
+
+		size_t count = m_pending.size();
+		m_starts.resize(count);
+		m_ends.resize(count);
+		m_values.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_starts[i] = m_pending[i].start;
+			m_ends[i] = m_pending[i].end;
+			m_values[i] = m_pending[i].value;
+		}
+		m_pending.clear();
+		m_pending.shrink_to_fit();
+		index();
+	}
+
+	// Bulk build from input already sorted by start, replacing the current contents.
+	// Returns FALSE if the input wasn't sorted.
+	BOOL buildSorted(const ea_t *starts, const ea_t *ends, const T *values, size_t count)
+	{
+		for (size_t i = 1; i < count; i++)
+		{
+			if (starts[i] < starts[i - 1])
+				return FALSE;
+		}
+		m_starts.assign(starts, (starts + count));
+		m_ends.assign(ends, (ends + count));
+		m_values.assign(values, (values + count));
+		index();
+		return TRUE;
+	}
+
+	// Stabbing query, returns the value of the range containing address or NULL if none.
+	// With overlaps the one with the greatest start (typically the innermost) wins.
+	const T *find(ea_t ea) const
+	{
+		size_t i = findIndex(ea);
+		return ((i != NOT_FOUND) ? &m_values[i] : NULL);
+	}
+
+	// Index of range containing address, or NOT_FOUND
+	size_t findIndex(ea_t ea) const { return lastEndAbove(upperBound(ea), ea); }
+
+	BOOL contains(ea_t ea) const { return (findIndex(ea) != NOT_FOUND); }
+
+	// Call f(size_t index) for every range containing address, in descending start order
+	template <class F> void stab(ea_t ea, F f) const
+	{
+		for (size_t i = lastEndAbove(upperBound(ea), ea); i != NOT_FOUND; i = lastEndAbove(i, ea))
+			f(i);
+	}
+
+	// Call f(size_t index) for every range overlapping [start, end), in descending start order
+	template <class F> void overlap(ea_t start, ea_t end, F f) const
+	{
+		if (start < end)
+		{
+			for (size_t i = lastEndAbove(upperBound(end - 1), start); i != NOT_FOUND; i = lastEndAbove(i, start))
+				f(i);
+		}
+	}
+
+	ea_t start(size_t index) const { return m_starts[index]; }
+	ea_t end(size_t index) const { return m_ends[index]; }
+	T &value(size_t index) { return m_values[index]; }
+	const T &value(size_t index) const { return m_values[index]; }
+
+	size_t size() const { return m_starts.size(); }
+	BOOL isDisjoint() const { return m_disjoint; }
+	void clear()
+	{
+		m_starts.clear(), m_ends.clear(), m_blockMaxEnds.clear(), m_values.clear(), m_index.clear(), m_pending.clear();
+		m_leaves = 1, m_disjoint = TRUE;
+	}
+	size_t memoryUsage() const { return ((m_starts.capacity() + m_ends.capacity() + m_blockMaxEnds.capacity() + m_index.capacity()) * sizeof(ea_t)) + (m_values.capacity() * sizeof(T)); }
+
+	static const size_t NOT_FOUND = ((size_t) -1);
+
+private:
+	static const size_t BLOCK_SIZE = 64;
+
+	struct PENDING
+	{
+		ea_t start, end;
+		T value;
+	};
+
+	// Build the block max end tree and top level index.
+	// The tree is implicit, node 1 is the root, node n has children 2n and 2n + 1, leaf 'm_leaves + b' is block b.
+	void index()
+	{
+		size_t count = m_starts.size(), blocks = ((count + (BLOCK_SIZE - 1)) / BLOCK_SIZE);
+		m_leaves = 1;
+		while (m_leaves < blocks)
+			m_leaves <<= 1;
+		m_blockMaxEnds.assign((m_leaves * 2), 0);
+
+		m_disjoint = TRUE;
+		ea_t maxEnd = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (m_starts[i] < maxEnd)
+				m_disjoint = FALSE;
+			if (m_ends[i] > maxEnd)
+				maxEnd = m_ends[i];
+			ea_t &blockMax = m_blockMaxEnds[m_leaves + (i / BLOCK_SIZE)];
+			if (m_ends[i] > blockMax)
+				blockMax = m_ends[i];
+		}
+		for (size_t node = (m_leaves - 1); node > 0; node--)
+		{
+			ea_t left = m_blockMaxEnds[node * 2], right = m_blockMaxEnds[(node * 2) + 1];
+			m_blockMaxEnds[node] = ((left > right) ? left : right);
+		}
+
+		m_index.clear();
+		for (size_t i = 0; i < count; i += BLOCK_SIZE)
+			m_index.push_back(m_starts[i]);
+	}
+
+	// Greatest index below 'limit' with an end greater than address, or NOT_FOUND.
+	// Scans what's left of the block 'limit - 1' is in, then finds the nearest earlier block with a greater max end
+	// through the tree, which then must have a hit.
+	size_t lastEndAbove(size_t limit, ea_t ea) const
+	{
+		if (!limit)
+			return NOT_FOUND;
+		size_t blockStart = (((limit - 1) / BLOCK_SIZE) * BLOCK_SIZE);
+		for (size_t i = limit; i > blockStart; i--)
+		{
+			if (m_ends[i - 1] > ea)
+				return (i - 1);
+		}
+
+		// Climb out of left children, step to the left sibling subtree, until one has a greater max end
+		size_t node = (m_leaves + (blockStart / BLOCK_SIZE));
+		for (;;)
+		{
+			while (!(node & 1))
+				node >>= 1;
+			if (node == 1)
+				return NOT_FOUND;
+			node--;
+			if (m_blockMaxEnds[node] > ea)
+				break;
+		}
+		// Then down to its rightmost such block
+		while (node < m_leaves)
+			node = ((m_blockMaxEnds[(node * 2) + 1] > ea) ? ((node * 2) + 1) : (node * 2));
+
+		for (size_t i = (((node - m_leaves) + 1) * BLOCK_SIZE); i > 0; i--)
+		{
+			if (m_ends[i - 1] > ea)
+				return (i - 1);
+		}
+		return NOT_FOUND;
+	}
+
+	// First index with a start greater than address
+	size_t upperBound(ea_t ea) const
+	{
+		size_t block = (std::upper_bound(m_index.begin(), m_index.end(), ea) - m_index.begin());
+		if (block == 0)
+			return 0;
+		const ea_t *first = &m_starts[(block - 1) * BLOCK_SIZE];
+		const ea_t *last = (m_starts.data() + (((block * BLOCK_SIZE) < m_starts.size()) ? (block * BLOCK_SIZE) : m_starts.size()));
+		return (std::upper_bound(first, last, ea) - m_starts.data());
+	}
+
+	std::vector<ea_t> m_starts, m_ends, m_blockMaxEnds, m_index;
+	std::vector<T> m_values;
+	std::vector<PENDING> m_pending;
+	size_t m_leaves;
+	BOOL m_disjoint;
+};
+
+// Build map of function chunk ranges to their owning function start address
+void buildFunctionRangeMap(__out EaIntervalMap<ea_t> &map, BOOL withTails = TRUE);
+
+// Build map of segment ranges to their segment start address
+void buildSegmentRangeMap(__out EaIntervalMap<ea_t> &map);
@@ -0,0 +1,354 @@
+
+// IDA utility support: Parallel block entropy and byte histogram profiler
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+#include <math.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <segment.hpp>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <Utility.h>
+#include <EntropyProfile.h>
+
+using namespace EntropyProfile;
+
+// Target bytes per work item, rounded to whole steps
+static const size_t ITEM_SIZE = (4 * 1024 * 1024);
+
+// A run of windows of one segment, and its bytes
+struct WORK
+{
+	size_t segment;		// PROFILE::segments index
+	ea_t ea;			// First window start
+	size_t first;		// PROFILE::levels index of the first window
+	size_t count;		// Windows
+	size_t owned;		// Bytes from 'ea' that count toward the segment histogram, up to the next item
+	size_t size;		// Bytes from 'ea' read, covering the windows and the owned bytes
+	std::vector<BYTE> data;
+	ALIGN(16) UINT32 histogram[256];
+};
+
+// Byte counting, four interleaved tables so runs of the same byte don't serialize on one counter's store forward
+struct ALIGN(16) COUNTS
+{
+	UINT32 table[4][256];
+};
+
+static void countBytes(const BYTE *p, size_t size, COUNTS &counts)
+{
+	size_t i = 0;
+	for (; (i + 8) <= size; i += 8)
+	{
+		UINT64 v;
+		memcpy(&v, (p + i), sizeof(v));
+		counts.table[0][(BYTE) v]++;
+		counts.table[1][(BYTE) (v >> 8)]++;
+		counts.table[2][(BYTE) (v >> 16)]++;
+		counts.table[3][(BYTE) (v >> 24)]++;
+		counts.table[0][(BYTE) (v >> 32)]++;
+		counts.table[1][(BYTE) (v >> 40)]++;
+		counts.table[2][(BYTE) (v >> 48)]++;
+		counts.table[3][(BYTE) (v >> 56)]++;
+	}
+	for (; i < size; i++)
+		counts.table[i & 3][p[i]]++;
+}
+
+// Sum the tables into 'histogram'
+static void sumCounts(const COUNTS &counts, __out UINT32 *histogram)
+{
+	const __m128i *t0 = (const __m128i *) counts.table[0], *t1 = (const __m128i *) counts.table[1];
+	const __m128i *t2 = (const __m128i *) counts.table[2], *t3 = (const __m128i *) counts.table[3];
+	for (UINT32 i = 0; i < (256 / 4); i++)
+	{
+		__m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_load_si128(t0 + i), _mm_load_si128(t1 + i)), _mm_add_epi32(_mm_load_si128(t2 + i), _mm_load_si128(t3 + i)));
+		_mm_storeu_si128((__m128i *) (histogram + (i * 4)), sum);
+	}
+}
+
+// Sum then zero the tables for the next count
+static void mergeCounts(COUNTS &counts, __out UINT32 *histogram)
+{
+	sumCounts(counts, histogram);
+	memset(&counts, 0, sizeof(counts));
+}
+
+// Take [p, p + size) out of the counts. A table may wrap below zero, the table sums stay right.
+static void uncountBytes(const BYTE *p, size_t size, COUNTS &counts)
+{
+	size_t i = 0;
+	for (; (i + 4) <= size; i += 4)
+	{
+		counts.table[0][p[i]]--;
+		counts.table[1][p[i + 1]]--;
+		counts.table[2][p[i + 2]]--;
+		counts.table[3][p[i + 3]]--;
+	}
+	for (; i < size; i++)
+		counts.table[i & 3][p[i]]--;
+}
+
+// histogram += add
+static void addHistogram(__inout UINT32 *histogram, const UINT32 *add)
+{
+	for (UINT32 i = 0; i < 256; i += 4)
+	{
+		__m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (histogram + i)), _mm_loadu_si128((const __m128i *) (add + i)));
+		_mm_storeu_si128((__m128i *) (histogram + i), sum);
+	}
+}
+
+static BYTE toLevel(double bits)
+{
+	double level = ((bits * LEVEL_SCALE) + 0.5);
+	if (level <= 0.0)
+		return 0;
+	return ((level >= 255.0) ? 255 : (BYTE) level);
+}
+
+
+class Profiler
+{
+public:
+	Profiler(const OPTIONS &options, PROFILE &profile) : m_options(options), m_profile(profile)
+	{
+		m_threads = (options.threads ? options.threads : std::thread::hardware_concurrency());
+		if (!m_threads)
+			m_threads = 1;
+
+		// With the sum of c * log2(c) over the counts, a window of N bytes has log2(N) - (sum / N) bits
+		m_cLogC.resize(options.windowSize + 1);
+		m_cLogC[0] = 0.0;
+		for (UINT32 c = 1; c <= options.windowSize; c++)
+			m_cLogC[c] = (c * log2((double) c));
+	}
+
+	void profileSegment(size_t index);
+
+private:
+	void process(WORK &work);
+	// Independent partial sums, a running update per byte would be one long add chain
+	double sumCLogC(const UINT32 *histogram) const
+	{
+		const double *cLogC = m_cLogC.data();
+		double sum[4] = {};
+		for (UINT32 i = 0; i < 256; i += 4)
+		{
+			sum[0] += cLogC[histogram[i]];
+			sum[1] += cLogC[histogram[i + 1]];
+			sum[2] += cLogC[histogram[i + 2]];
+			sum[3] += cLogC[histogram[i + 3]];
+		}
+		return ((sum[0] + sum[1]) + (sum[2] + sum[3]));
+	}
+	double windowBits(double sum, size_t size) const
+	{
+		return (size ? (log2((double) size) - (sum / (double) size)) : 0.0);
+	}
+
+	const OPTIONS &m_options;
+	PROFILE &m_profile;
+	UINT32 m_threads;
+	std::vector<double> m_cLogC;
+};
+
+// Read a batch of work items on this thread, count them in parallel, repeat
+void Profiler::profileSegment(size_t index)
+{
+	SEGMENT &segment = m_profile.segments[index];
+	size_t step = m_options.step, window = m_options.windowSize;
+	size_t perItem = ((ITEM_SIZE > step) ? (ITEM_SIZE / step) : 1);
+
+	std::vector<WORK> batch(m_threads * 2);
+	for (size_t next = 0; next < segment.windowCount;)
+	{
+		size_t count = 0;
+		for (; (count < batch.size()) && (next < segment.windowCount); count++)
+		{
+			WORK &work = batch[count];
+			work.segment = index;
+			work.ea = (segment.start + (next * step));
+			work.first = (segment.firstWindow + next);
+			work.count = (((segment.windowCount - next) < perItem) ? (segment.windowCount - next) : perItem);
+			next += work.count;
+
+			size_t left = (size_t) (segment.end - work.ea);
+			work.owned = ((next < segment.windowCount) ? (work.count * step) : left);
+			size_t windowsEnd = (((work.count - 1) * step) + window);
+			work.size = ((windowsEnd > work.owned) ? windowsEnd : work.owned);
+			if (work.size > left)
+				work.size = left;
+
+			work.data.resize(work.size);
+			ssize_t read = idbAccess->getBytes(work.data.data(), work.size, work.ea);
+			size_t got = ((read > 0) ? (size_t) read : 0);
+			if (got < work.size)
+				memset(&work.data[got], 0, (work.size - got));
+		}
+
+		ParallelFor(count, [&](size_t i) { process(batch[i]); }, m_threads);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (UINT32 j = 0; j < 256; j++)
+				segment.histogram[j] += batch[i].histogram[j];
+		}
+	}
+
+	BYTE *levels = &m_profile.levels[segment.firstWindow];
+	segment.packedWindows = std::count_if(levels, (levels + segment.windowCount), [](BYTE level) { return (level >= PACKED_LEVEL); });
+	segment.entropy = EntropyProfile::entropy(segment.histogram);
+}
+
+void Profiler::process(WORK &work)
+{
+	size_t step = m_options.step, window = m_options.windowSize;
+	const BYTE *data = work.data.data();
+	BYTE *levels = &m_profile.levels[work.first];
+	COUNTS counts = {};
+	ALIGN(16) UINT32 histogram[256];
+	memset(work.histogram, 0, sizeof(work.histogram));
+
+	// Windows tile the owned bytes exactly, their histograms sum to the segment's
+	BOOL tiled = (step == window);
+
+	if (step >= window)
+	{
+		// Disjoint windows, count each
+		for (size_t k = 0; k < work.count; k++)
+		{
+			size_t offset = (k * step);
+			size_t size = (((work.size - offset) < window) ? (work.size - offset) : window);
+			countBytes((data + offset), size, counts);
+			mergeCounts(counts, histogram);
+			levels[k] = toLevel(windowBits(sumCLogC(histogram), size));
+			if (tiled)
+				addHistogram(work.histogram, histogram);
+		}
+	}
+	else
+	{
+		// Sliding windows, count the first then update the counts by the bytes leaving and entering
+		size_t size = ((work.size < window) ? work.size : window);
+		countBytes(data, size, counts);
+		sumCounts(counts, histogram);
+		levels[0] = toLevel(windowBits(sumCLogC(histogram), size));
+
+		size_t end = size;
+		for (size_t k = 1; k < work.count; k++)
+		{
+			size_t offset = (k * step);
+			size_t nextEnd = (((work.size - offset) < window) ? work.size : (offset + window));
+			uncountBytes((data + (offset - step)), step, counts);
+			countBytes((data + end), (nextEnd - end), counts);
+			sumCounts(counts, histogram);
+			end = nextEnd;
+			levels[k] = toLevel(windowBits(sumCLogC(histogram), (end - offset)));
+		}
+		memset(&counts, 0, sizeof(counts));
+	}
+
+	if (!tiled)
+	{
+		countBytes(data, work.owned, counts);
+		mergeCounts(counts, work.histogram);
+	}
+}
+
+
+float EntropyProfile::entropy(const UINT64 histogram[256])
+{
+	UINT64 total = 0;
+	for (UINT32 i = 0; i < 256; i++)
+		total += histogram[i];
+	if (!total)
+		return 0.0f;
+
+	double bits = 0.0;
+	for (UINT32 i = 0; i < 256; i++)
+	{
+		if (histogram[i])
+		{
+			double p = ((double) histogram[i] / (double) total);
+			bits -= (p * log2(p));
+		}
+	}
+	return (float) bits;
+}
+
+BOOL EntropyProfile::profile(ea_t start, ea_t end, const OPTIONS &options, __out PROFILE &profile)
+{
+	profile.segments.clear();
+	profile.levels.clear();
+	profile.windowSize = options.windowSize;
+	profile.step = options.step;
+	if (!options.windowSize || (options.windowSize > MAX_WINDOW) || !options.step || (options.step > MAX_WINDOW))
+		return FALSE;
+
+	// Lay out the segments and their level ranges first, segments come in address order
+	size_t windows = 0;
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+		{
+			ea_t first = ((segment.start > start) ? segment.start : start);
+			ea_t last = ((segment.end < end) ? segment.end : end);
+			if (first < last)
+			{
+				SEGMENT part = {};
+				part.start = first;
+				part.end = last;
+				part.firstWindow = windows;
+				// Windows up to the first reaching the end, and none starting past it when the step skips bytes
+				UINT64 size = (last - first);
+				UINT64 reaching = ((size <= options.windowSize) ? 1 : (1 + (((size - options.windowSize) + (options.step - 1)) / options.step)));
+				UINT64 starting = ((size + (options.step - 1)) / options.step);
+				part.windowCount = (size_t) ((reaching < starting) ? reaching : starting);
+				windows += part.windowCount;
+				profile.segments.push_back(part);
+			}
+		}
+	}
+	profile.levels.resize(windows);
+
+	Profiler profiler(options, profile);
+	for (size_t i = 0; i < profile.segments.size(); i++)
+		profiler.profileSegment(i);
+	return TRUE;
+}
+
+BOOL EntropyProfile::profileAll(const OPTIONS &options, __out PROFILE &profile)
+{
+	return EntropyProfile::profile(0, BADADDR, options, profile);
+}
+
+BYTE EntropyProfile::levelAt(const PROFILE &profile, ea_t ea)
+{
+	auto it = std::upper_bound(profile.segments.begin(), profile.segments.end(), ea, [](ea_t ea, const SEGMENT &segment) { return (ea < segment.start); });
+	if (it == profile.segments.begin())
+		return 0;
+	const SEGMENT &segment = *(it - 1);
+	if (ea >= segment.end)
+		return 0;
+
+	size_t k = (size_t) ((ea - segment.start) / profile.step);
+	if (k >= segment.windowCount)
+		k = (segment.windowCount - 1);
+	return profile.levels[segment.firstWindow + k];
+}
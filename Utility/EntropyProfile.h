@@ -0,0 +1,60 @@
+
+// IDA utility support: Parallel block entropy and byte histogram profiler
+#pragma once
+
+#include <vector>
+
+// Shannon entropy per fixed size window, and a byte histogram per segment, for segment overview UIs and
+// packed/encrypted data detection on large dumps.
+// Segment bytes are read through idbAccess on the calling thread in batches, then the windows are counted across
+// worker threads. Window entropy is kept as one byte level per window, so a 1GB dump at the default 4KB window is a
+// 256KB array.
+namespace EntropyProfile
+{
+	// A window's level is its entropy in bits per byte times LEVEL_SCALE, 0 to 255 (8 bits reads as 255)
+	static const UINT32 LEVEL_SCALE = 32;
+	// Levels at or above this (7.2 bits) are typical of compressed or encrypted data
+	static const BYTE PACKED_LEVEL = 230;
+	// Largest windowSize and step
+	static const UINT32 MAX_WINDOW = (1024 * 1024);
+
+	struct OPTIONS
+	{
+		UINT32 windowSize;	// Bytes per window
+		UINT32 step;		// Bytes between window starts, less than windowSize for sliding windows
+		UINT32 threads;		// 0 for all hardware threads
+	};
+	inline OPTIONS defaultOptions() { return { 4096, 4096, 0 }; }
+
+	struct SEGMENT
+	{
+		ea_t start, end;		// Profiled part of the segment
+		size_t firstWindow;		// Index of its first level in PROFILE::levels
+		size_t windowCount;		// Window i covers [start + (i * step), start + (i * step) + windowSize), the last may be short
+		size_t packedWindows;	// Windows at or above PACKED_LEVEL
+		float entropy;			// Of the whole part, bits per byte
+		UINT64 histogram[256];
+	};
+
+	struct PROFILE
+	{
+		UINT32 windowSize, step;
+		std::vector<SEGMENT> segments;	// Address order
+		std::vector<BYTE> levels;		// Per window levels, segment after segment
+	};
+
+	// Profile the segment parts of [start, end), replacing the contents of 'profile'. Unreadable bytes count as
+	// zeros. Returns FALSE on invalid options.
+	BOOL profile(ea_t start, ea_t end, const OPTIONS &options, __out PROFILE &profile);
+
+	// Profile every segment
+	BOOL profileAll(const OPTIONS &options, __out PROFILE &profile);
+
+	// Shannon entropy of a histogram, bits per byte
+	float entropy(const UINT64 histogram[256]);
+
+	inline float levelToBits(BYTE level) { return ((float) level / (float) LEVEL_SCALE); }
+
+	// Level of the last window starting at or before 'ea', or 0 if it's not in a profiled segment
+	BYTE levelAt(const PROFILE &profile, ea_t ea);
+};
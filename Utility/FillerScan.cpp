@@ -0,0 +1,344 @@
+
+// IDA utility support: SIMD filler run detection
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <name.hpp>
+#include <segment.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <IdbEditQueue.h>
+#include <FillerScan.h>
+
+using namespace FillerScan;
+
+// Bytes read per getBytes() call, a multiple of 64
+static const size_t CHUNK_SIZE = (1024 * 1024);
+static const size_t BLOCKS = (CHUNK_SIZE / 64);
+
+// Longest run emitted as one, longer ones are split
+static const UINT64 MAX_RUN = 0x80000000;
+
+// Per 64 byte block bit masks of the bytes in the filler set, and of where a single value run must break because
+// the byte differs from the one before it. 'p[-1]' must be readable.
+typedef void (*CLASSIFY)(const BYTE *p, size_t blocks, const OPTIONS &options, __out UINT64 *in, __out UINT64 *brk);
+
+static void classifySse2(const BYTE *p, size_t blocks, const OPTIONS &options, __out UINT64 *in, __out UINT64 *brk)
+{
+	__m128i values[MAX_VALUES];
+	for (UINT32 k = 0; k < options.valueCount; k++)
+		values[k] = _mm_set1_epi8((char) options.values[k]);
+
+	for (size_t b = 0; b < blocks; b++, p += 64)
+	{
+		UINT64 inMask = 0, brkMask = 0;
+		for (UINT32 i = 0; i < 4; i++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *) (p + (i * 16)));
+			__m128i match = _mm_cmpeq_epi8(v, values[0]);
+			for (UINT32 k = 1; k < options.valueCount; k++)
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(v, values[k]));
+			inMask |= ((UINT64) (UINT32) _mm_movemask_epi8(match) << (i * 16));
+			if (!options.mixed)
+			{
+				__m128i same = _mm_cmpeq_epi8(v, _mm_loadu_si128((const __m128i *) (p + (i * 16) - 1)));
+				brkMask |= ((UINT64) (~(UINT32) _mm_movemask_epi8(same) & 0xFFFF) << (i * 16));
+			}
+		}
+		in[b] = inMask;
+		brk[b] = (brkMask & inMask);
+	}
+}
+
+TARGET_AVX2 static void classifyAvx2(const BYTE *p, size_t blocks, const OPTIONS &options, __out UINT64 *in, __out UINT64 *brk)
+{
+	__m256i values[MAX_VALUES];
+	for (UINT32 k = 0; k < options.valueCount; k++)
+		values[k] = _mm256_set1_epi8((char) options.values[k]);
+
+	for (size_t b = 0; b < blocks; b++, p += 64)
+	{
+		UINT64 inMask = 0, brkMask = 0;
+		for (UINT32 i = 0; i < 2; i++)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i *) (p + (i * 32)));
+			__m256i match = _mm256_cmpeq_epi8(v, values[0]);
+			for (UINT32 k = 1; k < options.valueCount; k++)
+				match = _mm256_or_si256(match, _mm256_cmpeq_epi8(v, values[k]));
+			inMask |= ((UINT64) (UINT32) _mm256_movemask_epi8(match) << (i * 32));
+			if (!options.mixed)
+			{
+				__m256i same = _mm256_cmpeq_epi8(v, _mm256_loadu_si256((const __m256i *) (p + (i * 32) - 1)));
+				brkMask |= ((UINT64) ~(UINT32) _mm256_movemask_epi8(same) << (i * 32));
+			}
+		}
+		in[b] = inMask;
+		brk[b] = (brkMask & inMask);
+	}
+}
+
+
+class Scanner
+{
+public:
+	Scanner(const OPTIONS &options, std::vector<RUN> &runs) : m_options(options), m_runs(runs), m_found(0), m_open(FALSE)
+	{
+		m_classify = ((!options.noAvx2 && cpuHasAvx2()) ? classifyAvx2 : classifySse2);
+
+		// Chunk bytes after a lead byte, padded to whole blocks
+		m_buffer.resize(1 + CHUNK_SIZE);
+		m_in.resize(BLOCKS);
+		m_brk.resize(BLOCKS);
+
+		// Pad with a value that isn't filler so runs stop at the end of the data
+		m_pad = 0;
+		while (isFiller(m_pad))
+			m_pad++;
+	}
+
+	void scanSegment(ea_t start, ea_t end, BOOL executable);
+	size_t found() { return m_found; }
+
+private:
+	BOOL isFiller(BYTE value)
+	{
+		for (UINT32 k = 0; k < m_options.valueCount; k++)
+		{
+			if (m_options.values[k] == value)
+				return TRUE;
+		}
+		return FALSE;
+	}
+	BYTE byteAt(ea_t ea)
+	{
+		BYTE value = 0;
+		idbAccess->getBytes(&value, 1, ea);
+		return value;
+	}
+
+	void close(ea_t end);
+	void emit(ea_t start, UINT64 length, BYTE value);
+	void emitSkippingCode(ea_t start, ea_t end);
+
+	const OPTIONS &m_options;
+	std::vector<RUN> &m_runs;
+	size_t m_found;
+	CLASSIFY m_classify;
+	std::vector<BYTE> m_buffer;
+	std::vector<UINT64> m_in, m_brk;
+	BYTE m_pad;
+
+	BOOL m_open, m_executable;
+	ea_t m_runStart;
+	BYTE m_runValue;
+};
+
+void Scanner::scanSegment(ea_t start, ea_t end, BOOL executable)
+{
+	m_executable = executable;
+	m_open = FALSE;
+	BYTE *data = (m_buffer.data() + 1);
+
+	for (ea_t base = start; base < end; base += CHUNK_SIZE)
+	{
+		// Lead byte is the last of the previous chunk, it only matters to a run that's open across the boundary
+		data[-1] = ((base == start) ? m_pad : data[CHUNK_SIZE - 1]);
+
+		size_t size = (((end - base) < CHUNK_SIZE) ? (size_t) (end - base) : CHUNK_SIZE);
+		ssize_t read = idbAccess->getBytes(data, size, base);
+		if (read <= 0)
+		{
+			end = base;
+			break;
+		}
+		size = (size_t) read;
+		size_t blocks = ((size + 63) / 64);
+		memset((data + size), m_pad, ((blocks * 64) - size));
+		m_classify(data, blocks, m_options, m_in.data(), m_brk.data());
+
+		for (size_t b = 0; b < blocks; b++)
+		{
+			UINT64 in = m_in[b], brk = m_brk[b];
+
+			// Fast paths: no filler and no open run, or the open run continues through the whole block
+			if (!(in | m_open) || (m_open && (in == ~0ull) && !brk))
+				continue;
+
+			ea_t blockEa = (base + (b * 64));
+			UINT32 pos = 0;
+			for (;;)
+			{
+				if (m_open)
+				{
+					UINT64 stop = (((~in) | brk) & (~0ull << pos));
+					if (!stop)
+						break;
+					unsigned long e;
+					_BitScanForward64(&e, stop);
+					close(blockEa + e);
+					pos = e;
+				}
+
+				UINT64 starts = (in & (~0ull << pos));
+				if (!starts)
+					break;
+				unsigned long s;
+				_BitScanForward64(&s, starts);
+				m_open = TRUE;
+				m_runStart = (blockEa + s);
+				m_runValue = data[(b * 64) + s];
+				pos = (s + 1);
+				if (pos >= 64)
+					break;
+			}
+		}
+		if (size < CHUNK_SIZE)
+		{
+			end = (base + size);
+			break;
+		}
+	}
+
+	if (m_open)
+		close(end);
+}
+
+void Scanner::close(ea_t end)
+{
+	m_open = FALSE;
+	UINT64 length = (end - m_runStart);
+	if (length < m_options.minLength)
+		return;
+	if (m_options.skipCode && m_executable)
+		emitSkippingCode(m_runStart, end);
+	else
+		emit(m_runStart, length, m_runValue);
+}
+
+void Scanner::emit(ea_t start, UINT64 length, BYTE value)
+{
+	if (!idbAccess->isLoaded(start))
+		return;
+	while (length)
+	{
+		UINT64 piece = ((length < MAX_RUN) ? length : MAX_RUN);
+		m_runs.push_back({ start, (UINT32) piece, value });
+		start += piece;
+		length -= piece;
+		m_found++;
+	}
+}
+
+// Emit the parts of [start, end) that aren't in a code item, I.E. int3 or nop instructions
+void Scanner::emitSkippingCode(ea_t start, ea_t end)
+{
+	// Starting in an item tail, find its head
+	BOOL inCode = FALSE;
+	flags64_t flags = idbAccess->getFlags(start);
+	if (is_tail(flags))
+	{
+		for (ea_t ea = (start - 1), limit = ((start > 16) ? (start - 16) : 0); ea >= limit; ea--)
+		{
+			flags64_t headFlags = idbAccess->getFlags(ea);
+			if (!is_tail(headFlags))
+			{
+				inCode = is_code(headFlags);
+				break;
+			}
+			if (ea == 0)
+				break;
+		}
+	}
+
+	ea_t pieceStart = BADADDR;
+	for (ea_t ea = start; ea < end; ea++)
+	{
+		flags = ((ea == start) ? flags : idbAccess->getFlags(ea));
+		if (is_code(flags))
+			inCode = TRUE;
+		else
+		if (!is_tail(flags))
+			inCode = FALSE;
+
+		if (inCode)
+		{
+			if ((pieceStart != BADADDR) && ((ea - pieceStart) >= m_options.minLength))
+				emit(pieceStart, (ea - pieceStart), byteAt(pieceStart));
+			pieceStart = BADADDR;
+		}
+		else
+		if (pieceStart == BADADDR)
+			pieceStart = ea;
+	}
+	if ((pieceStart != BADADDR) && ((end - pieceStart) >= m_options.minLength))
+		emit(pieceStart, (end - pieceStart), byteAt(pieceStart));
+}
+
+
+static BOOL validOptions(const OPTIONS &options)
+{
+	return ((options.valueCount >= 1) && (options.valueCount <= MAX_VALUES) && (options.minLength >= 1));
+}
+
+static BOOL isExecutable(const IDB_SEGMENT &segment)
+{
+	return ((segment.perm & SEGPERM_EXEC) || (segment.type == SEG_CODE));
+}
+
+size_t FillerScan::scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<RUN> &runs)
+{
+	if (!validOptions(options))
+		return 0;
+
+	// Segments come in address order, so do the runs
+	Scanner scanner(options, runs);
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+		{
+			ea_t first = ((segment.start > start) ? segment.start : start);
+			ea_t last = ((segment.end < end) ? segment.end : end);
+			if (first < last)
+				scanner.scanSegment(first, last, isExecutable(segment));
+		}
+	}
+	return scanner.found();
+}
+
+size_t FillerScan::scanAll(const OPTIONS &options, __out std::vector<RUN> &runs)
+{
+	return scan(0, BADADDR, options, runs);
+}
+
+void FillerScan::queueAlign(const std::vector<RUN> &runs, IdbEditQueue &queue)
+{
+	for (const RUN &run: runs)
+	{
+		queue.delItems(run.start, DELIT_SIMPLE, run.length);
+		queue.createAlign(run.start, run.length, 0);
+	}
+}
+
+void FillerScan::queueUndefine(const std::vector<RUN> &runs, IdbEditQueue &queue)
+{
+	for (const RUN &run: runs)
+		queue.delItems(run.start, DELIT_SIMPLE, run.length);
+}
@@ -0,0 +1,48 @@
+
+// IDA utility support: SIMD filler run detection
+#pragma once
+
+#include <vector>
+
+class IdbEditQueue;
+
+// Finds maximal runs of padding/filler bytes (0xCC, 0x90, 0x00, etc.) like the alignment gaps between functions and
+// the zero fill in data segments, for cleanup passes that would otherwise walk get_byte().
+// Segment bytes are read in bulk through idbAccess and classified 64 at a time with SSE2 or AVX2 (runtime dispatch)
+// compares; only blocks with filler bytes take the scalar run tracking. Results are address sorted ranges ready to
+// queue as del_items() + create_align() edits.
+namespace FillerScan
+{
+	static const UINT32 MAX_VALUES = 4;
+
+	struct OPTIONS
+	{
+		BYTE values[MAX_VALUES];	// Filler byte values
+		UINT32 valueCount;
+		UINT32 minLength;			// Only emit runs at least this long
+		BOOL mixed;					// Runs may mix the values, else a run is one repeated value
+		BOOL skipCode;				// Split runs around code items in executable segments (I.E. int3/nop instructions)
+		BOOL noAvx2;				// Force the SSE2 path
+	};
+	inline OPTIONS defaultOptions() { return { { 0xCC, 0x90, 0x00, 0 }, 3, 8, FALSE, TRUE, FALSE }; }
+
+	struct RUN
+	{
+		ea_t start;
+		UINT32 length;
+		BYTE value;		// Filler value, the first byte's for a mixed run
+	};
+
+	// Scan the segment parts of [start, end), appending address sorted runs. Runs starting in unloaded bytes are
+	// dropped. Returns the count found.
+	size_t scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<RUN> &runs);
+
+	// Scan every segment
+	size_t scanAll(const OPTIONS &options, __out std::vector<RUN> &runs);
+
+	// Queue a del_items() then create_align() per run, commit with IdbEditQueue::commit()
+	void queueAlign(const std::vector<RUN> &runs, IdbEditQueue &queue);
+
+	// Queue just the del_items() per run, to undefine them
+	void queueUndefine(const std::vector<RUN> &runs, IdbEditQueue &queue);
+};
@@ -0,0 +1,418 @@
+
+// IDA utility support: Function fingerprint index
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <algorithm>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <funcs.hpp>
+#include <ua.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <Hash.h>
+#include <FingerprintIndex.h>
+
+static const UINT32 SECTION_HEADER = RESULT_CACHE_ID('F','P','H','D');
+static const UINT32 SECTION_ENTRIES = RESULT_CACHE_ID('F','P','E','N');
+static const UINT32 SECTION_BUCKETS = RESULT_CACHE_ID('F','P','B','K');
+static const UINT32 SECTION_EAS = RESULT_CACHE_ID('F','P','E','A');
+static const UINT32 SECTION_NAME_OFFSETS = RESULT_CACHE_ID('F','P','N','O');
+static const UINT32 SECTION_NAMES = RESULT_CACHE_ID('F','P','N','M');
+
+// Average entries per bucket is 2 to 4, up to a 64MB bucket table
+static const UINT32 MAX_BUCKET_BITS = 24;
+
+struct INDEX_HEADER
+{
+	UINT32 bucketBits, reserved;
+	UINT64 count, idCount;
+};
+
+// Library indexes aren't tied to an input file
+static const BYTE NO_INPUT_HASH[32] = {};
+
+typedef FingerprintIndex::ENTRY ENTRY;
+
+
+FingerprintIndex::FingerprintIndex()
+{
+	clear();
+}
+
+void FingerprintIndex::clear()
+{
+	m_reader.close();
+	std::vector<ENTRY>().swap(m_entryStore);
+	std::vector<UINT32>().swap(m_bucketStore);
+	std::vector<ea_t>().swap(m_eaStore);
+	std::vector<UINT32>().swap(m_nameOffsetStore);
+	std::vector<char>().swap(m_nameStore);
+	m_bucketBits = 1;
+	setView();
+}
+
+void FingerprintIndex::setView()
+{
+	m_entries = m_entryStore.data();
+	m_count = m_entryStore.size();
+	m_buckets = m_bucketStore.data();
+	m_eas = m_eaStore.data();
+	m_nameOffsets = m_nameOffsetStore.data();
+	m_names = m_nameStore.data();
+	m_idCount = m_eaStore.size();
+}
+
+// Bytes used in the name table, the last name is at the end
+size_t FingerprintIndex::namesSize() const
+{
+	return (m_idCount ? (m_nameOffsets[m_idCount - 1] + strlen(m_names + m_nameOffsets[m_idCount - 1]) + 1) : 0);
+}
+
+
+// ----------------------------------------------------------------------------
+
+// Mark the operand field at instruction offset 'offset', up to the next operand field or the instruction end
+static void maskField(const insn_t &insn, int offset, __inout BYTE *mask)
+{
+	if (offset <= 0)
+		return;
+	int end = insn.size;
+	for (int i = 0; (i < UA_MAXOP) && (insn.ops[i].type != o_void); i++)
+	{
+		int b = insn.ops[i].offb, o = insn.ops[i].offo;
+		if ((b > offset) && (b < end))
+			end = b;
+		if ((o > offset) && (o < end))
+			end = o;
+	}
+	for (int i = offset; i < end; i++)
+		mask[i] = 0xFF;
+}
+
+// Mask the address and immediate operand bytes of the items in [start, start + size).
+// Items are walked with idbAccess->nextHead().
+static UINT32 maskChunk(ea_t start, size_t size, BOOL maskImmediates, __inout BYTE *mask)
+{
+	UINT32 codeBytes = 0;
+	ea_t end = (start + size);
+	for (ea_t ea = start; ea < end; ea = idbAccess->nextHead(ea, end))
+	{
+		flags64_t flags = idbAccess->getFlags(ea);
+		if (!is_head(flags))
+			continue;
+		BYTE *itemMask = (mask + (ea - start));
+		if (is_code(flags))
+		{
+			insn_t insn;
+			int length = decode_insn(&insn, ea);
+			if ((length <= 0) || ((ea + length) > end))
+				continue;
+			codeBytes += length;
+
+			for (int n = 0; (n < UA_MAXOP) && (insn.ops[n].type != o_void); n++)
+			{
+				const op_t &op = insn.ops[n];
+				BOOL masked = FALSE;
+				switch (op.type)
+				{
+					case o_mem:
+					case o_near:
+					case o_far:
+					masked = TRUE;
+					break;
+
+					case o_imm:
+					masked = (maskImmediates || is_off(flags, n));
+					break;
+
+					case o_displ:
+					masked = is_off(flags, n);
+					break;
+				};
+
+				if (masked)
+				{
+					maskField(insn, op.offb, itemMask);
+					maskField(insn, op.offo, itemMask);
+				}
+			}
+		}
+		else
+		if (is_data(flags))
+		{
+			// Embedded pointers, I.E. switch jump tables: a pointer sized item, its tails then a non tail byte
+			ea_t itemEnd = (ea + plat.ptrSize);
+			BOOL pointerSized = ((itemEnd <= end) && !is_tail(idbAccess->getFlags(itemEnd)));
+			for (ea_t tail = (ea + 1); pointerSized && (tail < itemEnd); tail++)
+				pointerSized = is_tail(idbAccess->getFlags(tail));
+			if (pointerSized && IS_VALID_ADDR(plat.getEa(ea)))
+				memset(itemMask, 0xFF, plat.ptrSize);
+		}
+	}
+	return codeBytes;
+}
+
+BOOL FingerprintIndex::fingerprint(const func_t *pfn, BOOL maskImmediates, __out UINT64 &hash, __out UINT32 &size)
+{
+	hash = 0;
+	size = 0;
+	if (!pfn)
+		return FALSE;
+
+	std::vector<range_t> chunks;
+	func_tail_iterator_t fti((func_t *) pfn);
+	for (bool ok = fti.first(); ok; ok = fti.next())
+		chunks.push_back(fti.chunk());
+	std::sort(chunks.begin(), chunks.end(), [](const range_t &a, const range_t &b) { return (a.start_ea < b.start_ea); });
+
+	// Hash masked bytes then the mask, so masked bytes don't collide with real zeros
+	Hash::Stream bytes, masks(1);
+	std::vector<BYTE> buffer, mask;
+	UINT32 codeBytes = 0;
+	for (const range_t &chunk: chunks)
+	{
+		if (chunk.end_ea <= chunk.start_ea)
+			continue;
+		size_t chunkSize = (size_t) (chunk.end_ea - chunk.start_ea);
+		buffer.resize(chunkSize);
+		mask.assign(chunkSize, 0);
+		// A fingerprint of part of the body would be wrong, not just weaker
+		if (idbAccess->getBytes(buffer.data(), chunkSize, chunk.start_ea) != (ssize_t) chunkSize)
+			return FALSE;
+
+		codeBytes += maskChunk(chunk.start_ea, chunkSize, maskImmediates, mask.data());
+		for (size_t i = 0; i < chunkSize; i++)
+			buffer[i] &= ~mask[i];
+		bytes.update(buffer.data(), chunkSize);
+		masks.update(mask.data(), chunkSize);
+		size += (UINT32) chunkSize;
+	}
+	if (!codeBytes)
+		return FALSE;
+
+	UINT64 digests[2] = { bytes.digest64(), masks.digest64() };
+	hash = Hash::hash64(digests, sizeof(digests));
+	return TRUE;
+}
+
+size_t FingerprintIndex::build(const OPTIONS &options)
+{
+	clear();
+	qstring name;
+	size_t count = get_func_qty();
+	m_entryStore.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		func_t *pfn = getn_func(i);
+		if (!pfn || (options.skipThunks && (pfn->flags & FUNC_THUNK)))
+			continue;
+
+		UINT64 hash;
+		UINT32 size;
+		if (fingerprint(pfn, options.maskImmediates, hash, size) && (size >= options.minSize))
+		{
+			if (get_func_name(&name, pfn->start_ea) <= 0)
+				name.clear();
+			add(hash, size, pfn->start_ea, name.c_str());
+		}
+	}
+	finalize();
+	return m_count;
+}
+
+
+// ----------------------------------------------------------------------------
+
+UINT32 FingerprintIndex::add(UINT64 hash, UINT32 size, ea_t ea, LPCSTR name)
+{
+	// Adding to a loaded index, copy it out of the file view first
+	if (m_reader.isOpen())
+	{
+		m_entryStore.assign(m_entries, (m_entries + m_count));
+		m_eaStore.assign(m_eas, (m_eas + m_idCount));
+		m_nameOffsetStore.assign(m_nameOffsets, (m_nameOffsets + m_idCount));
+		m_nameStore.assign(m_names, (m_names + namesSize()));
+		m_bucketStore.assign(m_buckets, (m_buckets + ((size_t) (1u << m_bucketBits) + 1)));
+		m_reader.close();
+	}
+
+	UINT32 id = (UINT32) m_eaStore.size();
+	m_entryStore.push_back({ hash, size, id });
+	m_eaStore.push_back(ea);
+	m_nameOffsetStore.push_back((UINT32) m_nameStore.size());
+	m_nameStore.insert(m_nameStore.end(), name, (name + (strlen(name) + 1)));
+	setView();
+	return id;
+}
+
+void FingerprintIndex::append(const FingerprintIndex &other)
+{
+	_ASSERT(&other != this);
+	m_entryStore.reserve(m_entryStore.size() + other.m_count);
+	for (size_t i = 0; i < other.m_count; i++)
+	{
+		const ENTRY &e = other.m_entries[i];
+		add(e.hash, e.size, other.ea(e.id), other.name(e.id));
+	}
+}
+
+void FingerprintIndex::finalize()
+{
+	std::sort(m_entryStore.begin(), m_entryStore.end(), [](const ENTRY &a, const ENTRY &b)
+	{
+		if (a.hash != b.hash) return (a.hash < b.hash);
+		return (a.id < b.id);
+	});
+
+	size_t count = m_entryStore.size();
+	m_bucketBits = 1;
+	while ((m_bucketBits < MAX_BUCKET_BITS) && (((size_t) 1 << (m_bucketBits + 2)) < count))
+		m_bucketBits++;
+
+	// Bucket start offsets, plus an end sentinel
+	UINT32 buckets = (1u << m_bucketBits);
+	m_bucketStore.resize(buckets + 1);
+	size_t i = 0;
+	for (UINT32 b = 0; b < buckets; b++)
+	{
+		while ((i < count) && (bucket(m_entryStore[i].hash) < b))
+			i++;
+		m_bucketStore[b] = (UINT32) i;
+	}
+	m_bucketStore[buckets] = (UINT32) count;
+	setView();
+}
+
+
+// ----------------------------------------------------------------------------
+
+BOOL FingerprintIndex::save(LPCSTR path)
+{
+	if (!m_reader.isOpen())
+		finalize();
+
+	INDEX_HEADER header = { m_bucketBits, 0, m_count, m_idCount };
+
+	ResultCache::Writer writer(FINGERPRINT_VERSION);
+	writer.addArray(SECTION_HEADER, &header, 1);
+	writer.addArray(SECTION_ENTRIES, m_entries, m_count);
+	writer.addArray(SECTION_BUCKETS, m_buckets, ((size_t) (1u << m_bucketBits) + 1));
+	writer.addArray(SECTION_EAS, m_eas, m_idCount);
+	writer.addArray(SECTION_NAME_OFFSETS, m_nameOffsets, m_idCount);
+	writer.addArray(SECTION_NAMES, m_names, namesSize());
+	return writer.save(path, NO_INPUT_HASH);
+}
+
+ResultCache::STATUS FingerprintIndex::load(LPCSTR path)
+{
+	clear();
+	ResultCache::STATUS status = m_reader.open(path, FINGERPRINT_VERSION, NULL);
+	if (status != ResultCache::CACHE_OK)
+		return status;
+
+	size_t headerCount = 0, count = 0, bucketCount = 0, eaCount = 0, offsetCount = 0, namesSize = 0;
+	const INDEX_HEADER *header = m_reader.array<INDEX_HEADER>(SECTION_HEADER, headerCount);
+	const ENTRY *entries = m_reader.array<ENTRY>(SECTION_ENTRIES, count);
+	const UINT32 *buckets = m_reader.array<UINT32>(SECTION_BUCKETS, bucketCount);
+	const ea_t *eas = m_reader.eaArray(SECTION_EAS, eaCount);
+	const UINT32 *nameOffsets = m_reader.array<UINT32>(SECTION_NAME_OFFSETS, offsetCount);
+	const char *names = m_reader.array<char>(SECTION_NAMES, namesSize);
+
+	BOOL valid = (header && (headerCount == 1) && (header->bucketBits >= 1) && (header->bucketBits <= MAX_BUCKET_BITS) &&
+				  (header->count == count) && (header->idCount == eaCount) && (eaCount == offsetCount) &&
+				  buckets && (bucketCount == ((size_t) (1u << header->bucketBits) + 1)) && (buckets[bucketCount - 1] == count) &&
+				  (!count || entries) && (!eaCount || (eas && names && namesSize && (names[namesSize - 1] == 0))));
+	for (size_t i = 0; valid && (i < offsetCount); i++)
+		valid = (nameOffsets[i] < namesSize);
+	for (size_t i = 0; valid && (i < count); i++)
+		valid = (entries[i].id < eaCount);
+	if (!valid)
+	{
+		clear();
+		return ResultCache::CACHE_CORRUPT;
+	}
+
+	m_entries = entries;
+	m_count = count;
+	m_buckets = buckets;
+	m_bucketBits = header->bucketBits;
+	m_eas = eas;
+	m_nameOffsets = nameOffsets;
+	m_names = names;
+	m_idCount = eaCount;
+	return ResultCache::CACHE_OK;
+}
+
+
+// ----------------------------------------------------------------------------
+
+const ENTRY *FingerprintIndex::find(UINT64 hash, __out size_t &count) const
+{
+	count = 0;
+	if (!m_count)
+		return NULL;
+
+	UINT32 b = bucket(hash);
+	const ENTRY *first = (m_entries + m_buckets[b]), *last = (m_entries + m_buckets[b + 1]);
+	while ((first < last) && (first->hash < hash))
+		first++;
+	const ENTRY *e = first;
+	while ((e < last) && (e->hash == hash))
+		e++;
+	count = (e - first);
+	return (count ? first : NULL);
+}
+
+size_t FingerprintIndex::match(const FingerprintIndex &queries, __out std::vector<MATCH> &matches) const
+{
+	size_t matched = 0;
+	if (!m_count)
+		return 0;
+
+	// Both sides are hash sorted, so the table position only moves forward
+	const ENTRY *q = queries.m_entries, *qEnd = (q + queries.m_count);
+	size_t position = 0;
+	while (q < qEnd)
+	{
+		UINT64 hash = q->hash;
+		const ENTRY *qGroup = q;
+		while ((q < qEnd) && (q->hash == hash))
+			q++;
+
+		UINT32 b = bucket(hash);
+		size_t i = m_buckets[b], last = m_buckets[b + 1];
+		if (i < position)
+			i = position;
+		while ((i < last) && (m_entries[i].hash < hash))
+			i++;
+		position = i;
+
+		size_t j = i;
+		while ((j < last) && (m_entries[j].hash == hash))
+			j++;
+		if (j > i)
+		{
+			matched += (q - qGroup);
+			for (const ENTRY *g = qGroup; g < q; g++)
+			{
+				for (size_t k = i; k < j; k++)
+					matches.push_back({ (UINT32) (g - queries.m_entries), (UINT32) k });
+			}
+		}
+	}
+	return matched;
+}
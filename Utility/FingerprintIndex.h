@@ -0,0 +1,104 @@
+
+// IDA utility support: Function fingerprint index
+#pragma once
+
+#include <vector>
+#include <ResultCache.h>
+
+struct func_t;
+
+// Position independent function fingerprints for duplicate and known library function detection.
+// A fingerprint is a Hash::hash64() of the function's bytes, chunks in address order, with the operand fields that
+// hold addresses (memory, branch targets, offsets) and optionally immediates masked out, plus the mask itself.
+// Data items inside the function that getEa() to a valid address are masked too (jump tables).
+// Entries live in a flat hash sorted table with a top bits bucket index, so a lookup is one bucket read and a short
+// scan, and a bulk query is a merge-join of the sorted queries against the table. Library indexes are saved with
+// ResultCache and load memory mapped, zero copy. Call plat.Configure() before building.
+class FingerprintIndex
+{
+public:
+	// Bump when the fingerprint bytes change, old index files are then rejected as stale
+	static const UINT32 FINGERPRINT_VERSION = 1;
+
+	struct ENTRY
+	{
+		UINT64 hash;
+		UINT32 size;	// Function bytes
+		UINT32 id;		// Function ID, for ea() and name()
+	};
+
+	struct OPTIONS
+	{
+		UINT32 minSize;			// Skip functions smaller than this, tiny ones match everything
+		BOOL maskImmediates;	// Mask all immediates, else only ones that are offsets
+		BOOL skipThunks;		// Skip FUNC_THUNK functions
+	};
+	static OPTIONS defaultOptions() { return { 16, TRUE, TRUE }; }
+
+	// Bulk query result, indexes into the query and this index's entries()
+	struct MATCH
+	{
+		UINT32 query, entry;
+	};
+
+	FingerprintIndex();
+
+	// Fingerprint a function of the current IDB, read through idbAccess. Returns FALSE if it has no code bytes or a
+	// read comes up short.
+	static BOOL fingerprint(const func_t *pfn, BOOL maskImmediates, __out UINT64 &hash, __out UINT32 &size);
+
+	// Build from every function of the current IDB, replacing the contents. Returns the entry count.
+	size_t build(const OPTIONS &options);
+
+	// Stage an entry, returns its ID. Call finalize() after adding.
+	UINT32 add(UINT64 hash, UINT32 size, ea_t ea, LPCSTR name);
+	// Stage all the entries of another index, I.E. to merge per library indexes into one corpus
+	void append(const FingerprintIndex &other);
+	// Sort and bucket index the staged entries
+	void finalize();
+	void clear();
+
+	// Library index file, not keyed to an input file
+	BOOL save(LPCSTR path);
+	ResultCache::STATUS load(LPCSTR path);
+
+	// Entries matching 'hash', or NULL
+	const ENTRY *find(UINT64 hash, __out size_t &count) const;
+
+	// Every entry of 'queries' found in this index, grouped by hash. Duplicate hashes on either side give every
+	// pairing. Returns the number of query entries that matched.
+	size_t match(const FingerprintIndex &queries, __out std::vector<MATCH> &matches) const;
+
+	// Hash sorted, duplicate functions are adjacent
+	const ENTRY *entries() const { return m_entries; }
+	size_t size() const { return m_count; }
+
+	ea_t ea(UINT32 id) const { return ((id < m_idCount) ? m_eas[id] : BADADDR); }
+	LPCSTR name(UINT32 id) const { return ((id < m_idCount) ? (m_names + m_nameOffsets[id]) : ""); }
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(FingerprintIndex);
+
+	void setView();
+	size_t namesSize() const;
+	UINT32 bucket(UINT64 hash) const { return (UINT32) (hash >> (64 - m_bucketBits)); }
+
+	// Built or staged contents
+	std::vector<ENTRY> m_entryStore;
+	std::vector<UINT32> m_bucketStore;
+	std::vector<ea_t> m_eaStore;
+	std::vector<UINT32> m_nameOffsetStore;
+	std::vector<char> m_nameStore;
+
+	// Loaded contents
+	ResultCache::Reader m_reader;
+
+	// Current view, into the stores or the mapped file
+	const ENTRY *m_entries;
+	const UINT32 *m_buckets;
+	const ea_t *m_eas;
+	const UINT32 *m_nameOffsets;
+	const char *m_names;
+	size_t m_count, m_idCount;
+	UINT32 m_bucketBits;
+};
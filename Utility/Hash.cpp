@@ -0,0 +1,642 @@
+
+// IDA utility support: Fast byte range hashing
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+#include <algorithm>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <funcs.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <Hash.h>
+
+using namespace Hash;
+
+// Database bytes read per getBytes() call, on the stack
+static const size_t RANGE_CHUNK = (16 * 1024);
+
+// setBaseline(), skip the SSE4.2 and AVX2 paths
+static BOOL baselineOnly = FALSE;
+
+void Hash::setBaseline(BOOL baseline) { baselineOnly = baseline; }
+
+// ----------------------------------------------------------------------------
+// CRC32C
+
+static const UINT32 CRC32C_POLY = 0x82F63B78;	// Reflected Castagnoli
+
+// Bytes per stream of the interleaved SSE4.2 loop. CRC32 has a three cycle latency and one per cycle throughput,
+// so three independent streams keep the unit busy; they're joined by shifting with the LANE_SHIFT tables.
+static const size_t LANE_SIZE = 1024;
+
+static struct CRC_TABLES
+{
+	UINT32 slice[8][256];		// Slicing-by-8
+	UINT32 laneShift[4][256];	// Register advanced over LANE_SIZE zero bytes, per register byte
+
+	CRC_TABLES()
+	{
+		for (UINT32 i = 0; i < 256; i++)
+		{
+			UINT32 crc = i;
+			for (int j = 0; j < 8; j++)
+				crc = ((crc & 1) ? ((crc >> 1) ^ CRC32C_POLY) : (crc >> 1));
+			slice[0][i] = crc;
+		}
+		for (UINT32 i = 0; i < 256; i++)
+		{
+			for (int k = 1; k < 8; k++)
+				slice[k][i] = ((slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xFF]);
+		}
+
+		// x^(8 * LANE_SIZE) mod P, then the shift is a carryless multiply by it
+		UINT32 shift = 0x80000000;
+		for (size_t i = 0; i < LANE_SIZE; i++)
+			shift = ((shift >> 8) ^ slice[0][shift & 0xFF]);
+		for (UINT32 k = 0; k < 4; k++)
+		{
+			for (UINT32 i = 0; i < 256; i++)
+				laneShift[k][i] = multiply(shift, (i << (k * 8)));
+		}
+	}
+
+	// Multiply modulo P in the reflected domain
+	static UINT32 multiply(UINT32 a, UINT32 b)
+	{
+		UINT32 product = 0;
+		for (UINT32 m = 0x80000000; m; m >>= 1)
+		{
+			if (a & m)
+				product ^= b;
+			b = ((b & 1) ? ((b >> 1) ^ CRC32C_POLY) : (b >> 1));
+		}
+		return product;
+	}
+} crcTables;
+
+static inline UINT32 laneShift(UINT32 crc)
+{
+	return (crcTables.laneShift[0][crc & 0xFF] ^ crcTables.laneShift[1][(crc >> 8) & 0xFF] ^
+			crcTables.laneShift[2][(crc >> 16) & 0xFF] ^ crcTables.laneShift[3][crc >> 24]);
+}
+
+static UINT32 crcSlice8(UINT32 crc, const BYTE *p, size_t size)
+{
+	const UINT32 (&t)[8][256] = crcTables.slice;
+	for (; size >= 8; p += 8, size -= 8)
+	{
+		UINT64 v;
+		memcpy(&v, p, sizeof(v));
+		v ^= crc;
+		crc = (t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^
+			   t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56]);
+	}
+	for (; size; p++, size--)
+		crc = ((crc >> 8) ^ t[0][(crc ^ *p) & 0xFF]);
+	return crc;
+}
+
+TARGET_SSE42 static UINT32 crcSse42(UINT32 crc, const BYTE *p, size_t size)
+{
+	UINT64 c0 = crc;
+	for (; size >= (LANE_SIZE * 3); p += (LANE_SIZE * 3), size -= (LANE_SIZE * 3))
+	{
+		UINT64 c1 = 0, c2 = 0;
+		for (size_t i = 0; i < LANE_SIZE; i += 8)
+		{
+			UINT64 v0, v1, v2;
+			memcpy(&v0, (p + i), 8);
+			memcpy(&v1, (p + LANE_SIZE + i), 8);
+			memcpy(&v2, (p + (LANE_SIZE * 2) + i), 8);
+			c0 = _mm_crc32_u64(c0, v0);
+			c1 = _mm_crc32_u64(c1, v1);
+			c2 = _mm_crc32_u64(c2, v2);
+		}
+		c0 = (laneShift(laneShift((UINT32) c0) ^ (UINT32) c1) ^ (UINT32) c2);
+	}
+	for (; size >= 8; p += 8, size -= 8)
+	{
+		UINT64 v;
+		memcpy(&v, p, 8);
+		c0 = _mm_crc32_u64(c0, v);
+	}
+	crc = (UINT32) c0;
+	for (; size; p++, size--)
+		crc = _mm_crc32_u8(crc, *p);
+	return crc;
+}
+
+UINT32 Hash::crc32c(LPCVOID data, size_t size, UINT32 crc)
+{
+	if (!baselineOnly && cpuHasSse42())
+		return ~crcSse42(~crc, (const BYTE *) data, size);
+	else
+		return ~crcSlice8(~crc, (const BYTE *) data, size);
+}
+
+
+// ----------------------------------------------------------------------------
+// XXH3 style 64/128bit hash
+// Inputs up to 240 bytes take dedicated short paths. Longer ones run eight 64bit accumulator lanes over 64 byte
+// stripes, keyed with a sliding window of the secret, scrambling the lanes every BLOCK_STRIPES stripes.
+
+static const size_t STRIPE_SIZE = 64;
+static const size_t SECRET_SIZE = Stream::SECRET_SIZE;
+static const size_t BLOCK_STRIPES = ((SECRET_SIZE - STRIPE_SIZE) / 8);
+static const size_t BLOCK_SIZE = (BLOCK_STRIPES * STRIPE_SIZE);
+static const size_t SHORT_MAX = 240;
+static const size_t LAST_STRIPE_KEY = (SECRET_SIZE - STRIPE_SIZE - 7);
+static const size_t SHORT_HI_KEY = 56;	// Secret offset of the short path high half, keeps reads inside the secret
+
+static const UINT32 PRIME32_1 = 0x9E3779B1, PRIME32_2 = 0x85EBCA77, PRIME32_3 = 0xC2B2AE3D;
+static const UINT64 PRIME64_1 = 0x9E3779B185EBCA87ull, PRIME64_2 = 0xC2B2AE3D27D4EB4Full, PRIME64_3 = 0x165667B19E3779F9ull;
+static const UINT64 PRIME64_4 = 0x85EBCA77C2B2AE63ull, PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+// Fixed random key material
+ALIGN(32) static const UINT64 SECRET[SECRET_SIZE / 8] =
+{
+	0x471BF7A9DB494BA9ull, 0xE088AA697BE0A242ull, 0x0ED8CAE10B79D863ull, 0xA2CC44A52313485Eull,
+	0x9F5AED38E909BD69ull, 0x4C4C938A4345AE18ull, 0xAC0B62DE5E418B1Aull, 0xD66338D10EE9D74Eull,
+	0x01935492458A9A15ull, 0x84E79F8D099FD617ull, 0x8A15F4342408F653ull, 0x69EC2093FBB8694Cull,
+	0x176757FAF30C6ECDull, 0x27E29B6ED6A580F1ull, 0xF1135E0B1562278Bull, 0x038C275EEE86905Aull,
+	0x913230F292149C71ull, 0x29591B7AD77095F1ull, 0xED19A32A4052F90Bull, 0x76CFA545312354EDull,
+	0x5B2621A9482F6EF6ull, 0xB630F0E79713FDF5ull, 0x926B244447A3518Cull, 0xA0477FC72DC65C13ull,
+};
+static const BYTE *defaultSecret = (const BYTE *) SECRET;
+
+static inline UINT64 read64(const BYTE *p) { UINT64 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline UINT32 read32(const BYTE *p) { UINT32 v; memcpy(&v, p, sizeof(v)); return v; }
+
+static inline UINT64 mulFold64(UINT64 a, UINT64 b)
+{
+	UINT64 hi;
+	UINT64 lo = _umul128(a, b, &hi);
+	return (lo ^ hi);
+}
+
+static inline UINT64 avalanche(UINT64 h)
+{
+	h ^= (h >> 37);
+	h *= 0x165667919E3779F9ull;
+	return (h ^ (h >> 32));
+}
+
+static inline UINT64 avalanche64(UINT64 h)
+{
+	h ^= (h >> 33);
+	h *= PRIME64_2;
+	h ^= (h >> 29);
+	h *= PRIME64_3;
+	return (h ^ (h >> 32));
+}
+
+static inline UINT64 mix16(const BYTE *p, const BYTE *key, UINT64 seed)
+{
+	return mulFold64((read64(p) ^ (read64(key) + seed)), (read64(p + 8) ^ (read64(key + 8) - seed)));
+}
+
+// Inputs up to SHORT_MAX bytes
+static UINT64 hashShort(const BYTE *p, size_t size, const BYTE *secret, UINT64 seed)
+{
+	if (size <= 16)
+	{
+		if (size > 8)
+		{
+			UINT64 lo = (read64(p) ^ ((read64(secret + 24) ^ read64(secret + 32)) + seed));
+			UINT64 hi = (read64(p + size - 8) ^ ((read64(secret + 40) ^ read64(secret + 48)) - seed));
+			return avalanche(size + _byteswap_uint64(lo) + hi + mulFold64(lo, hi));
+		}
+		else
+		if (size >= 4)
+		{
+			seed ^= ((UINT64) _byteswap_ulong((UINT32) seed) << 32);
+			UINT64 value = (((UINT64) read32(p) << 32) + read32(p + size - 4));
+			UINT64 h = (value ^ ((read64(secret + 8) ^ read64(secret + 16)) - seed));
+			h ^= (_rotl64(h, 49) ^ _rotl64(h, 24));
+			h *= 0x9FB21C651E98DF25ull;
+			h ^= ((h >> 35) + size);
+			h *= 0x9FB21C651E98DF25ull;
+			return (h ^ (h >> 28));
+		}
+		else
+		if (size)
+		{
+			UINT32 combined = (((UINT32) p[0] << 16) | ((UINT32) p[size >> 1] << 24) | (UINT32) p[size - 1] | ((UINT32) size << 8));
+			return avalanche64(combined ^ ((UINT64) (read32(secret) ^ read32(secret + 4)) + seed));
+		}
+		else
+			return avalanche64(seed ^ read64(secret + 56) ^ read64(secret + 64));
+	}
+	else
+	if (size <= 128)
+	{
+		UINT64 acc = (size * PRIME64_1);
+		if (size > 32)
+		{
+			if (size > 64)
+			{
+				if (size > 96)
+				{
+					acc += mix16((p + 48), (secret + 96), seed);
+					acc += mix16((p + size - 64), (secret + 112), seed);
+				}
+				acc += mix16((p + 32), (secret + 64), seed);
+				acc += mix16((p + size - 48), (secret + 80), seed);
+			}
+			acc += mix16((p + 16), (secret + 32), seed);
+			acc += mix16((p + size - 32), (secret + 48), seed);
+		}
+		acc += mix16(p, secret, seed);
+		acc += mix16((p + size - 16), (secret + 16), seed);
+		return avalanche(acc);
+	}
+	else
+	{
+		UINT64 acc = (size * PRIME64_1);
+		size_t rounds = (size / 16);
+		for (size_t i = 0; i < 8; i++)
+			acc += mix16((p + (i * 16)), (secret + (i * 16)), seed);
+		acc = avalanche(acc);
+		for (size_t i = 8; i < rounds; i++)
+			acc += mix16((p + (i * 16)), (secret + ((i - 8) * 16) + 3), seed);
+		acc += mix16((p + size - 16), (secret + 119), seed);
+		return avalanche(acc);
+	}
+}
+
+// Accumulate 'stripes' stripes, keyed from the secret 8 bytes further per stripe:
+// acc[i ^ 1] += data[i], acc[i] += lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i])
+typedef void (*ACCUMULATE)(UINT64 *acc, const BYTE *p, const BYTE *key, size_t stripes);
+// acc[i] = ((acc[i] ^ (acc[i] >> 47) ^ key[i]) * PRIME32_1)
+typedef void (*SCRAMBLE)(UINT64 *acc, const BYTE *key);
+
+static void accumulateSse2(UINT64 *acc, const BYTE *p, const BYTE *key, size_t stripes)
+{
+	__m128i a[4];
+	for (int i = 0; i < 4; i++)
+		a[i] = _mm_loadu_si128((const __m128i *) (acc + (i * 2)));
+	for (size_t s = 0; s < stripes; s++, p += STRIPE_SIZE, key += 8)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i *) (p + (i * 16)));
+			__m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i *) (key + (i * 16))));
+			__m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+			a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+	}
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_si128((__m128i *) (acc + (i * 2)), a[i]);
+}
+
+static void scrambleSse2(UINT64 *acc, const BYTE *key)
+{
+	const __m128i prime = _mm_set1_epi32((int) PRIME32_1);
+	for (int i = 0; i < 4; i++)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) (acc + (i * 2)));
+		a = _mm_xor_si128(_mm_xor_si128(a, _mm_srli_epi64(a, 47)), _mm_loadu_si128((const __m128i *) (key + (i * 16))));
+		__m128i lo = _mm_mul_epu32(a, prime);
+		__m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+		_mm_storeu_si128((__m128i *) (acc + (i * 2)), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+	}
+}
+
+TARGET_AVX2 static void accumulateAvx2(UINT64 *acc, const BYTE *p, const BYTE *key, size_t stripes)
+{
+	__m256i a0 = _mm256_loadu_si256((const __m256i *) acc);
+	__m256i a1 = _mm256_loadu_si256((const __m256i *) (acc + 4));
+	for (size_t s = 0; s < stripes; s++, p += STRIPE_SIZE, key += 8)
+	{
+		__m256i d0 = _mm256_loadu_si256((const __m256i *) p);
+		__m256i d1 = _mm256_loadu_si256((const __m256i *) (p + 32));
+		__m256i dk0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i *) key));
+		__m256i dk1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i *) (key + 32)));
+		__m256i product0 = _mm256_mul_epu32(dk0, _mm256_shuffle_epi32(dk0, _MM_SHUFFLE(0, 3, 0, 1)));
+		__m256i product1 = _mm256_mul_epu32(dk1, _mm256_shuffle_epi32(dk1, _MM_SHUFFLE(0, 3, 0, 1)));
+		a0 = _mm256_add_epi64(a0, _mm256_add_epi64(product0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+		a1 = _mm256_add_epi64(a1, _mm256_add_epi64(product1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+	}
+	_mm256_storeu_si256((__m256i *) acc, a0);
+	_mm256_storeu_si256((__m256i *) (acc + 4), a1);
+}
+
+TARGET_AVX2 static void scrambleAvx2(UINT64 *acc, const BYTE *key)
+{
+	const __m256i prime = _mm256_set1_epi32((int) PRIME32_1);
+	for (int i = 0; i < 2; i++)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *) (acc + (i * 4)));
+		a = _mm256_xor_si256(_mm256_xor_si256(a, _mm256_srli_epi64(a, 47)), _mm256_loadu_si256((const __m256i *) (key + (i * 32))));
+		__m256i lo = _mm256_mul_epu32(a, prime);
+		__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+		_mm256_storeu_si256((__m256i *) (acc + (i * 4)), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+	}
+}
+
+struct LONG_FUNCS
+{
+	ACCUMULATE accumulate;
+	SCRAMBLE scramble;
+};
+
+static inline LONG_FUNCS longFuncs()
+{
+	if (!baselineOnly && cpuHasAvx2())
+		return { accumulateAvx2, scrambleAvx2 };
+	else
+		return { accumulateSse2, scrambleSse2 };
+}
+
+static inline void initAcc(UINT64 *acc)
+{
+	acc[0] = PRIME32_3; acc[1] = PRIME64_1; acc[2] = PRIME64_2; acc[3] = PRIME64_3;
+	acc[4] = PRIME64_4; acc[5] = PRIME32_2; acc[6] = PRIME64_5; acc[7] = PRIME32_1;
+}
+
+// Seeded secret for inputs over SHORT_MAX
+static void deriveSecret(__out BYTE *secret, UINT64 seed)
+{
+	for (size_t i = 0; i < (SECRET_SIZE / 8); i += 2)
+	{
+		UINT64 even = (SECRET[i] + seed), odd = (SECRET[i + 1] - seed);
+		memcpy((secret + (i * 8)), &even, 8);
+		memcpy((secret + ((i + 1) * 8)), &odd, 8);
+	}
+}
+
+// Accumulate stripes continuing at stripe 'stripe' of the current block, scrambling at block ends
+static void accumulateStripes(const LONG_FUNCS &f, UINT64 *acc, __inout size_t &stripe, const BYTE *p, size_t stripes, const BYTE *secret)
+{
+	while (stripes)
+	{
+		size_t count = (BLOCK_STRIPES - stripe);
+		if (count > stripes)
+			count = stripes;
+		f.accumulate(acc, p, (secret + (stripe * 8)), count);
+		p += (count * STRIPE_SIZE);
+		stripes -= count;
+		stripe += count;
+		if (stripe == BLOCK_STRIPES)
+		{
+			f.scramble(acc, (secret + (SECRET_SIZE - STRIPE_SIZE)));
+			stripe = 0;
+		}
+	}
+}
+
+static UINT64 mergeAcc(const UINT64 *acc, const BYTE *key, UINT64 start)
+{
+	UINT64 h = start;
+	for (int i = 0; i < 4; i++)
+		h += mulFold64((acc[i * 2] ^ read64(key + (i * 16))), (acc[(i * 2) + 1] ^ read64(key + (i * 16) + 8)));
+	return avalanche(h);
+}
+
+static inline UINT64 finish64(const UINT64 *acc, const BYTE *secret, UINT64 total)
+{
+	return mergeAcc(acc, (secret + 11), (total * PRIME64_1));
+}
+
+static inline HASH128 finish128(const UINT64 *acc, const BYTE *secret, UINT64 total)
+{
+	return { mergeAcc(acc, (secret + 11), (total * PRIME64_1)), mergeAcc(acc, (secret + (SECRET_SIZE - STRIPE_SIZE - 11)), ~(total * PRIME64_2)) };
+}
+
+// Inputs over SHORT_MAX, leaves the final accumulator state in 'acc'
+static void hashLong(__out UINT64 *acc, const BYTE *p, size_t size, const BYTE *secret)
+{
+	// The last stripe is always the final 64 bytes, so whole blocks and stripes stop short of the last byte
+	LONG_FUNCS f = longFuncs();
+	initAcc(acc);
+	size_t stripe = 0;
+	accumulateStripes(f, acc, stripe, p, ((size - 1) / STRIPE_SIZE), secret);
+	f.accumulate(acc, (p + size - STRIPE_SIZE), (secret + LAST_STRIPE_KEY), 1);
+}
+
+UINT64 Hash::hash64(LPCVOID data, size_t size, UINT64 seed)
+{
+	const BYTE *p = (const BYTE *) data;
+	if (size <= SHORT_MAX)
+		return hashShort(p, size, defaultSecret, seed);
+
+	ALIGN(32) BYTE seeded[SECRET_SIZE];
+	const BYTE *secret = defaultSecret;
+	if (seed)
+	{
+		deriveSecret(seeded, seed);
+		secret = seeded;
+	}
+	ALIGN(32) UINT64 acc[8];
+	hashLong(acc, p, size, secret);
+	return finish64(acc, secret, size);
+}
+
+HASH128 Hash::hash128(LPCVOID data, size_t size, UINT64 seed)
+{
+	const BYTE *p = (const BYTE *) data;
+	if (size <= SHORT_MAX)
+		return { hashShort(p, size, defaultSecret, seed), hashShort(p, size, (defaultSecret + SHORT_HI_KEY), seed) };
+
+	ALIGN(32) BYTE seeded[SECRET_SIZE];
+	const BYTE *secret = defaultSecret;
+	if (seed)
+	{
+		deriveSecret(seeded, seed);
+		secret = seeded;
+	}
+	ALIGN(32) UINT64 acc[8];
+	hashLong(acc, p, size, secret);
+	return finish128(acc, secret, size);
+}
+
+
+// ----------------------------------------------------------------------------
+// Streaming
+// The buffer only gets consumed when more input follows it, so at digest time it holds the final 1 to BUFFER_SIZE
+// bytes, or all of a short input. BUFFER_SIZE is a whole number of stripes and divides BLOCK_SIZE so consumed
+// stripes scramble at the same points as the one shot hashLong().
+
+static_assert(((Stream::BUFFER_SIZE % STRIPE_SIZE) == 0) && ((BLOCK_SIZE % Stream::BUFFER_SIZE) == 0) && (Stream::BUFFER_SIZE > SHORT_MAX), "Stream::BUFFER_SIZE");
+
+void Stream::reset(UINT64 seed)
+{
+	initAcc(m_acc);
+	if (seed)
+		deriveSecret(m_secret, seed);
+	else
+		memcpy(m_secret, SECRET, SECRET_SIZE);
+	m_seed = seed;
+	m_total = 0;
+	m_bufferSize = m_stripes = 0;
+}
+
+// Consume whole stripes
+void Stream::consume(const BYTE *p, size_t size)
+{
+	_ASSERT(size && ((size % STRIPE_SIZE) == 0));
+	accumulateStripes(longFuncs(), m_acc, m_stripes, p, (size / STRIPE_SIZE), m_secret);
+	memcpy(m_last, (p + size - sizeof(m_last)), sizeof(m_last));
+}
+
+void Stream::update(LPCVOID data, size_t size)
+{
+	const BYTE *p = (const BYTE *) data;
+	m_total += size;
+	if ((m_bufferSize + size) <= BUFFER_SIZE)
+	{
+		memcpy((m_buffer + m_bufferSize), p, size);
+		m_bufferSize += size;
+		return;
+	}
+
+	// Top off and consume the buffer, input is left over
+	if (m_bufferSize)
+	{
+		size_t fill = (BUFFER_SIZE - m_bufferSize);
+		memcpy((m_buffer + m_bufferSize), p, fill);
+		p += fill;
+		size -= fill;
+		consume(m_buffer, BUFFER_SIZE);
+	}
+
+	// Consume directly from the input, keeping the tail
+	if (size > BUFFER_SIZE)
+	{
+		size_t direct = (((size - 1) / BUFFER_SIZE) * BUFFER_SIZE);
+		consume(p, direct);
+		p += direct;
+		size -= direct;
+	}
+	memcpy(m_buffer, p, size);
+	m_bufferSize = size;
+}
+
+// Finish a copy of the accumulators with the buffered tail
+static void finishLong(__inout UINT64 *acc, size_t stripe, const BYTE *buffer, size_t bufferSize, const BYTE *last, const BYTE *secret)
+{
+	LONG_FUNCS f = longFuncs();
+	const BYTE *lastStripe;
+	BYTE tmp[STRIPE_SIZE];
+	if (bufferSize >= STRIPE_SIZE)
+	{
+		accumulateStripes(f, acc, stripe, buffer, ((bufferSize - 1) / STRIPE_SIZE), secret);
+		lastStripe = (buffer + bufferSize - STRIPE_SIZE);
+	}
+	else
+	{
+		// Straddles the previously consumed bytes
+		size_t before = (STRIPE_SIZE - bufferSize);
+		memcpy(tmp, (last + STRIPE_SIZE - before), before);
+		memcpy((tmp + before), buffer, bufferSize);
+		lastStripe = tmp;
+	}
+	f.accumulate(acc, lastStripe, (secret + LAST_STRIPE_KEY), 1);
+}
+
+UINT64 Stream::digest64() const
+{
+	if (m_total <= SHORT_MAX)
+		return hashShort(m_buffer, (size_t) m_total, defaultSecret, m_seed);
+
+	ALIGN(32) UINT64 acc[8];
+	memcpy(acc, m_acc, sizeof(acc));
+	finishLong(acc, m_stripes, m_buffer, m_bufferSize, m_last, m_secret);
+	return finish64(acc, m_secret, m_total);
+}
+
+HASH128 Stream::digest128() const
+{
+	if (m_total <= SHORT_MAX)
+		return { hashShort(m_buffer, (size_t) m_total, defaultSecret, m_seed), hashShort(m_buffer, (size_t) m_total, (defaultSecret + SHORT_HI_KEY), m_seed) };
+
+	ALIGN(32) UINT64 acc[8];
+	memcpy(acc, m_acc, sizeof(acc));
+	finishLong(acc, m_stripes, m_buffer, m_bufferSize, m_last, m_secret);
+	return finish128(acc, m_secret, m_total);
+}
+
+
+// ----------------------------------------------------------------------------
+// Database ranges
+
+// Read [start, end) in chunks through idbAccess, calling 'f(data, size)' per chunk
+template <class F> static BOOL readRange(ea_t start, ea_t end, F &&f)
+{
+	if (start >= end)
+		return TRUE;
+	BYTE p[RANGE_CHUNK];
+	for (ea_t ea = start; ea < end;)
+	{
+		size_t size = (((end - ea) < RANGE_CHUNK) ? (size_t) (end - ea) : RANGE_CHUNK);
+		ssize_t read = idbAccess->getBytes(p, size, ea);
+		if (read <= 0)
+			return FALSE;
+		f(p, (size_t) read);
+		ea += (size_t) read;
+	}
+	return TRUE;
+}
+
+BOOL Stream::updateRange(ea_t start, ea_t end)
+{
+	return readRange(start, end, [this](const BYTE *p, size_t size) { update(p, size); });
+}
+
+BOOL Hash::hashRange64(ea_t start, ea_t end, __out UINT64 &hash, UINT64 seed)
+{
+	Stream stream(seed);
+	BOOL ok = stream.updateRange(start, end);
+	hash = stream.digest64();
+	return ok;
+}
+
+BOOL Hash::hashRange128(ea_t start, ea_t end, __out HASH128 &hash, UINT64 seed)
+{
+	Stream stream(seed);
+	BOOL ok = stream.updateRange(start, end);
+	hash = stream.digest128();
+	return ok;
+}
+
+BOOL Hash::crc32cRange(ea_t start, ea_t end, __inout UINT32 &crc)
+{
+	return readRange(start, end, [&crc](const BYTE *p, size_t size) { crc = crc32c(p, size, crc); });
+}
+
+BOOL Hash::hashFunction(const func_t *pfn, __out HASH128 &hash, UINT64 seed)
+{
+	BOOL complete = TRUE;
+	Stream stream(seed);
+	if (pfn)
+	{
+		// Iterator gives the entry chunk first
+		std::vector<range_t> chunks;
+		func_tail_iterator_t fti((func_t *) pfn);
+		for (bool ok = fti.first(); ok; ok = fti.next())
+			chunks.push_back(fti.chunk());
+		std::sort(chunks.begin(), chunks.end(), [](const range_t &a, const range_t &b) { return (a.start_ea < b.start_ea); });
+
+		for (const range_t &chunk: chunks)
+		{
+			if (!(complete = stream.updateRange(chunk.start_ea, chunk.end_ea)))
+				break;
+		}
+	}
+	hash = stream.digest128();
+	return complete;
+}
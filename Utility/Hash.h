@@ -0,0 +1,69 @@
+
+// IDA utility support: Fast byte range hashing
+#pragma once
+
+struct func_t;
+
+// Hashing for dedupe, caching and library matching of function bodies, data blobs and normalized instruction streams.
+// CRC32C (Castagnoli) uses the SSE4.2 CRC32 instruction, three interleaved streams on large inputs, with a
+// slicing-by-8 table fallback; results match any other CRC32C implementation.
+// hash64()/hash128() are XXH3 style (64 byte stripes over eight 64bit lanes, SSE2 or AVX2 runtime dispatched) at
+// memory speed on large inputs. Not output compatible with xxHash; don't persist the values outside of our own
+// caches without a version.
+namespace Hash
+{
+	struct HASH128
+	{
+		UINT64 lo, hi;
+		bool operator==(const HASH128 &b) const { return ((lo == b.lo) && (hi == b.hi)); }
+		bool operator!=(const HASH128 &b) const { return !(*this == b); }
+		bool operator<(const HASH128 &b) const { return ((hi != b.hi) ? (hi < b.hi) : (lo < b.lo)); }
+	};
+
+	// CRC32C, pass the previous result as 'crc' to continue it
+	UINT32 crc32c(LPCVOID data, size_t size, UINT32 crc = 0);
+
+	UINT64 hash64(LPCVOID data, size_t size, UINT64 seed = 0);
+	HASH128 hash128(LPCVOID data, size_t size, UINT64 seed = 0);
+
+	// Incremental hash64()/hash128(), any split of the input gives the same result as the one shot call
+	class Stream
+	{
+	public:
+		Stream(UINT64 seed = 0) { reset(seed); }
+
+		void reset(UINT64 seed = 0);
+		void update(LPCVOID data, size_t size);
+		UINT64 digest64() const;
+		HASH128 digest128() const;
+
+		// Add database bytes [start, end) as read by idbAccess->getBytes(). Returns FALSE on a read error.
+		BOOL updateRange(ea_t start, ea_t end);
+
+		static const size_t BUFFER_SIZE = 256;
+		static const size_t SECRET_SIZE = 192;
+
+	private:
+		ALIGN(32) UINT64 m_acc[8];
+		ALIGN(32) BYTE m_secret[SECRET_SIZE];
+		BYTE m_buffer[BUFFER_SIZE];
+		BYTE m_last[64];	// Last 64 consumed bytes, for the final stripe
+		UINT64 m_seed, m_total;
+		size_t m_bufferSize, m_stripes;
+
+		void consume(const BYTE *p, size_t size);
+	};
+
+	// Database bytes in [start, end), see Stream::updateRange(). Return FALSE on a read error, the hash of a
+	// truncated range isn't valid.
+	BOOL hashRange64(ea_t start, ea_t end, __out UINT64 &hash, UINT64 seed = 0);
+	BOOL hashRange128(ea_t start, ea_t end, __out HASH128 &hash, UINT64 seed = 0);
+	BOOL crc32cRange(ea_t start, ea_t end, __inout UINT32 &crc);
+
+	// Function body bytes, all chunks in address order. Returns FALSE on a read error.
+	BOOL hashFunction(const func_t *pfn, __out HASH128 &hash, UINT64 seed = 0);
+
+	// Force the portable paths (slicing-by-8 CRC32C, SSE2 lanes) for self checks against the SSE4.2/AVX2 ones.
+	// Not thread safe, set it while nothing is hashing.
+	void setBaseline(BOOL baseline);
+};
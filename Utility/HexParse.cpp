@@ -0,0 +1,210 @@
+
+// IDA utility support: SIMD hex string validation and parsing
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <HexParse.h>
+
+// True if a 16 byte load at 'p' can't touch the next page
+static inline BOOL canLoad16(LPCVOID p) { return ((((UINT_PTR) p) & 4095) <= (4096 - 16)); }
+
+static inline BOOL isSeparator(char c) { return ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == ',')); }
+
+// Hex digit value, or -1
+static inline int nibble(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+		return (c - '0');
+	c |= 0x20;
+	if ((c >= 'a') && (c <= 'f'))
+		return (c - ('a' - 10));
+	return -1;
+}
+
+// Classify 16 characters, returning a bit mask of hex digit lanes and their nibble values
+static inline UINT32 classify16(__m128i c, __out __m128i &nibbles)
+{
+	__m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+	__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+	nibbles = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))), _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+	return (UINT32) _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+}
+
+// Combine the first 'count' (1 to 16) nibbles, most significant first, into a value
+static inline UINT64 combine16(__m128i nibbles, UINT32 count)
+{
+	// Zero lanes past the digits
+	const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	nibbles = _mm_and_si128(nibbles, _mm_cmplt_epi8(lanes, _mm_set1_epi8((char) count)));
+
+	// Pairs to bytes: (even << 4) | odd, then pack the 8 bytes down
+	__m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4), _mm_srli_epi16(nibbles, 8));
+	UINT64 bytes = (UINT64) _mm_cvtsi128_si64(_mm_packus_epi16(pairs, pairs));
+	return (_byteswap_uint64(bytes) >> ((16 - count) * 4));
+}
+
+// Scalar path for page boundaries and digit runs of 16 or more, allows leading zeros
+static LPCSTR parseScalar(LPCSTR p, LPCSTR end, __out UINT64 &value)
+{
+	LPCSTR start = p;
+	UINT64 v = 0;
+	UINT32 significant = 0;
+	int n;
+	while (((end == NULL) || (p < end)) && ((n = nibble(*p)) >= 0))
+	{
+		if (v || n)
+		{
+			if (++significant > 16)
+				return NULL;
+		}
+		v = ((v << 4) | (UINT64) n);
+		p++;
+	}
+	if (p == start)
+		return NULL;
+	value = v;
+	return p;
+}
+
+LPCSTR HexParse::parse(LPCSTR str, LPCSTR end, __out UINT64 &value)
+{
+	LPCSTR p = str;
+	if (((end == NULL) || ((end - p) > 2)) && (p[0] == '0') && ((p[1] | 0x20) == 'x') && (nibble(p[2]) >= 0))
+		p += 2;
+
+	if (canLoad16(p))
+	{
+		__m128i nibbles;
+		UINT32 mask = classify16(_mm_loadu_si128((const __m128i *) p), nibbles);
+		if (end && ((end - p) < 16))
+			mask &= ((1u << (end - p)) - 1);
+
+		// Digit count is the first non hex lane
+		unsigned long count;
+		_BitScanForward(&count, (~mask | 0x10000));
+		if (count == 0)
+			return NULL;
+		if (count < 16)
+		{
+			value = combine16(nibbles, count);
+			return (p + count);
+		}
+	}
+	return parseScalar(p, end, value);
+}
+
+BOOL HexParse::parseUInt64(LPCSTR str, __out UINT64 &value)
+{
+	LPCSTR p = parse(str, NULL, value);
+	return (p && (*p == 0));
+}
+
+BOOL HexParse::parseEa(LPCSTR str, __out ea_t &ea)
+{
+	UINT64 value;
+	if (parseUInt64(str, value) && (value <= (UINT64) BADADDR))
+	{
+		ea = (ea_t) value;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+template <class T> static BOOL parseListT(LPCSTR text, size_t length, __out std::vector<T> &values, __out_opt size_t *errorOffset)
+{
+	LPCSTR p = text, end = (text + length);
+	for (;;)
+	{
+		while ((p < end) && isSeparator(*p))
+			p++;
+		if (p >= end)
+			return TRUE;
+
+		UINT64 value;
+		LPCSTR next = HexParse::parse(p, end, value);
+		if (!next || ((next < end) && !isSeparator(*next)) || (value > (UINT64) ((T) ~(T) 0)))
+		{
+			if (errorOffset)
+				*errorOffset = (size_t) (p - text);
+			return FALSE;
+		}
+		values.push_back((T) value);
+		p = next;
+	}
+}
+
+BOOL HexParse::parseList(LPCSTR text, size_t length, __out std::vector<UINT64> &values, __out_opt size_t *errorOffset)
+{
+	// Rough preallocation assuming ~12 characters per entry
+	values.reserve(values.size() + (length / 12));
+	return parseListT(text, length, values, errorOffset);
+}
+
+BOOL HexParse::parseEaList(LPCSTR text, size_t length, __out std::vector<ea_t> &eas, __out_opt size_t *errorOffset)
+{
+	eas.reserve(eas.size() + (length / 12));
+	return parseListT(text, length, eas, errorOffset);
+}
+
+BOOL HexParse::parsePattern(LPCSTR pattern, __out std::vector<BYTE> &bytes, __out std::vector<BYTE> &mask)
+{
+	bytes.clear();
+	mask.clear();
+
+	LPCSTR p = pattern;
+	for (;;)
+	{
+		while (isSeparator(*p))
+			p++;
+		if (!*p)
+			break;
+
+		// "?" or "??" wildcard
+		if (*p == '?')
+		{
+			p += ((p[1] == '?') ? 2 : 1);
+			bytes.push_back(0);
+			mask.push_back(0);
+		}
+		else
+		{
+			int hi = nibble(p[0]);
+			if (hi < 0)
+				return FALSE;
+			int lo = nibble(p[1]);
+			if (lo >= 0)
+			{
+				bytes.push_back((BYTE) ((hi << 4) | lo));
+				p += 2;
+			}
+			else
+			{
+				bytes.push_back((BYTE) hi);
+				p++;
+			}
+			mask.push_back(0xFF);
+		}
+
+		if (*p && !isSeparator(*p))
+			return FALSE;
+	}
+	return !bytes.empty();
+}
@@ -0,0 +1,29 @@
+
+// IDA utility support: SIMD hex string validation and parsing
+#pragma once
+
+#include <vector>
+
+// One pass validate and parse of hex numbers, lists and IDA byte patterns.
+// Numbers are classified and converted 16 characters at a time with SSE2; may read up to 15 bytes past the end of
+// the digits but never across a page boundary.
+namespace HexParse
+{
+	// Parse hex digits at 'str', with optional "0x" prefix, stopping at the first non hex character or 'end'
+	// (NULL for a NUL terminated string). Returns pointer past the digits, or NULL if there are none or the value
+	// doesn't fit in 64 bits.
+	LPCSTR parse(LPCSTR str, LPCSTR end, __out UINT64 &value);
+
+	// Whole string must be a hex number
+	BOOL parseUInt64(LPCSTR str, __out UINT64 &value);
+	BOOL parseEa(LPCSTR str, __out ea_t &ea);
+
+	// Parse white space and/or comma separated hex list, appending to 'values'.
+	// Returns FALSE on the first invalid token with its offset in 'errorOffset'.
+	BOOL parseList(LPCSTR text, size_t length, __out std::vector<UINT64> &values, __out_opt size_t *errorOffset = NULL);
+	BOOL parseEaList(LPCSTR text, size_t length, __out std::vector<ea_t> &eas, __out_opt size_t *errorOffset = NULL);
+
+	// Parse IDA style byte pattern, I.E. "48 8B ?? 05 ? ? 00", to bytes and a compare mask (0xFF compare, 0 wildcard).
+	// Returns FALSE on an invalid token.
+	BOOL parsePattern(LPCSTR pattern, __out std::vector<BYTE> &bytes, __out std::vector<BYTE> &mask);
+};
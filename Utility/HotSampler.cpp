@@ -0,0 +1,342 @@
+
+// IDA utility support: Sampling hot address profiler
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <timeapi.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <funcs.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <mutex>
+#include <Utility.h>
+#include <HotSampler.h>
+
+using namespace HotSampler;
+
+struct SAMPLE
+{
+	ea_t ea;
+	PHASE phase;
+};
+
+// Samples at an address, or a ranked report row
+struct BUCKET
+{
+	ea_t start;
+	UINT64 samples;
+};
+
+thread_local SLOT *HotSampler::threadSlot = NULL;
+
+static SLOT slots[MAX_THREADS];
+// Threads past MAX_THREADS publish here, it's never sampled
+static SLOT overflowSlot;
+static std::atomic<UINT32> slotsUsed(0);
+static std::vector<SLOT *> freeSlots;
+
+static char phaseNames[MAX_PHASES][32] = { "(none)" };
+static UINT32 phasesUsed = 1;
+
+static std::mutex lock;			// Slot and phase tables, sample counts and stats
+// Sample counts per distinct address and per phase, so memory follows the addresses seen rather than the run time
+static EaHashMap<UINT64> addressSamples;
+static UINT64 phaseSamples[MAX_PHASES] = {};
+static STATS stats = {};
+static std::thread sampler;
+static std::atomic<BOOL> running(FALSE);
+static UINT32 period = 1;		// Milliseconds between samples
+static TIMESTAMP startTime = 0.0;
+
+// A std::thread still joinable at static destruction calls std::terminate(), and joining it from there can deadlock
+// on the loader lock at plugin unload. Plugins must stop() in term(); this only keeps a missed stop() from aborting.
+static struct SAMPLER_GUARD
+{
+	~SAMPLER_GUARD()
+	{
+		if (sampler.joinable())
+		{
+			_ASSERT(FALSE);
+			running.store(FALSE);
+			sampler.detach();
+		}
+	}
+} samplerGuard;
+
+// Idle and give the slot back when the thread exits, ParallelFor() threads come and go
+struct SLOT_RELEASE
+{
+	SLOT *slot;
+	~SLOT_RELEASE()
+	{
+		if (slot && (slot != &overflowSlot))
+		{
+			slot->ea.store(BADADDR, std::memory_order_relaxed);
+			std::lock_guard<std::mutex> guard(lock);
+			freeSlots.push_back(slot);
+		}
+	}
+};
+static thread_local SLOT_RELEASE slotRelease = { NULL };
+
+SLOT *HotSampler::assignSlot()
+{
+	SLOT *slot;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			UINT32 used = slotsUsed.load(std::memory_order_relaxed);
+			if (used < MAX_THREADS)
+			{
+				slot = &slots[used];
+				slot->ea.store(BADADDR, std::memory_order_relaxed);
+				slotsUsed.store((used + 1), std::memory_order_release);
+			}
+			else
+				slot = &overflowSlot;
+		}
+	}
+
+	threadSlot = slot;
+	slotRelease.slot = slot;
+	return slot;
+}
+
+PHASE HotSampler::registerPhase(LPCSTR name)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	for (UINT32 i = 1; i < phasesUsed; i++)
+	{
+		// Names are stored truncated, compare only what fits
+		if (strncmp(phaseNames[i], name, (sizeof(phaseNames[i]) - 1)) == 0)
+			return i;
+	}
+	if (phasesUsed >= MAX_PHASES)
+		return NO_PHASE;
+	strncpy_s(phaseNames[phasesUsed], sizeof(phaseNames[phasesUsed]), name, _TRUNCATE);
+	return phasesUsed++;
+}
+
+static void samplerThread()
+{
+	SAMPLE batch[MAX_THREADS];
+	while (running.load(std::memory_order_relaxed))
+	{
+		Sleep(period);
+		if (!running.load(std::memory_order_relaxed))
+			break;
+
+		UINT32 used = slotsUsed.load(std::memory_order_acquire);
+		UINT32 count = 0;
+		for (UINT32 i = 0; i < used; i++)
+		{
+			ea_t ea = slots[i].ea.load(std::memory_order_relaxed);
+			if (ea != BADADDR)
+			{
+				// publish() takes any value, one not from registerPhase() counts as no phase
+				PHASE phase = slots[i].phase.load(std::memory_order_relaxed);
+				batch[count++] = { ea, ((phase < MAX_PHASES) ? phase : NO_PHASE) };
+			}
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		for (UINT32 i = 0; i < count; i++)
+		{
+			addressSamples[batch[i].ea]++;
+			phaseSamples[batch[i].phase]++;
+		}
+		stats.samples += count;
+		stats.ticks++;
+		stats.elapsed += (GetTimeStamp() - startTime);
+		startTime = GetTimeStamp();
+	}
+}
+
+
+void HotSampler::start(UINT32 rate)
+{
+	if (running.load())
+		return;
+	if (!rate)
+		rate = DEFAULT_RATE;
+	period = ((rate < 1000) ? (1000 / rate) : 1);
+
+	// The default ~15ms system timer would cap the rate near 64Hz
+	timeBeginPeriod(1);
+	startTime = GetTimeStamp();
+	running.store(TRUE);
+	sampler = std::thread(samplerThread);
+}
+
+void HotSampler::stop()
+{
+	if (!running.load())
+		return;
+	running.store(FALSE);
+	sampler.join();
+	timeEndPeriod(1);
+}
+
+BOOL HotSampler::isRunning()
+{
+	return running.load();
+}
+
+void HotSampler::reset()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	addressSamples.clear();
+	memset(phaseSamples, 0, sizeof(phaseSamples));
+	stats = {};
+}
+
+void HotSampler::getStats(__out STATS &out)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	out = stats;
+}
+
+// Sort by samples, descending
+static void rank(__inout std::vector<BUCKET> &buckets)
+{
+	std::sort(buckets.begin(), buckets.end(), [](const BUCKET &a, const BUCKET &b) { return (a.samples > b.samples) || ((a.samples == b.samples) && (a.start < b.start)); });
+}
+
+static void printHeader(LPCSTR title)
+{
+	msg("  %-32s %16s %14s %6s %s\n", title, "Address", "Samples", "", "Est. time");
+}
+
+static void printRow(LPCSTR name, ea_t start, UINT64 count, UINT64 total, TIMESTAMP sampleTime)
+{
+	char number[32];
+	double percent = ((double) count * 100.0) / (double) total;
+	if (start != BADADDR)
+		msg("  %-32.32s %16llX %14s %5.1f%% ", name, (UINT64) start, NumberCommaString(count, number), percent);
+	else
+		msg("  %-32.32s %16s %14s %5.1f%% ", name, "", NumberCommaString(count, number), percent);
+	msg("%s\n", TimeString((double) count * sampleTime));
+}
+
+void HotSampler::report(UINT32 top)
+{
+	std::vector<BUCKET> addresses;
+	UINT64 phaseCounts[MAX_PHASES];
+	STATS s;
+	UINT32 phaseCount;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		addresses.reserve(addressSamples.size());
+		addressSamples.forEach([&](ea_t ea, UINT64 &count) { addresses.push_back({ ea, count }); });
+		memcpy(phaseCounts, phaseSamples, sizeof(phaseCounts));
+		s = stats;
+		phaseCount = phasesUsed;
+	}
+	if (!s.samples)
+	{
+		msg("Hot addresses: no samples.\n");
+		return;
+	}
+
+	// Thread time a sample stands for, the actual sampling period
+	TIMESTAMP sampleTime = (s.ticks ? (s.elapsed / (TIMESTAMP) s.ticks) : 0.0);
+	UINT64 total = s.samples;
+	char number[32];
+	msg("Hot addresses: %s samples", NumberCommaString(total, number));
+	msg(" over %s,", TimeString(s.elapsed));
+	msg(" %.0f Hz\n", ((sampleTime > 0.0) ? (1.0 / sampleTime) : 0.0));
+
+	// Phases
+	if (phaseCount > 1)
+	{
+		std::vector<BUCKET> phases(phaseCount);
+		for (UINT32 i = 0; i < phaseCount; i++)
+			phases[i] = { i, phaseCounts[i] };
+		rank(phases);
+		printHeader("Phase");
+		for (const BUCKET &b: phases)
+		{
+			if (b.samples)
+				printRow(phaseNames[b.start], BADADDR, b.samples, total, sampleTime);
+		}
+	}
+
+	std::sort(addresses.begin(), addresses.end(), [](const BUCKET &a, const BUCKET &b) { return a.start < b.start; });
+
+	// Functions, one get_func() per distinct address
+	EaHashMap<UINT64> byFunction;
+	UINT64 noFunction = 0;
+	for (const BUCKET &address: addresses)
+	{
+		if (func_t *f = get_func(address.start))
+			byFunction[f->start_ea] += address.samples;
+		else
+			noFunction += address.samples;
+	}
+	std::vector<BUCKET> functions;
+	functions.reserve(byFunction.size());
+	byFunction.forEach([&](ea_t start, UINT64 &count) { functions.push_back({ start, count }); });
+	rank(functions);
+
+	printHeader("Function");
+	qstring name;
+	for (size_t i = 0; (i < functions.size()) && (i < top); i++)
+	{
+		if (get_func_name(&name, functions[i].start) <= 0)
+			name = "?";
+		printRow(name.c_str(), functions[i].start, functions[i].samples, total, sampleTime);
+	}
+	if (noFunction)
+		printRow("(not in a function)", BADADDR, noFunction, total, sampleTime);
+
+	// Segments, walking the sorted addresses
+	std::vector<IDB_SEGMENT> segments(idbAccess->segmentCount());
+	for (UINT32 i = 0; i < segments.size(); i++)
+		idbAccess->getSegment(i, segments[i]);
+	std::sort(segments.begin(), segments.end(), [](const IDB_SEGMENT &a, const IDB_SEGMENT &b) { return a.start < b.start; });
+
+	std::vector<BUCKET> bySegment(segments.size());
+	for (size_t i = 0; i < segments.size(); i++)
+		bySegment[i] = { (ea_t) i, 0 };
+	UINT64 noSegment = 0;
+	size_t segment = 0;
+	for (const BUCKET &address: addresses)
+	{
+		while ((segment < segments.size()) && (address.start >= segments[segment].end))
+			segment++;
+		if ((segment < segments.size()) && (address.start >= segments[segment].start))
+			bySegment[segment].samples += address.samples;
+		else
+			noSegment += address.samples;
+	}
+	rank(bySegment);
+
+	printHeader("Segment");
+	for (size_t i = 0; (i < bySegment.size()) && (i < top) && bySegment[i].samples; i++)
+	{
+		const IDB_SEGMENT &seg = segments[(size_t) bySegment[i].start];
+		printRow(seg.name.c_str(), seg.start, bySegment[i].samples, total, sampleTime);
+	}
+	if (noSegment)
+		printRow("(not in a segment)", BADADDR, noSegment, total, sampleTime);
+}
@@ -0,0 +1,67 @@
+
+// IDA utility support: Sampling hot address profiler
+#pragma once
+
+// Finds which parts of the input a slow pass spends its time on, I.E. obfuscated blobs or giant switch tables,
+// without timing every call. The analysis loop publish()es the address it's working on, and optionally a phase, into
+// its thread's slot; that's two relaxed stores. A background thread samples every slot at a fixed rate and report()
+// ranks the functions, segments and phases by samples, each sample standing for one sample period of thread time.
+// A sample can pair a new address with the previous phase, close enough for a histogram.
+namespace HotSampler
+{
+	typedef UINT32 PHASE;
+	static const PHASE NO_PHASE = 0;
+	static const UINT32 MAX_PHASES = 32;
+	static const UINT32 MAX_THREADS = 64;
+	static const UINT32 DEFAULT_RATE = 1000;	// Samples per second per thread
+
+	struct ALIGN(64) SLOT
+	{
+		std::atomic<ea_t> ea;		// BADADDR when idle
+		std::atomic<PHASE> phase;
+	};
+	// This thread's slot, NULL until its first publish()
+	extern thread_local SLOT *threadSlot;
+	SLOT *assignSlot();
+
+	// Get the phase for a name, the same name returns the same phase. NO_PHASE if the table is full.
+	PHASE registerPhase(LPCSTR name);
+
+	// Mark this thread as working at 'ea'. Threads past MAX_THREADS aren't sampled.
+	inline void publish(ea_t ea, PHASE phase = NO_PHASE)
+	{
+		SLOT *slot = threadSlot;
+		if (!slot)
+			slot = assignSlot();
+		slot->phase.store(phase, std::memory_order_relaxed);
+		slot->ea.store(ea, std::memory_order_relaxed);
+	}
+
+	// Mark this thread as not working on any address, I.E. at the end of the loop
+	inline void idle()
+	{
+		if (threadSlot)
+			threadSlot->ea.store(BADADDR, std::memory_order_relaxed);
+	}
+
+	struct STATS
+	{
+		UINT64 samples;		// Samples of busy threads
+		UINT64 ticks;		// Sampler wake-ups
+		TIMESTAMP elapsed;	// Sampling time
+	};
+
+	// Start the sampler thread, keeps the samples of earlier runs until reset()
+	void start(UINT32 rate = DEFAULT_RATE);
+	// Stop and join the sampler thread. Required before unload, I.E. in the plugin's term().
+	void stop();
+	BOOL isRunning();
+	// Drop the samples
+	void reset();
+
+	void getStats(__out STATS &stats);
+
+	// Print the top 'top' functions and segments by samples, plus the phases. Call from the main thread, uses the
+	// function list and idbAccess segments.
+	void report(UINT32 top = 20);
+};
@@ -0,0 +1,224 @@
+
+// IDA utility support: Batched IDB edit queue
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <crtdbg.h>
+#include <algorithm>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <auto.hpp>
+#include <bytes.hpp>
+#include <kernwin.hpp>
+#include <name.hpp>
+#include <offset.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <IdbEditQueue.h>
+
+// Edits applied between progress callbacks
+static const size_t BATCH_SIZE = 4096;
+
+
+IdbEditQueue::IdbEditQueue(size_t reserveCount)
+{
+	if (reserveCount)
+	{
+		m_edits.reserve(reserveCount);
+		m_strings.reserve(reserveCount * 32);
+	}
+}
+
+void IdbEditQueue::clear()
+{
+	m_edits.clear();
+	m_strings.clear();
+}
+
+// Store string in the queue string pool, returns it's offset
+UINT64 IdbEditQueue::addString(LPCSTR str)
+{
+	UINT64 offset = m_strings.size();
+	m_strings.insert(m_strings.end(), str, str + (strlen(str) + 1));
+	return offset;
+}
+
+void IdbEditQueue::setName(ea_t ea, LPCSTR name, int flags)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_NAME, 0, flags, { addString(name ? name : ""), 0, 0 } };
+	m_edits.push_back(e);
+}
+
+void IdbEditQueue::setComment(ea_t ea, LPCSTR comment, BOOL repeatable)
+{
+	if (comment && comment[0])
+	{
+		EDIT e = { ea, (UINT32) m_edits.size(), EDIT_COMMENT, (BYTE) (repeatable ? 1 : 0), 0, { addString(comment), 0, 0 } };
+		m_edits.push_back(e);
+	}
+}
+
+void IdbEditQueue::createData(ea_t ea, flags64_t dataFlags, asize_t size, tid_t tid)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_DATA, 0, 0, { dataFlags, size, tid } };
+	m_edits.push_back(e);
+}
+
+void IdbEditQueue::createStrlit(ea_t ea, size_t length, int32 strtype)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_STRLIT, 0, (int) strtype, { (UINT64) length, 0, 0 } };
+	m_edits.push_back(e);
+}
+
+void IdbEditQueue::createAlign(ea_t ea, asize_t length, int alignment)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_ALIGN, 0, alignment, { (UINT64) length, 0, 0 } };
+	m_edits.push_back(e);
+}
+
+void IdbEditQueue::delItems(ea_t ea, int flags, asize_t nbytes)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_DELITEMS, 0, flags, { (UINT64) nbytes, 0, 0 } };
+	m_edits.push_back(e);
+}
+
+void IdbEditQueue::opOffset(ea_t ea, int n, UINT32 type, ea_t target, ea_t base)
+{
+	EDIT e = { ea, (UINT32) m_edits.size(), EDIT_OFFSET, (BYTE) n, (int) type, { target, base, 0 } };
+	m_edits.push_back(e);
+}
+
+
+// Apply a coalesced group of edits for the same address, kind group and operand.
+// The group is in queue order so the last entry is the last write, for creates also the kind applied.
+BOOL IdbEditQueue::apply(const EDIT *first, const EDIT *last, __out qstring &merged)
+{
+	const EDIT &e = *last;
+	switch (e.kind)
+	{
+		case EDIT_DATA:
+		return create_data(e.ea, (flags64_t) e.arg[0], (asize_t) e.arg[1], (tid_t) e.arg[2]);
+
+		case EDIT_STRLIT:
+		return create_strlit(e.ea, (size_t) e.arg[0], (int32) e.flags);
+
+		case EDIT_ALIGN:
+		return create_align(e.ea, (asize_t) e.arg[0], e.flags);
+
+		case EDIT_DELITEMS:
+		return del_items(e.ea, e.flags, (asize_t) e.arg[0]);
+
+		case EDIT_OFFSET:
+		return op_offset(e.ea, e.n, (UINT32) e.flags, (ea_t) e.arg[0], (ea_t) e.arg[1]);
+
+		case EDIT_NAME:
+		return set_name(e.ea, &m_strings[(size_t) e.arg[0]], e.flags);
+
+		case EDIT_COMMENT:
+		{
+			// Merge in queue order, dropping repeats of the same text
+			merged.clear();
+			for (const EDIT *c = first; c <= last; c++)
+			{
+				LPCSTR text = &m_strings[(size_t) c->arg[0]];
+				BOOL repeat = FALSE;
+				for (const EDIT *p = first; p < c; p++)
+				{
+					if (strcmp(&m_strings[(size_t) p->arg[0]], text) == 0)
+					{
+						repeat = TRUE;
+						break;
+					}
+				}
+
+				if (!repeat)
+				{
+					if (!merged.empty())
+						merged += '\n';
+					merged += text;
+				}
+			}
+			return set_cmt(e.ea, merged.c_str(), (e.n != 0));
+		}
+	};
+	return FALSE;
+}
+
+
+BOOL IdbEditQueue::commit(__out_opt STATS *stats, BOOL report, PROGRESS_CB progress)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	STATS s = { m_edits.size(), 0, 0, 0, 0 };
+	BOOL canceled = FALSE;
+
+	if (!m_edits.empty())
+	{
+		// Address sorted with groups of the same address, kind group and operand in queue order
+		std::sort(m_edits.begin(), m_edits.end(), [](const EDIT &a, const EDIT &b)
+		{
+			if (a.ea != b.ea) return (a.ea < b.ea);
+			if (groupOf(a.kind) != groupOf(b.kind)) return (groupOf(a.kind) < groupOf(b.kind));
+			if (a.n != b.n) return (a.n < b.n);
+			return (a.seq < b.seq);
+		});
+
+		// Keep auto-analysis from reacting to every edit, it catches up once on restore
+		bool autoState = enable_auto(false);
+
+		qstring merged;
+		const EDIT *edits = m_edits.data();
+		size_t count = m_edits.size(), groups = 0;
+		for (size_t i = 0; i < count;)
+		{
+			// Find the end of this coalesce group
+			size_t j = i;
+			while (((j + 1) < count) && (edits[j + 1].ea == edits[i].ea) && (groupOf(edits[j + 1].kind) == groupOf(edits[i].kind)) && (edits[j + 1].n == edits[i].n))
+				j++;
+
+			if (apply(&edits[i], &edits[j], merged))
+				s.applied++;
+			else
+				s.failed++;
+			s.coalesced += (j - i);
+			i = (j + 1);
+
+			if (progress && ((++groups % BATCH_SIZE) == 0))
+			{
+				if (progress((int) (((UINT64) i * 100) / count)))
+				{
+					canceled = TRUE;
+					break;
+				}
+			}
+		}
+
+		enable_auto(autoState);
+		request_refresh(IWID_ALL);
+	}
+
+	s.time = (GetTimeStamp() - startTime);
+	if (report)
+	{
+		char buffer[4][32];
+		msg("IdbEditQueue: %s queued, %s applied, %s coalesced, %s failed, in %s.%s\n",
+			NumberCommaString(s.queued, buffer[0]), NumberCommaString(s.applied, buffer[1]), NumberCommaString(s.coalesced, buffer[2]),
+			NumberCommaString(s.failed, buffer[3]), TimeString(s.time), (canceled ? " ** Canceled **" : ""));
+	}
+	if (stats)
+		*stats = s;
+
+	clear();
+	return !canceled;
+}
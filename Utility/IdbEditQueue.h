@@ -0,0 +1,97 @@
+
+// IDA utility support: Batched IDB edit queue
+#pragma once
+
+#include <vector>
+
+// Collects pending set_name(), set_cmt(), create_data(), create_strlit(), create_align(), del_items() and op_offset()
+// edits as findings come in, then commits them in one pass. Edits are coalesced per address (last write wins,
+// comments merged) and applied in address sorted batches with auto-analysis suspended, followed by one
+// request_refresh(). The create_data(), create_strlit() and create_align() edits for an address are one group, the
+// last queued of them is the one applied.
+class IdbEditQueue
+{
+public:
+	// Optional commit progress callback. Return TRUE to cancel.
+	// Same signature as WaitBox::updateAndCancelCheck() so it can be passed directly.
+	typedef BOOL (*PROGRESS_CB)(int progress);
+
+	// Commit results
+	struct STATS
+	{
+		UINT64 queued;		// Edits queued
+		UINT64 coalesced;	// Edits dropped or merged by coalescing
+		UINT64 applied;		// Edits applied to the IDB
+		UINT64 failed;		// Edits the IDA API rejected
+		TIMESTAMP time;		// Commit time
+	};
+
+	IdbEditQueue(size_t reserveCount = 0);
+	~IdbEditQueue() { clear(); }
+
+	// Queue a rename, last write for an address wins
+	void setName(ea_t ea, LPCSTR name, int flags = SN_NOWARN);
+
+	// Queue a comment, multiple comments for the same address are merged with duplicates dropped
+	void setComment(ea_t ea, LPCSTR comment, BOOL repeatable = FALSE);
+
+	// Queue a create_data(), last create of any kind for an address wins
+	void createData(ea_t ea, flags64_t dataFlags, asize_t size, tid_t tid = BADNODE);
+
+	// Queue a create_strlit() of 'length' bytes (0 to let IDA find the end), last create of any kind for an address wins
+	void createStrlit(ea_t ea, size_t length, int32 strtype = STRTYPE_C);
+
+	// Queue a create_align() of 'length' bytes, 'alignment' is the exponent or 0 to compute it from the end address.
+	// Last create of any kind for an address wins.
+	void createAlign(ea_t ea, asize_t length, int alignment = 0);
+
+	// Queue a del_items(), applied before any create at the same address. Last write for an address wins.
+	void delItems(ea_t ea, int flags = DELIT_SIMPLE, asize_t nbytes = 1);
+
+	// Queue an op_offset(), last write for an address and operand wins
+	void opOffset(ea_t ea, int n, UINT32 type, ea_t target = BADADDR, ea_t base = 0);
+
+	// Apply all queued edits to the IDB and clear the queue.
+	// Returns FALSE if canceled via the progress callback; edits not yet applied are discarded.
+	BOOL commit(__out_opt STATS *stats = NULL, BOOL report = TRUE, PROGRESS_CB progress = NULL);
+
+	// Discard all queued edits
+	void clear();
+
+	// Count of queued edits before coalescing
+	size_t size() { return m_edits.size(); }
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(IdbEditQueue);
+
+	// Also the apply order of edit groups at the same address
+	enum EDIT_KIND : BYTE
+	{
+		EDIT_DELITEMS,
+		EDIT_DATA,
+		EDIT_STRLIT,
+		EDIT_ALIGN,
+		EDIT_OFFSET,
+		EDIT_NAME,
+		EDIT_COMMENT
+	};
+
+	struct EDIT
+	{
+		ea_t ea;
+		UINT32 seq;		// Queue order, for last write wins
+		EDIT_KIND kind;
+		BYTE n;			// Operand number, or repeatable flag for comments
+		int flags;		// Name, string type, alignment, delete or offset reference type flags
+		UINT64 arg[3];	// Kind specific arguments, string offsets into m_strings
+	};
+
+	// Coalesce group of a kind, the create kinds share EDIT_DATA's
+	static EDIT_KIND groupOf(EDIT_KIND kind) { return (((kind == EDIT_STRLIT) || (kind == EDIT_ALIGN)) ? EDIT_DATA : kind); }
+
+	UINT64 addString(LPCSTR str);
+	BOOL apply(const EDIT *first, const EDIT *last, __out qstring &merged);
+
+	std::vector<EDIT> m_edits;
+	std::vector<char> m_strings;
+};
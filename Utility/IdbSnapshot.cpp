@@ -0,0 +1,402 @@
+
+// IDA utility support: In-memory IDB snapshot, a stand-in database backend
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <nalt.hpp>
+#include <segment.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <HexParse.h>
+#include <IdbSnapshot.h>
+
+// Snapshot format version, the ResultCache plugin version field
+static const UINT32 SNAPSHOT_VERSION = 2;	// 2: Full 64 bit flags
+
+static const UINT32 ID_INFO = RESULT_CACHE_ID('I','N','F','O');
+static const UINT32 ID_SEGMENTS = RESULT_CACHE_ID('S','E','G','S');
+static const UINT32 ID_BYTES = RESULT_CACHE_ID('B','Y','T','E');	// Segment bytes back to back
+static const UINT32 ID_FLAGS = RESULT_CACHE_ID('F','L','A','G');	// flags64_t per byte, parallel to ID_BYTES
+static const UINT32 ID_STRINGS = RESULT_CACHE_ID('S','T','R','T');	// String literal types sorted by address
+
+static const size_t NOT_FOUND = (size_t) -1;
+
+struct INFO
+{
+	UINT32 is64, reserved;
+	ea_t minEa, maxEa;
+};
+
+struct IdbSnapshot::SEGMENT
+{
+	ea_t start, end;
+	UINT64 dataOffset;	// Into ID_BYTES and ID_FLAGS
+	UINT32 perm, type, bitness, reserved;
+	char name[64];
+};
+
+struct IdbSnapshot::STRING_TYPE
+{
+	ea_t ea;
+	INT32 strtype, reserved;
+};
+typedef IdbSnapshot::SEGMENT SEGMENT;
+typedef IdbSnapshot::STRING_TYPE STRING_TYPE;
+
+static BOOL writeSnapshot(LPCSTR path, const INFO &info, const std::vector<SEGMENT> &segments, const std::vector<BYTE> &bytes, const std::vector<flags64_t> &flags,
+						  const std::vector<STRING_TYPE> &stringTypes, __in_opt const BYTE *inputHash)
+{
+	ResultCache::Writer writer(SNAPSHOT_VERSION);
+	writer.addArray(ID_INFO, &info, 1);
+	writer.addArray(ID_SEGMENTS, segments);
+	writer.addArray(ID_BYTES, bytes);
+	writer.addArray(ID_FLAGS, flags);
+	writer.addArray(ID_STRINGS, stringTypes);
+	return writer.save(path, inputHash);
+}
+
+BOOL IdbSnapshot::save(LPCSTR path)
+{
+	INFO info = { (UINT32) inf_is_64bit(), 0, inf_get_min_ea(), inf_get_max_ea() };
+
+	std::vector<SEGMENT> segments;
+	int count = get_segm_qty();
+	for (int i = 0; i < count; i++)
+	{
+		if (segment_t *seg = getnseg(i))
+		{
+			SEGMENT segment = { seg->start_ea, seg->end_ea, 0, seg->perm, seg->type, seg->bitness, 0, {} };
+			qstring name;
+			get_segm_name(&name, seg);
+			strncpy_s(segment.name, sizeof(segment.name), name.c_str(), _TRUNCATE);
+			segments.push_back(segment);
+		}
+	}
+	std::sort(segments.begin(), segments.end(), [](const SEGMENT &a, const SEGMENT &b) { return (a.start < b.start); });
+
+	UINT64 total = 0;
+	for (SEGMENT &segment: segments)
+	{
+		segment.dataOffset = total;
+		total += (segment.end - segment.start);
+	}
+
+	// One pass per segment: bytes in bulk, then flags and string types per address
+	std::vector<BYTE> bytes;
+	std::vector<flags64_t> flags;
+	std::vector<STRING_TYPE> stringTypes;
+	try
+	{
+		bytes.resize((size_t) total);
+		flags.resize((size_t) total);
+	}
+	catch (std::bad_alloc &)
+	{
+		msg("** IdbSnapshot::save(): Failed to allocate %s for the snapshot! **\n", byteSizeString(total * (1 + sizeof(flags64_t))));
+		return FALSE;
+	}
+
+	for (const SEGMENT &segment: segments)
+	{
+		size_t size = (size_t) (segment.end - segment.start);
+		get_bytes(&bytes[(size_t) segment.dataOffset], (ssize_t) size, segment.start, GMB_READALL);
+
+		flags64_t *segmentFlags = &flags[(size_t) segment.dataOffset];
+		for (size_t i = 0; i < size; i++)
+		{
+			ea_t ea = (segment.start + i);
+			flags64_t f = get_flags(ea);
+			segmentFlags[i] = f;
+			if (is_strlit(f))
+			{
+				opinfo_t oi;
+				stringTypes.push_back({ ea, (get_opinfo(&oi, ea, 0, f) ? oi.strtype : STRTYPE_C), 0 });
+			}
+		}
+	}
+
+	return writeSnapshot(path, info, segments, bytes, flags, stringTypes, NULL);
+}
+
+BOOL IdbSnapshot::save(LPCSTR path, BOOL is64, const std::vector<IDB_SEGMENT> &segments, const std::vector<BYTE> &bytes, const std::vector<flags64_t> &flags)
+{
+	std::vector<SEGMENT> snapshotSegments;
+	UINT64 total = 0;
+	for (const IDB_SEGMENT &s: segments)
+	{
+		if ((s.start >= s.end) || (!snapshotSegments.empty() && (snapshotSegments.back().end > s.start)))
+			return FALSE;
+		SEGMENT segment = { s.start, s.end, total, s.perm, s.type, s.bitness, 0, {} };
+		strncpy_s(segment.name, sizeof(segment.name), s.name.c_str(), _TRUNCATE);
+		snapshotSegments.push_back(segment);
+		total += (s.end - s.start);
+	}
+	if ((bytes.size() != total) || (flags.size() != total))
+		return FALSE;
+
+	// Not from an input file, so no input hash
+	INFO info = { (UINT32) is64, 0, (segments.empty() ? 0 : segments.front().start), (segments.empty() ? 0 : segments.back().end) };
+	BYTE inputHash[32] = {};
+	return writeSnapshot(path, info, snapshotSegments, bytes, flags, std::vector<STRING_TYPE>(), inputHash);
+}
+
+
+IdbSnapshot::IdbSnapshot() : m_segments(NULL), m_segmentCount(0), m_lastSegment(0), m_bytes(NULL), m_flags(NULL), m_stringTypes(NULL), m_stringTypeCount(0), m_is64(TRUE), m_minEa(0), m_maxEa(0) {}
+
+// Snapshots aren't keyed to an input file, they are meant to be replayed on any machine
+ResultCache::STATUS IdbSnapshot::load(LPCSTR path)
+{
+	close();
+	ResultCache::STATUS status = m_reader.open(path, SNAPSHOT_VERSION, NULL);
+	if (status != ResultCache::CACHE_OK)
+		return status;
+
+	size_t infoCount = 0, byteCount = 0, flagCount = 0;
+	const INFO *info = m_reader.array<INFO>(ID_INFO, infoCount);
+	m_segments = m_reader.array<SEGMENT>(ID_SEGMENTS, m_segmentCount);
+	m_bytes = m_reader.array<BYTE>(ID_BYTES, byteCount);
+	m_flags = m_reader.array<flags64_t>(ID_FLAGS, flagCount);
+	m_stringTypes = m_reader.array<STRING_TYPE>(ID_STRINGS, m_stringTypeCount);
+
+	// Missing sections and checksum failures come back NULL
+	BOOL valid = (info && m_segments && m_bytes && m_flags && m_stringTypes && (infoCount == 1) && (byteCount == flagCount));
+	for (size_t i = 0; valid && (i < m_segmentCount); i++)
+	{
+		const SEGMENT &segment = m_segments[i];
+		valid = ((segment.start < segment.end) && (segment.dataOffset <= byteCount) && ((segment.end - segment.start) <= (byteCount - segment.dataOffset)) &&
+				 ((i == 0) || (m_segments[i - 1].end <= segment.start)));
+	}
+	if (!valid)
+	{
+		close();
+		return ResultCache::CACHE_CORRUPT;
+	}
+
+	m_is64 = (BOOL) info->is64;
+	m_minEa = info->minEa;
+	m_maxEa = info->maxEa;
+	return ResultCache::CACHE_OK;
+}
+
+void IdbSnapshot::close()
+{
+	m_reader.close();
+	m_segments = NULL;
+	m_bytes = NULL;
+	m_flags = NULL;
+	m_stringTypes = NULL;
+	m_segmentCount = m_lastSegment = m_stringTypeCount = 0;
+}
+
+
+// Index of the segment containing address, or NOT_FOUND
+size_t IdbSnapshot::findSegment(ea_t ea)
+{
+	if ((m_lastSegment < m_segmentCount) && (ea >= m_segments[m_lastSegment].start) && (ea < m_segments[m_lastSegment].end))
+		return m_lastSegment;
+
+	const SEGMENT *end = (m_segments + m_segmentCount);
+	const SEGMENT *it = std::upper_bound(m_segments, end, ea, [](ea_t value, const SEGMENT &segment) { return (value < segment.start); });
+	if ((it == m_segments) || (ea >= it[-1].end))
+		return NOT_FOUND;
+	return (m_lastSegment = ((it - m_segments) - 1));
+}
+
+flags64_t IdbSnapshot::getFlags(ea_t ea)
+{
+	size_t i = findSegment(ea);
+	return ((i != NOT_FOUND) ? m_flags[m_segments[i].dataOffset + (ea - m_segments[i].start)] : 0);
+}
+
+BOOL IdbSnapshot::isLoaded(ea_t ea) { return ((getFlags(ea) & FF_IVL) != 0); }
+
+ssize_t IdbSnapshot::getBytes(PVOID buffer, size_t size, ea_t ea)
+{
+	// Spans segments, gaps read as zero
+	BYTE *out = (BYTE *) buffer;
+	size_t left = size;
+	while (left)
+	{
+		size_t chunk = left;
+		size_t i = findSegment(ea);
+		if (i != NOT_FOUND)
+		{
+			const SEGMENT &segment = m_segments[i];
+			if ((segment.end - ea) < chunk)
+				chunk = (size_t) (segment.end - ea);
+			memcpy(out, &m_bytes[segment.dataOffset + (ea - segment.start)], chunk);
+		}
+		else
+		{
+			// Up to the next segment
+			const SEGMENT *next = std::upper_bound(m_segments, (m_segments + m_segmentCount), ea, [](ea_t value, const SEGMENT &segment) { return (value < segment.start); });
+			if ((next != (m_segments + m_segmentCount)) && ((next->start - ea) < chunk))
+				chunk = (size_t) (next->start - ea);
+			ZeroMemory(out, chunk);
+		}
+		out += chunk;
+		ea += chunk;
+		left -= chunk;
+	}
+	return (ssize_t) size;
+}
+
+// Scans the flags array, skipping the gaps between segments
+ea_t IdbSnapshot::nextHead(ea_t ea, ea_t end)
+{
+	for (ea_t next = (ea + 1); (next > ea) && (next < end);)
+	{
+		size_t i = findSegment(next);
+		if (i == NOT_FOUND)
+		{
+			const SEGMENT *segment = std::upper_bound(m_segments, (m_segments + m_segmentCount), next, [](ea_t value, const SEGMENT &segment) { return (value < segment.start); });
+			if (segment == (m_segments + m_segmentCount))
+				break;
+			next = segment->start;
+			continue;
+		}
+
+		const SEGMENT &segment = m_segments[i];
+		ea_t last = ((end < segment.end) ? end : segment.end);
+		const flags64_t *flags = &m_flags[segment.dataOffset + (next - segment.start)];
+		for (; next < last; next++, flags++)
+		{
+			if (is_head(*flags))
+				return next;
+		}
+	}
+	return BADADDR;
+}
+
+UINT32 IdbSnapshot::get32(ea_t ea)
+{
+	UINT32 value;
+	size_t i = findSegment(ea);
+	if ((i != NOT_FOUND) && ((m_segments[i].end - ea) >= sizeof(value)))
+		memcpy(&value, &m_bytes[m_segments[i].dataOffset + (ea - m_segments[i].start)], sizeof(value));
+	else
+		getBytes(&value, sizeof(value), ea);
+	return value;
+}
+
+UINT64 IdbSnapshot::get64(ea_t ea)
+{
+	UINT64 value;
+	size_t i = findSegment(ea);
+	if ((i != NOT_FOUND) && ((m_segments[i].end - ea) >= sizeof(value)))
+		memcpy(&value, &m_bytes[m_segments[i].dataOffset + (ea - m_segments[i].start)], sizeof(value));
+	else
+		getBytes(&value, sizeof(value), ea);
+	return value;
+}
+
+// No disassembler here, render the item's bytes, I.E. "db 48h, 8Bh, 05h"
+void IdbSnapshot::getDisasmLine(ea_t ea, __out qstring &s)
+{
+	s.clear();
+	size_t i = findSegment(ea);
+	if ((i == NOT_FOUND) || !isLoaded(ea))
+	{
+		s = "db ?";
+		return;
+	}
+
+	const SEGMENT &segment = m_segments[i];
+	const flags64_t *flags = &m_flags[segment.dataOffset + (ea - segment.start)];
+	const BYTE *bytes = &m_bytes[segment.dataOffset + (ea - segment.start)];
+	size_t limit = (size_t) (segment.end - ea);
+	if (limit > 16)
+		limit = 16;
+
+	s = "db ";
+	for (size_t j = 0; j < limit; j++)
+	{
+		if ((j > 0) && !is_tail(flags[j]))
+			break;
+		s.cat_sprnt(((j > 0) ? ", %02Xh" : "%02Xh"), bytes[j]);
+	}
+}
+
+int IdbSnapshot::getStringType(ea_t ea)
+{
+	const STRING_TYPE *end = (m_stringTypes + m_stringTypeCount);
+	const STRING_TYPE *it = std::lower_bound(m_stringTypes, end, ea, [](const STRING_TYPE &entry, ea_t value) { return (entry.ea < value); });
+	return (((it != end) && (it->ea == ea)) ? it->strtype : STRTYPE_C);
+}
+
+// First match in [start, end), patterns don't match across segments
+ea_t IdbSnapshot::findBinary(ea_t start, ea_t end, LPCSTR pattern, __out_opt qstring *error)
+{
+	std::vector<BYTE> bytes, mask;
+	if (!HexParse::parsePattern(pattern, bytes, mask) || bytes.empty())
+	{
+		if (error)
+			*error = "invalid pattern";
+		return BADADDR;
+	}
+	size_t length = bytes.size();
+
+	// Scan for the first non wildcard byte with memchr then compare the rest under the mask
+	size_t anchor = 0;
+	while ((anchor < length) && !mask[anchor])
+		anchor++;
+
+	for (size_t i = 0; i < m_segmentCount; i++)
+	{
+		const SEGMENT &segment = m_segments[i];
+		ea_t lo = ((start > segment.start) ? start : segment.start);
+		ea_t hi = ((end < segment.end) ? end : segment.end);
+		if ((lo >= hi) || ((hi - lo) < length))
+			continue;
+
+		const BYTE *data = &m_bytes[segment.dataOffset + (lo - segment.start)];
+		size_t last = (size_t) ((hi - lo) - length);
+		if (anchor == length)
+			return lo;
+
+		for (size_t offset = 0; offset <= last; offset++)
+		{
+			const BYTE *hit = (const BYTE *) memchr((data + offset + anchor), bytes[anchor], ((last - offset) + 1));
+			if (!hit)
+				break;
+			offset = ((hit - data) - anchor);
+
+			size_t j = 0;
+			while ((j < length) && ((data[offset + j] & mask[j]) == (bytes[j] & mask[j])))
+				j++;
+			if (j == length)
+				return (lo + offset);
+		}
+	}
+	return BADADDR;
+}
+
+BOOL IdbSnapshot::getSegment(UINT32 index, __out IDB_SEGMENT &segment)
+{
+	if (index >= m_segmentCount)
+		return FALSE;
+	const SEGMENT &s = m_segments[index];
+	segment.start = s.start;
+	segment.end = s.end;
+	segment.perm = s.perm;
+	segment.type = s.type;
+	segment.bitness = s.bitness;
+	segment.name = s.name;
+	return TRUE;
+}
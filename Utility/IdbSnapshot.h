@@ -0,0 +1,61 @@
+
+// IDA utility support: In-memory IDB snapshot, a stand-in database backend
+#pragma once
+
+#include <ResultCache.h>
+
+// Segments, bytes, flags and string types of an IDB saved to a file that can be replayed without IDA.
+// save() exports the live IDB. load() maps a snapshot and, once made current with setIdbAccess(), serves the
+// Utility database helpers (PLAT, FindBinary, getDisasmText, isString, etc.) so scanners can be run and profiled
+// headless at full scale. Stored as a ResultCache file, so loading is a zero copy map.
+// Disassembly is not captured; getDisasmLine() renders the item bytes as a "db" line.
+class IdbSnapshot : public IdbAccess
+{
+public:
+	IdbSnapshot();
+	~IdbSnapshot() { close(); }
+
+	// Export the current IDB, returns FALSE on failure
+	static BOOL save(LPCSTR path);
+	// Write a synthetic snapshot, for self checks. 'bytes' and 'flags' hold the segment contents back to back in
+	// segment order; segments must be address sorted and disjoint.
+	static BOOL save(LPCSTR path, BOOL is64, const std::vector<IDB_SEGMENT> &segments, const std::vector<BYTE> &bytes, const std::vector<flags64_t> &flags);
+
+	ResultCache::STATUS load(LPCSTR path);
+	void close();
+	BOOL isOpen() { return m_reader.isOpen(); }
+
+	// IdbAccess
+	BOOL is64() { return m_is64; }
+	ea_t minEa() { return m_minEa; }
+	ea_t maxEa() { return m_maxEa; }
+	flags64_t getFlags(ea_t ea);
+	BOOL isLoaded(ea_t ea);
+	UINT32 get32(ea_t ea);
+	UINT64 get64(ea_t ea);
+	ssize_t getBytes(PVOID buffer, size_t size, ea_t ea);
+	ea_t nextHead(ea_t ea, ea_t end);
+	void getDisasmLine(ea_t ea, __out qstring &s);
+	int getStringType(ea_t ea);
+	ea_t findBinary(ea_t start, ea_t end, LPCSTR pattern, __out_opt qstring *error = NULL);
+	UINT32 segmentCount() { return (UINT32) m_segmentCount; }
+	BOOL getSegment(UINT32 index, __out IDB_SEGMENT &segment);
+
+	struct SEGMENT;
+	struct STRING_TYPE;
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(IdbSnapshot);
+
+	size_t findSegment(ea_t ea);
+
+	ResultCache::Reader m_reader;
+	const SEGMENT *m_segments;
+	size_t m_segmentCount, m_lastSegment;
+	const BYTE *m_bytes;
+	const flags64_t *m_flags;
+	const STRING_TYPE *m_stringTypes;
+	size_t m_stringTypeCount;
+	BOOL m_is64;
+	ea_t m_minEa, m_maxEa;
+};
@@ -0,0 +1,142 @@
+
+// IDA utility support: Batched main thread dispatch over execute_sync()
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <mutex>
+#include <Utility.h>
+#include <MainThreadQueue.h>
+
+using namespace MainThreadQueue;
+
+static const int MODE_FLAGS[MODE_COUNT] = { MFF_READ, MFF_WRITE };
+
+static std::mutex lock;
+static std::vector<REQUEST *> pending[MODE_COUNT];
+static BOOL scheduled[MODE_COUNT] = { FALSE, FALSE };
+static int wakeId[MODE_COUNT] = { 0, 0 };
+// Bumped per scheduled wake-up, so a poster only records the id of the wake-up it scheduled
+static UINT64 wakeGeneration[MODE_COUNT] = { 0, 0 };
+static STATS stats = {};
+
+// Run everything queued, swapping the queue out each pass so workers can keep adding
+static void drain(MODE mode)
+{
+	std::vector<REQUEST *> batch;
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			batch.swap(pending[mode]);
+			if (batch.empty())
+			{
+				scheduled[mode] = FALSE;
+				wakeId[mode] = 0;
+				return;
+			}
+			stats.requests += batch.size();
+			if (batch.size() > stats.largestBatch)
+				stats.largestBatch = (UINT32) batch.size();
+		}
+
+		for (REQUEST *request: batch)
+		{
+			request->run();
+			delete request;
+		}
+		batch.clear();
+	}
+}
+
+// The kernel owns and deletes MFF_NOWAIT requests after running them
+class WAKE : public exec_request_t
+{
+public:
+	WAKE(MODE mode) : m_mode(mode) {}
+	int idaapi execute()
+	{
+		drain(m_mode);
+		return 0;
+	}
+
+private:
+	MODE m_mode;
+};
+
+void MainThreadQueue::post(REQUEST *request, MODE mode)
+{
+	if (is_main_thread())
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stats.requests++;
+		}
+		request->run();
+		delete request;
+		return;
+	}
+
+	BOOL wake = FALSE;
+	UINT64 generation = 0;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending[mode].push_back(request);
+		if (!scheduled[mode])
+		{
+			scheduled[mode] = wake = TRUE;
+			generation = ++wakeGeneration[mode];
+			stats.wakes++;
+		}
+	}
+
+	// Only the empty to non-empty transition wakes the main thread, without waiting on it.
+	// By the time execute_sync() returns the wake-up may have run and another poster scheduled the next one, keep
+	// the id only if ours is still the current one.
+	if (wake)
+	{
+		int id = execute_sync(*new WAKE(mode), (MODE_FLAGS[mode] | MFF_NOWAIT));
+		std::lock_guard<std::mutex> guard(lock);
+		if (scheduled[mode] && (wakeGeneration[mode] == generation))
+			wakeId[mode] = id;
+	}
+}
+
+void MainThreadQueue::getStats(__out STATS &out)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	out = stats;
+}
+
+void MainThreadQueue::shutdown()
+{
+	_ASSERT(is_main_thread());
+	for (int mode = 0; mode < MODE_COUNT; mode++)
+	{
+		// The pending wake-up would find nothing after the drain
+		int id;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			id = wakeId[mode];
+			wakeId[mode] = 0;
+		}
+		if (id)
+			cancel_exec_request(id);
+		drain((MODE) mode);
+	}
+}
@@ -0,0 +1,79 @@
+
+// IDA utility support: Batched main thread dispatch over execute_sync()
+#pragma once
+
+#include <future>
+#include <type_traits>
+#include <utility>
+
+// Lets worker threads get IDA API work done on the main thread without an execute_sync() round trip per call.
+// call() queues a request and returns a future; the first request into an empty queue wakes the main thread with one
+// execute_sync(MFF_NOWAIT), and everything queued by the time it runs is drained in that one pass, so busy workers
+// get hundreds of requests per wake-up. callBatch() runs f(i) over a whole index range in one request with a single
+// future, for handing results back in bulk.
+// Read and write requests are separate queues (MFF_READ and MFF_WRITE drains), ordered within a queue only.
+// Calls from the main thread run inline. Requests must not wait on other requests.
+namespace MainThreadQueue
+{
+	enum MODE
+	{
+		MODE_READ,	// Database reads, MFF_READ
+		MODE_WRITE,	// Database changes, MFF_WRITE
+		MODE_COUNT
+	};
+
+	struct STATS
+	{
+		UINT64 requests;		// Requests run
+		UINT64 wakes;			// Main thread wake-ups
+		UINT32 largestBatch;	// Most requests run in one wake-up
+	};
+
+	// Internal, a queued request
+	class REQUEST
+	{
+	public:
+		virtual ~REQUEST() {}
+		virtual void run() = 0;
+	};
+	template <class R> class CALL : public REQUEST
+	{
+	public:
+		template <class F> CALL(F &&f) : m_task(std::forward<F>(f)) {}
+		void run() { m_task(); }
+		std::future<R> future() { return m_task.get_future(); }
+
+	private:
+		std::packaged_task<R()> m_task;
+	};
+
+	// Queue 'request' to run on the main thread, taking ownership. Runs it now on the main thread.
+	void post(REQUEST *request, MODE mode);
+
+	// Run f() on the main thread, the future gets its result or exception
+	template <class F> std::future<typename std::invoke_result<F>::type> call(F &&f, MODE mode = MODE_READ)
+	{
+		typedef typename std::invoke_result<F>::type R;
+		CALL<R> *request = new CALL<R>(std::forward<F>(f));
+		std::future<R> future = request->future();
+		post(request, mode);
+		return future;
+	}
+
+	// Run f(i) for every i in [0, count) on the main thread in one pass, I.E. to fill a results array.
+	// The future is ready when all have run.
+	template <class F> std::future<void> callBatch(size_t count, F &&f, MODE mode = MODE_READ)
+	{
+		return call([count, f = std::forward<F>(f)]() mutable
+		{
+			for (size_t i = 0; i < count; i++)
+				f(i);
+		}, mode);
+	}
+
+	void getStats(__out STATS &stats);
+
+	// Run what's queued, then cancel the pending wake-ups. Call from the main thread in the plugin's term(), after
+	// the workers have stopped.
+	void shutdown();
+};
@@ -0,0 +1,159 @@
+
+// IDA utility support: Read only memory mapped file view
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#else
+#include <windows.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <stdlib.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <MappedFile.h>
+
+#ifdef _WIN32
+MappedFile::MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(NULL), m_size(0), m_lastError(0), m_isOpen(FALSE) {}
+#else
+MappedFile::MappedFile() : m_file(-1), m_data(NULL), m_size(0), m_lastError(0), m_isOpen(FALSE) {}
+#endif
+
+MappedFile::MappedFile(LPCSTR path, ACCESS_HINT hint) : MappedFile()
+{
+	open(path, hint);
+}
+
+#ifdef _WIN32
+
+BOOL MappedFile::open(LPCSTR path, ACCESS_HINT hint)
+{
+	close();
+
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (hint == HINT_SEQUENTIAL)
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	else
+	if (hint == HINT_RANDOM)
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+
+	m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(m_file, &size))
+		{
+			m_size = (UINT64) size.QuadPart;
+
+			// Can't map an empty file
+			if (m_size == 0)
+				return (m_isOpen = TRUE);
+
+			if ((m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL)))
+			{
+				if ((m_data = (const BYTE *) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)))
+					return (m_isOpen = TRUE);
+			}
+		}
+	}
+
+	m_lastError = GetLastError();
+	close();
+	return FALSE;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+	m_data = NULL;
+	m_size = 0;
+	m_isOpen = FALSE;
+}
+
+void MappedFile::prefetch(UINT64 offset, UINT64 length)
+{
+	if (m_data && (offset < m_size))
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = { (PVOID) (m_data + offset), (SIZE_T) min(length, (m_size - offset)) };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+#else
+
+BOOL MappedFile::open(LPCSTR path, ACCESS_HINT hint)
+{
+	close();
+
+	if ((m_file = ::open(path, O_RDONLY)) != -1)
+	{
+		struct stat st;
+		if (fstat(m_file, &st) == 0)
+		{
+			m_size = (UINT64) st.st_size;
+			if (m_size == 0)
+				return (m_isOpen = TRUE);
+
+			PVOID view = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			if (view != MAP_FAILED)
+			{
+				m_data = (const BYTE *) view;
+				if (hint != HINT_NORMAL)
+					madvise(view, m_size, ((hint == HINT_SEQUENTIAL) ? MADV_SEQUENTIAL : MADV_RANDOM));
+				return (m_isOpen = TRUE);
+			}
+		}
+	}
+
+	m_lastError = (DWORD) errno;
+	close();
+	return FALSE;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		munmap((PVOID) m_data, m_size);
+	if (m_file != -1)
+		::close(m_file);
+	m_file = -1;
+	m_data = NULL;
+	m_size = 0;
+	m_isOpen = FALSE;
+}
+
+void MappedFile::prefetch(UINT64 offset, UINT64 length)
+{
+	if (m_data && (offset < m_size))
+	{
+		// Page align start for madvise()
+		UINT64 pageOffset = (offset & ~(UINT64) 4095);
+		madvise((PVOID) (m_data + pageOffset), (size_t) (min(length, (m_size - offset)) + (offset - pageOffset)), MADV_WILLNEED);
+	}
+}
+
+#endif
@@ -0,0 +1,55 @@
+
+// IDA utility support: Read only memory mapped file view
+#pragma once
+
+// RAII read only view of a whole file with 64bit sizes. The OS pages the file in on demand, so multi GB signature
+// databases and symbol files open instantly and cost no heap copy.
+class MappedFile
+{
+public:
+	// Access pattern hint for the OS cache manager
+	enum ACCESS_HINT
+	{
+		HINT_NORMAL,
+		HINT_SEQUENTIAL,	// Read ahead aggressively, drop pages behind
+		HINT_RANDOM			// Minimal read ahead
+	};
+
+	MappedFile();
+	MappedFile(LPCSTR path, ACCESS_HINT hint = HINT_NORMAL);
+	~MappedFile() { close(); }
+
+	// Map file, returns FALSE on failure with the OS error in lastError().
+	// A zero size file opens with a NULL data() pointer.
+	BOOL open(LPCSTR path, ACCESS_HINT hint = HINT_NORMAL);
+	void close();
+
+	BOOL isOpen() { return m_isOpen; }
+	const BYTE *data() { return m_data; }
+	UINT64 size() { return m_size; }
+	DWORD lastError() { return m_lastError; }
+
+	// Typed pointer at file offset, or NULL if 'count' elements don't fit
+	template <class T> const T *at(UINT64 offset, UINT64 count = 1)
+	{
+		if (!m_data || (offset > m_size) || (count > ((m_size - offset) / sizeof(T))))
+			return NULL;
+		return (const T *) (m_data + offset);
+	}
+
+	// Hint that a range will be needed soon, so it's read in ahead of access
+	void prefetch(UINT64 offset, UINT64 length);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(MappedFile);
+
+	#ifdef _WIN32
+	HANDLE m_file, m_mapping;
+	#else
+	int m_file;
+	#endif
+	const BYTE *m_data;
+	UINT64 m_size;
+	DWORD m_lastError;
+	BOOL m_isOpen;
+};
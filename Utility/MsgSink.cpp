@@ -0,0 +1,247 @@
+
+// IDA utility support: Buffered msg() output sink
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <mutex>
+#include <Utility.h>
+#include <AsyncFileWriter.h>
+#include <MsgSink.h>
+
+using namespace MsgSink;
+
+static std::mutex lock;
+static OPTIONS options = defaultOptions();
+static STATS stats = {};
+static qstring buffer;		// Lines for the next flush, up to the flush limit
+static qstring partial;		// Text after the last newline
+static size_t lastStart = 0;	// Coalescing line at the end of 'buffer', its newline and count not yet added
+static UINT64 repeats = 0;
+static BOOL full = FALSE;	// Buffer at the limit, lines go to the overflow until the next flush
+static UINT64 overflowed = 0;	// Overflow bytes since the last flush
+static TIMESTAMP lastFlush = 0.0;
+static AsyncFileWriter spill;
+static BOOL spillFailed = FALSE;
+
+// End the coalescing line
+static void closeRepeats()
+{
+	if (repeats)
+	{
+		if (repeats > 1)
+			buffer.cat_sprnt(" (x %llu)", repeats);
+		buffer += '\n';
+		repeats = 0;
+	}
+}
+
+// Past the flush limit text goes to the spill file, else it's dropped
+static void overflow(LPCSTR text, size_t length)
+{
+	overflowed += length;
+	if (options.spillPath && !spillFailed)
+	{
+		if (!spill.isOpen() && !spill.open(options.spillPath))
+		{
+			spillFailed = TRUE;
+			msg("MsgSink: Failed to open spill file \"%s\".\n", options.spillPath);
+		}
+		if (spill.isOpen() && spill.write(text, length))
+		{
+			stats.spilled += length;
+			return;
+		}
+	}
+	stats.dropped += length;
+}
+
+// Keep the buffer within the flush limit, cut at a line end when there's one
+static void trim()
+{
+	closeRepeats();
+	size_t length = buffer.length();
+	size_t keep = options.flushLimit;
+	LPCSTR text = buffer.c_str();
+	while ((keep > 0) && (text[keep - 1] != '\n'))
+		keep--;
+	if (!keep)
+		keep = options.flushLimit;
+
+	overflow((text + keep), (length - keep));
+	buffer.resize(keep);
+	full = TRUE;
+}
+
+static void addLine(LPCSTR line, size_t length)
+{
+	stats.lines++;
+	if (full)
+	{
+		overflow(line, length);
+		overflow("\n", 1);
+		return;
+	}
+
+	if (!options.coalesce)
+	{
+		buffer.append(line, length);
+		buffer += '\n';
+	}
+	else
+	if (repeats && ((buffer.length() - lastStart) == length) && (memcmp((buffer.c_str() + lastStart), line, length) == 0))
+	{
+		repeats++;
+		stats.coalesced++;
+		return;
+	}
+	else
+	{
+		closeRepeats();
+		lastStart = buffer.length();
+		buffer.append(line, length);
+		repeats = 1;
+	}
+
+	if (buffer.length() > options.flushLimit)
+		trim();
+}
+
+static void flushLocked(BOOL all)
+{
+	if (all && !partial.empty())
+	{
+		closeRepeats();
+		buffer += partial;
+		partial.clear();
+		if (buffer.length() > options.flushLimit)
+			trim();
+	}
+	closeRepeats();
+	lastFlush = GetTimeStamp();
+
+	if (!buffer.empty())
+	{
+		msg("%s", buffer.c_str());
+		stats.flushes++;
+		buffer.clear();
+	}
+	if (overflowed)
+	{
+		char number[32];
+		if (stats.spilled && !spillFailed)
+			msg("MsgSink: %s bytes more spilled to \"%s\".\n", NumberCommaString(overflowed, number), options.spillPath);
+		else
+			msg("MsgSink: %s bytes more dropped.\n", NumberCommaString(overflowed, number));
+		overflowed = 0;
+	}
+	full = FALSE;
+}
+
+
+void MsgSink::write(LPCSTR text, size_t length)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	while (length)
+	{
+		LPCSTR end = (LPCSTR) memchr(text, '\n', length);
+		if (!end)
+		{
+			partial.append(text, length);
+			break;
+		}
+
+		size_t lineLength = (end - text);
+		if (partial.empty())
+			addLine(text, lineLength);
+		else
+		{
+			partial.append(text, lineLength);
+			addLine(partial.c_str(), partial.length());
+			partial.clear();
+		}
+		text += (lineLength + 1);
+		length -= (lineLength + 1);
+	}
+
+	if (((GetTimeStamp() - lastFlush) * 1000.0) >= options.interval)
+		flushLocked(FALSE);
+}
+
+void MsgSink::vprint(LPCSTR format, va_list va)
+{
+	// Most lines fit the stack buffer
+	char text[1024];
+	va_list copy;
+	va_copy(copy, va);
+	int length = vsnprintf(text, sizeof(text), format, copy);
+	va_end(copy);
+	if (length < 0)
+		return;
+	if ((size_t) length < sizeof(text))
+	{
+		write(text, length);
+		return;
+	}
+
+	LPSTR large = (LPSTR) malloc(length + 1);
+	if (large)
+	{
+		vsnprintf(large, (length + 1), format, va);
+		write(large, length);
+		free(large);
+	}
+}
+
+void MsgSink::print(LPCSTR format, ...)
+{
+	va_list va;
+	va_start(va, format);
+	vprint(format, va);
+	va_end(va);
+}
+
+void MsgSink::flush()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	flushLocked(TRUE);
+}
+
+void MsgSink::close()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	flushLocked(TRUE);
+	spill.close();
+	spillFailed = FALSE;
+}
+
+void MsgSink::configure(const OPTIONS &newOptions)
+{
+	close();
+	std::lock_guard<std::mutex> guard(lock);
+	options = newOptions;
+	if (!options.flushLimit)
+		options.flushLimit = 1;
+}
+
+void MsgSink::getStats(__out STATS &out)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	out = stats;
+}
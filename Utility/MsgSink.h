@@ -0,0 +1,48 @@
+
+// IDA utility support: Buffered msg() output sink
+#pragma once
+
+#include <stdarg.h>
+
+// Drop-in for chatty msg() logging, I.E. a line per finding. Text collects in one buffer that goes to msg() as one
+// call at most every 'interval' ms, so the output window repaints a few times a second instead of per line.
+// A flush passes at most 'flushLimit' bytes to msg(); the rest spills to a log file, or is dropped, with a notice
+// line. Repeated identical lines are coalesced into one with a "(x N)" count.
+// Safe from any thread, though only whole lines keep their order across threads. Text waits in the buffer until the
+// next print after the interval, so call flush() at the end of a run.
+namespace MsgSink
+{
+	struct OPTIONS
+	{
+		UINT32 interval;	// Minimum milliseconds between timed flushes
+		size_t flushLimit;	// Most bytes to msg() per flush
+		LPCSTR spillPath;	// Log file for the overflow, NULL to drop it
+		BOOL coalesce;		// Print repeated identical lines once with a "(x N)" count
+	};
+	inline OPTIONS defaultOptions() { return { 250, (256 * 1024), NULL, TRUE }; }
+
+	struct STATS
+	{
+		UINT64 lines;		// Lines printed
+		UINT64 coalesced;	// Lines folded into a "(x N)" count
+		UINT64 spilled;		// Bytes written to the spill file
+		UINT64 dropped;		// Overflow bytes without a spill file
+		UINT32 flushes;		// msg() calls
+	};
+
+	// Flush what's buffered, close the spill file and apply new options
+	void configure(const OPTIONS &options);
+
+	// Buffered msg()
+	void print(LPCSTR format, ...);
+	void vprint(LPCSTR format, va_list va);
+	void write(LPCSTR text, size_t length);
+
+	// Pass everything buffered to msg() now, still limited by 'flushLimit'
+	void flush();
+
+	// Flush and close the spill file
+	void close();
+
+	void getStats(__out STATS &stats);
+};
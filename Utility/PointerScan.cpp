@@ -0,0 +1,270 @@
+
+// IDA utility support: SIMD pointer scanner
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <EaIntervalMap.h>
+#include <PointerScan.h>
+
+// Bytes read per getBytes() call, small enough that the per alignment passes over it stay in cache
+static const size_t CHUNK_SIZE = (1024 * 1024);
+
+// Bit mask of the 'count' (up to 64) contiguous pointer sized values where (value - lo) <= span, I.E. the value
+// is in [lo, lo + span]. Unsigned compares are done as signed ones on values biased by the sign bit.
+typedef UINT64 (*RANGE_MASK)(const BYTE *p, size_t count, UINT64 lo, UINT64 span);
+
+static UINT64 rangeMask64Scalar(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	UINT64 mask = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		UINT64 value;
+		memcpy(&value, (p + (i * sizeof(UINT64))), sizeof(UINT64));
+		if ((value - lo) <= span)
+			mask |= (1ull << i);
+	}
+	return mask;
+}
+
+static UINT64 rangeMask32Scalar(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	UINT64 mask = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		UINT32 value;
+		memcpy(&value, (p + (i * sizeof(UINT32))), sizeof(UINT32));
+		if ((UINT32) (value - (UINT32) lo) <= (UINT32) span)
+			mask |= (1ull << i);
+	}
+	return mask;
+}
+
+// SSE2 has no 64bit compare, so it's built from 32bit ones:
+// d > span == (hi(d) > hi(span)) || ((hi(d) == hi(span)) && (lo(d) > lo(span)))
+static UINT64 rangeMask64Sse2(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	const __m128i bias = _mm_set1_epi32(0x80000000);
+	const __m128i vlo = _mm_set1_epi64x((INT64) lo);
+	const __m128i vspan = _mm_xor_si128(_mm_set1_epi64x((INT64) span), bias);
+	UINT64 mask = 0;
+	size_t i = 0;
+	for (; (i + 2) <= count; i += 2)
+	{
+		__m128i d = _mm_xor_si128(_mm_sub_epi64(_mm_loadu_si128((const __m128i *) (p + (i * sizeof(UINT64)))), vlo), bias);
+		__m128i gt = _mm_cmpgt_epi32(d, vspan);
+		__m128i eq = _mm_cmpeq_epi32(d, vspan);
+		__m128i loGt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128i over = _mm_or_si128(gt, _mm_and_si128(eq, loGt));
+		mask |= ((UINT64) (~_mm_movemask_pd(_mm_castsi128_pd(over)) & 3) << i);
+	}
+	if (i < count)
+		mask |= (rangeMask64Scalar((p + (i * sizeof(UINT64))), (count - i), lo, span) << i);
+	return mask;
+}
+
+static UINT64 rangeMask32Sse2(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	const __m128i bias = _mm_set1_epi32(0x80000000);
+	const __m128i vlo = _mm_set1_epi32((int) lo);
+	const __m128i vspan = _mm_xor_si128(_mm_set1_epi32((int) span), bias);
+	UINT64 mask = 0;
+	size_t i = 0;
+	for (; (i + 4) <= count; i += 4)
+	{
+		__m128i d = _mm_xor_si128(_mm_sub_epi32(_mm_loadu_si128((const __m128i *) (p + (i * sizeof(UINT32)))), vlo), bias);
+		mask |= ((UINT64) (~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(d, vspan))) & 15) << i);
+	}
+	if (i < count)
+		mask |= (rangeMask32Scalar((p + (i * sizeof(UINT32))), (count - i), lo, span) << i);
+	return mask;
+}
+
+TARGET_AVX2 static UINT64 rangeMask64Avx2(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	const __m256i bias = _mm256_set1_epi64x((INT64) 0x8000000000000000ull);
+	const __m256i vlo = _mm256_set1_epi64x((INT64) lo);
+	const __m256i vspan = _mm256_xor_si256(_mm256_set1_epi64x((INT64) span), bias);
+	UINT64 mask = 0;
+	size_t i = 0;
+	for (; (i + 4) <= count; i += 4)
+	{
+		__m256i d = _mm256_xor_si256(_mm256_sub_epi64(_mm256_loadu_si256((const __m256i *) (p + (i * sizeof(UINT64)))), vlo), bias);
+		mask |= ((UINT64) (~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(d, vspan))) & 15) << i);
+	}
+	if (i < count)
+		mask |= (rangeMask64Scalar((p + (i * sizeof(UINT64))), (count - i), lo, span) << i);
+	return mask;
+}
+
+TARGET_AVX2 static UINT64 rangeMask32Avx2(const BYTE *p, size_t count, UINT64 lo, UINT64 span)
+{
+	const __m256i vlo = _mm256_set1_epi32((int) lo);
+	const __m256i vspan = _mm256_set1_epi32((int) span);
+	UINT64 mask = 0;
+	size_t i = 0;
+	for (; (i + 8) <= count; i += 8)
+	{
+		// Unsigned d <= span as max(d, span) == span
+		__m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (p + (i * sizeof(UINT32)))), vlo);
+		mask |= ((UINT64) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_max_epu32(d, vspan), vspan))) << i);
+	}
+	if (i < count)
+		mask |= (rangeMask32Scalar((p + (i * sizeof(UINT32))), (count - i), lo, span) << i);
+	return mask;
+}
+
+
+// Run being built per alignment phase
+struct RUN_STATE
+{
+	ea_t start, next;
+	UINT32 count;
+};
+
+struct SCAN
+{
+	const PointerScan::OPTIONS &options;
+	std::vector<PointerScan::RUN> &runs;
+	EaIntervalMap<ea_t> segments;
+	std::vector<BYTE> buffer;
+	RANGE_MASK rangeMask;
+	UINT64 lo, span;
+	size_t found;
+
+	SCAN(const PointerScan::OPTIONS &_options, std::vector<PointerScan::RUN> &_runs) : options(_options), runs(_runs), found(0)
+	{
+		buildSegmentRangeMap(segments);
+		buffer.resize(CHUNK_SIZE + sizeof(UINT64));
+		BOOL avx2 = (!options.noAvx2 && cpuHasAvx2());
+		if (plat.ptrSize == sizeof(UINT64))
+			rangeMask = (avx2 ? rangeMask64Avx2 : rangeMask64Sse2);
+		else
+			rangeMask = (avx2 ? rangeMask32Avx2 : rangeMask32Sse2);
+		lo = plat.MinAddress;
+		span = (plat.MaxAddress - plat.MinAddress);
+	}
+
+	void flush(RUN_STATE &state)
+	{
+		if (state.count && (state.count >= options.minRun))
+			runs.push_back({ state.start, state.count });
+		state.count = 0;
+	}
+
+	void scan(ea_t start, ea_t end);
+};
+
+void SCAN::scan(ea_t start, ea_t end)
+{
+	const UINT32 ptrSize = plat.ptrSize;
+	UINT32 alignment = options.alignment;
+	if (!alignment || (alignment > ptrSize) || (alignment & (alignment - 1)))
+		alignment = ptrSize;
+
+	ea_t first = ((start + (alignment - 1)) & ~((ea_t) alignment - 1));
+	if ((first >= end) || ((end - first) < ptrSize))
+		return;
+
+	UINT32 phases = (ptrSize / alignment);
+	RUN_STATE state[sizeof(UINT64)] = {};
+
+	for (ea_t base = first; base < end; base += CHUNK_SIZE)
+	{
+		// Chunk plus the tail bytes of pointers that start in it
+		size_t chunk = (((end - base) < CHUNK_SIZE) ? (size_t) (end - base) : CHUNK_SIZE);
+		size_t readSize = (chunk + (ptrSize - 1));
+		if (readSize > (end - base))
+			readSize = (size_t) (end - base);
+		ssize_t read = idbAccess->getBytes(buffer.data(), readSize, base);
+		if (read <= 0)
+			break;
+		readSize = (size_t) read;
+
+		for (UINT32 phase = 0; phase < phases; phase++)
+		{
+			size_t offset = (phase * alignment);
+			if ((offset + ptrSize) > readSize)
+				continue;
+			size_t slots = ((readSize - offset) / ptrSize);
+			RUN_STATE &run = state[phase];
+
+			for (size_t slot = 0; slot < slots; slot += 64)
+			{
+				const BYTE *p = &buffer[offset + (slot * ptrSize)];
+				size_t count = (((slots - slot) < 64) ? (slots - slot) : 64);
+				UINT64 mask = rangeMask(p, count, lo, span);
+				while (mask)
+				{
+					unsigned long bit;
+					_BitScanForward64(&bit, mask);
+					mask &= (mask - 1);
+
+					ea_t target = 0;
+					memcpy(&target, (p + (bit * ptrSize)), ptrSize);
+					if (!segments.contains(target) || (options.checkLoaded && !idbAccess->isLoaded(target)))
+						continue;
+
+					ea_t ea = (base + offset + ((slot + bit) * ptrSize));
+					if (!run.count || (run.next != ea))
+					{
+						flush(run);
+						run.start = ea;
+					}
+					run.count++;
+					run.next = (ea + ptrSize);
+					found++;
+				}
+			}
+		}
+	}
+
+	for (UINT32 phase = 0; phase < phases; phase++)
+		flush(state[phase]);
+}
+
+static void sortRuns(std::vector<PointerScan::RUN> &runs, size_t first)
+{
+	std::sort((runs.begin() + first), runs.end(), [](const PointerScan::RUN &a, const PointerScan::RUN &b) { return (a.start < b.start); });
+}
+
+
+size_t PointerScan::scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<RUN> &runs)
+{
+	size_t first = runs.size();
+	SCAN scan(options, runs);
+	scan.scan(start, end);
+	sortRuns(runs, first);
+	return scan.found;
+}
+
+size_t PointerScan::scanAll(const OPTIONS &options, __out std::vector<RUN> &runs)
+{
+	size_t first = runs.size();
+	SCAN scan(options, runs);
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+			scan.scan(segment.start, segment.end);
+	}
+	sortRuns(runs, first);
+	return scan.found;
+}
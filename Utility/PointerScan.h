@@ -0,0 +1,35 @@
+
+// IDA utility support: SIMD pointer scanner
+#pragma once
+
+#include <vector>
+
+// Finds pointer sized values in the database that point into it (vtables, callback tables, relocated pointers).
+// Segment bytes are read in bulk through idbAccess, candidates are range filtered against PLAT MinAddress/MaxAddress
+// with SSE2 or AVX2 (runtime dispatch) compares, then checked against a segment interval index and, by default,
+// isLoaded() for IS_VALID_ADDR semantics. Results are runs of consecutive valid pointers.
+// Call plat.Configure() first.
+namespace PointerScan
+{
+	// Run of 'count' consecutive pointers starting at 'start', each 'ptrSize' apart
+	struct RUN
+	{
+		ea_t start;
+		UINT32 count;
+	};
+
+	struct OPTIONS
+	{
+		UINT32 alignment;	// Candidate address alignment, 1 to ptrSize; smaller values scan more offsets
+		UINT32 minRun;		// Only emit runs with at least this many pointers
+		BOOL checkLoaded;	// Also require the target be loaded like IS_VALID_ADDR, else segment membership is enough
+		BOOL noAvx2;		// Force the SSE2 path
+	};
+	inline OPTIONS defaultOptions() { return { plat.ptrSize, 1, TRUE, FALSE }; }
+
+	// Scan [start, end), appending runs sorted by address. Returns the number of valid pointers found.
+	size_t scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<RUN> &runs);
+
+	// Scan every segment
+	size_t scanAll(const OPTIONS &options, __out std::vector<RUN> &runs);
+};
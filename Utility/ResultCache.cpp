@@ -0,0 +1,252 @@
+
+// IDA utility support: Versioned binary analysis result cache
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <nalt.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <ResultCache.h>
+#include <Hash.h>
+
+static const UINT32 CACHE_MAGIC = RESULT_CACHE_ID('I','R','C','F');
+static const UINT16 FORMAT_VERSION = 2;	// 2: Hash::hash64() checksums
+static const UINT64 SECTION_ALIGN = 64;
+
+// File layout: HEADER, SECTION table, sections at 64 byte aligned offsets
+struct HEADER
+{
+	UINT32 magic;
+	UINT16 formatVersion;
+	UINT16 eaSize;			// sizeof(ea_t)
+	UINT32 pluginVersion;	// MAKE_SEMANTIC_VERSION()
+	UINT32 sectionCount;
+	BYTE inputHash[32];		// Input file SHA256
+	UINT64 fileSize;
+	UINT64 checksum;		// Of the header, with this field zero, plus the section table
+};
+static_assert(sizeof(HEADER) == 64, "HEADER size");
+
+struct ResultCache::SECTION
+{
+	UINT32 id, elementSize;
+	UINT64 offset, size;
+	UINT64 checksum;
+};
+typedef ResultCache::SECTION SECTION;
+static_assert(sizeof(SECTION) == 32, "SECTION size");
+
+static inline UINT64 alignUp(UINT64 value) { return ((value + (SECTION_ALIGN - 1)) & ~(SECTION_ALIGN - 1)); }
+
+static UINT64 headerChecksum(const HEADER &header, const SECTION *table)
+{
+	HEADER tmp = header;
+	tmp.checksum = 0;
+	return Hash::hash64(table, ((size_t) header.sectionCount * sizeof(SECTION)), Hash::hash64(&tmp, sizeof(tmp)));
+}
+
+
+LPCSTR ResultCache::statusString(STATUS status)
+{
+	switch (status)
+	{
+		case CACHE_OK:            return "OK";
+		case CACHE_NOT_FOUND:     return "not found";
+		case CACHE_BAD_FORMAT:    return "bad format";
+		case CACHE_STALE_VERSION: return "stale, plugin version changed";
+		case CACHE_STALE_INPUT:   return "stale, input file changed";
+		case CACHE_CORRUPT:       return "corrupt";
+	};
+	return "unknown";
+}
+
+void ResultCache::getPath(LPCSTR name, __out qstring &path)
+{
+	LPCSTR idbPath = get_path(PATH_TYPE_IDB);
+	LPCSTR dot = strrchr(idbPath, '.');
+	if (!dot || strchr(dot, '\\') || strchr(dot, '/'))
+		dot = (idbPath + strlen(idbPath));
+	path.sprnt("%.*s.%s.cache", (int) (dot - idbPath), idbPath, name);
+}
+
+BOOL ResultCache::getInputHash(__out BYTE hash[32])
+{
+	return retrieve_input_file_sha256(hash);
+}
+
+
+void ResultCache::Writer::addSection(UINT32 id, LPCVOID data, UINT64 size, UINT32 elementSize)
+{
+	_ASSERT(!size || data);
+	#ifdef _DEBUG
+	for (const PENDING &p: m_sections)
+		_ASSERT(p.id != id);
+	#endif
+	m_sections.push_back({ id, elementSize, data, size });
+}
+
+BOOL ResultCache::Writer::save(LPCSTR path, __in_opt const BYTE *inputHash)
+{
+	HEADER header = {};
+	header.magic = CACHE_MAGIC;
+	header.formatVersion = FORMAT_VERSION;
+	header.eaSize = sizeof(ea_t);
+	header.pluginVersion = m_pluginVersion;
+	header.sectionCount = (UINT32) m_sections.size();
+	if (inputHash)
+		memcpy(header.inputHash, inputHash, sizeof(header.inputHash));
+	else
+	if (!getInputHash(header.inputHash))
+		return FALSE;
+
+	// Layout and checksum sections
+	std::vector<SECTION> table(m_sections.size());
+	UINT64 offset = alignUp(sizeof(HEADER) + (table.size() * sizeof(SECTION)));
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		const PENDING &p = m_sections[i];
+		table[i] = { p.id, p.elementSize, offset, p.size, Hash::hash64(p.data, (size_t) p.size) };
+		offset = alignUp(offset + p.size);
+	}
+	header.fileSize = offset;
+	header.checksum = headerChecksum(header, table.data());
+
+	qstring tmpPath(path);
+	tmpPath += ".tmp";
+	FILE *fp = fopen(tmpPath.c_str(), "wb");
+	if (!fp)
+		return FALSE;
+
+	static const BYTE zeros[SECTION_ALIGN] = {};
+	UINT64 position = 0;
+	auto put = [&](LPCVOID data, UINT64 size) -> BOOL
+	{
+		position += size;
+		return (!size || (fwrite(data, 1, (size_t) size, fp) == size));
+	};
+	auto pad = [&]() -> BOOL { return put(zeros, (alignUp(position) - position)); };
+
+	BOOL ok = (put(&header, sizeof(header)) && put(table.data(), (table.size() * sizeof(SECTION))) && pad());
+	for (size_t i = 0; ok && (i < m_sections.size()); i++)
+		ok = (put(m_sections[i].data, m_sections[i].size) && pad());
+	if (fclose(fp) != 0)
+		ok = FALSE;
+
+	if (ok)
+	{
+		remove(path);
+		ok = (rename(tmpPath.c_str(), path) == 0);
+	}
+	if (!ok)
+		remove(tmpPath.c_str());
+	return ok;
+}
+
+
+ResultCache::STATUS ResultCache::Reader::open(LPCSTR path, UINT32 pluginVersion, __in_opt const BYTE *inputHash)
+{
+	close();
+	if (!m_file.open(path, MappedFile::HINT_RANDOM))
+		return CACHE_NOT_FOUND;
+
+	const HEADER *header = m_file.at<HEADER>(0);
+	if (!header || (header->magic != CACHE_MAGIC) || (header->formatVersion != FORMAT_VERSION) || (header->eaSize != sizeof(ea_t)))
+	{
+		close();
+		return CACHE_BAD_FORMAT;
+	}
+	if (header->pluginVersion != pluginVersion)
+	{
+		close();
+		return CACHE_STALE_VERSION;
+	}
+	if (inputHash && (memcmp(header->inputHash, inputHash, sizeof(header->inputHash)) != 0))
+	{
+		close();
+		return CACHE_STALE_INPUT;
+	}
+
+	const SECTION *table = m_file.at<SECTION>(sizeof(HEADER), header->sectionCount);
+	BOOL valid = (table && (header->fileSize == m_file.size()) && (header->checksum == headerChecksum(*header, table)));
+	for (UINT32 i = 0; valid && (i < header->sectionCount); i++)
+		valid = ((table[i].offset <= m_file.size()) && (table[i].size <= (m_file.size() - table[i].offset)) && ((table[i].offset % SECTION_ALIGN) == 0));
+	if (!valid)
+	{
+		close();
+		return CACHE_CORRUPT;
+	}
+
+	m_table = table;
+	m_sectionCount = header->sectionCount;
+	m_verified.assign(m_sectionCount, 0);
+	return CACHE_OK;
+}
+
+void ResultCache::Reader::close()
+{
+	m_file.close();
+	m_table = NULL;
+	m_sectionCount = 0;
+	m_verified.clear();
+}
+
+const SECTION *ResultCache::Reader::find(UINT32 id)
+{
+	for (UINT32 i = 0; i < m_sectionCount; i++)
+	{
+		if (m_table[i].id == id)
+			return &m_table[i];
+	}
+	return NULL;
+}
+
+UINT32 ResultCache::Reader::elementSize(UINT32 id)
+{
+	const SECTION *s = find(id);
+	return (s ? s->elementSize : 0);
+}
+
+const void *ResultCache::Reader::section(UINT32 id, __out_opt UINT64 *size)
+{
+	if (size)
+		*size = 0;
+	const SECTION *s = find(id);
+	if (!s)
+		return NULL;
+
+	BYTE &verified = m_verified[s - m_table];
+	if (verified == 0)
+		verified = ((Hash::hash64((m_file.data() + s->offset), (size_t) s->size) == s->checksum) ? 1 : 2);
+	if (verified != 1)
+		return NULL;
+
+	if (size)
+		*size = s->size;
+	return (m_file.data() + s->offset);
+}
+
+BOOL ResultCache::Reader::verifyAll()
+{
+	for (UINT32 i = 0; i < m_sectionCount; i++)
+	{
+		if (!section(m_table[i].id))
+			return FALSE;
+	}
+	return (m_table != NULL);
+}
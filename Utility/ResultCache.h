@@ -0,0 +1,100 @@
+
+// IDA utility support: Versioned binary analysis result cache
+#pragma once
+
+#include <vector>
+#include <MappedFile.h>
+
+// Section IDs are four character codes, I.E. RESULT_CACHE_ID('S','I','G','S')
+#define RESULT_CACHE_ID(_a, _b, _c, _d) ((UINT32) (BYTE) (_a) | ((UINT32) (BYTE) (_b) << 8) | ((UINT32) (BYTE) (_c) << 16) | ((UINT32) (BYTE) (_d) << 24))
+
+// Persisted plugin results keyed to the input file's SHA256 and the plugin's MAKE_SEMANTIC_VERSION.
+// A cache file holds a header, a section table, then 64 byte aligned raw sections (ea_t arrays, structs, blobs).
+// Loading maps the file read only and hands out pointers straight into the view, nothing is parsed or copied.
+// Section checksums are verified on first access.
+namespace ResultCache
+{
+	enum STATUS
+	{
+		CACHE_OK,
+		CACHE_NOT_FOUND,		// No cache file
+		CACHE_BAD_FORMAT,		// Not a cache file, other format version, or ea_t size
+		CACHE_STALE_VERSION,	// Written by another plugin version
+		CACHE_STALE_INPUT,		// Written for a different input file
+		CACHE_CORRUPT			// Truncated or checksum failure
+	};
+	LPCSTR statusString(STATUS status);
+
+	// Get cache file path next to the IDB: "<idb path without extension>.<name>.cache"
+	void getPath(LPCSTR name, __out qstring &path);
+
+	// Get the SHA256 of the current input file, returns FALSE if IDA doesn't have it
+	BOOL getInputHash(__out BYTE hash[32]);
+
+	class Writer
+	{
+	public:
+		Writer(UINT32 pluginVersion) : m_pluginVersion(pluginVersion) {}
+
+		// Add sections by reference, the data must stay valid until save()
+		void addSection(UINT32 id, LPCVOID data, UINT64 size, UINT32 elementSize = 1);
+		template <class T> void addArray(UINT32 id, const T *data, size_t count) { addSection(id, data, ((UINT64) count * sizeof(T)), sizeof(T)); }
+		template <class T> void addArray(UINT32 id, const std::vector<T> &v) { addArray(id, v.data(), v.size()); }
+		void addEaArray(UINT32 id, const ea_t *data, size_t count) { addArray(id, data, count); }
+
+		// Write cache file. Written to a temp file first then renamed so a failed save never leaves a partial cache.
+		// Keyed to the current input file's hash unless 'inputHash' is given.
+		BOOL save(LPCSTR path, __in_opt const BYTE *inputHash = NULL);
+
+	private:
+		struct PENDING
+		{
+			UINT32 id, elementSize;
+			LPCVOID data;
+			UINT64 size;
+		};
+		std::vector<PENDING> m_sections;
+		UINT32 m_pluginVersion;
+	};
+
+	struct SECTION;
+
+	class Reader
+	{
+	public:
+		Reader() : m_table(NULL), m_sectionCount(0) {}
+
+		// Map cache file and validate it against the plugin version and input hash, a NULL 'inputHash' accepts any input
+		STATUS open(LPCSTR path, UINT32 pluginVersion, __in_opt const BYTE *inputHash);
+		void close();
+		BOOL isOpen() { return (m_table != NULL); }
+
+		// Get a section's data, or NULL if it's missing or fails its checksum
+		const void *section(UINT32 id, __out_opt UINT64 *size = NULL);
+		template <class T> const T *array(UINT32 id, __out size_t &count)
+		{
+			UINT64 size = 0;
+			const T *data = (const T *) section(id, &size);
+			count = (size_t) (size / sizeof(T));
+			return (data && ((size % sizeof(T)) == 0) && (elementSize(id) == sizeof(T))) ? data : (count = 0, (const T *) NULL);
+		}
+		const ea_t *eaArray(UINT32 id, __out size_t &count) { return array<ea_t>(id, count); }
+
+		UINT32 sectionCount() { return m_sectionCount; }
+		BOOL hasSection(UINT32 id) { return (find(id) != NULL); }
+
+		// Verify every section now rather than on first access
+		BOOL verifyAll();
+
+	private:
+		DISALLOW_COPY_AND_ASSIGN(Reader);
+
+		const SECTION *find(UINT32 id);
+		UINT32 elementSize(UINT32 id);
+
+		MappedFile m_file;
+		const SECTION *m_table;
+		UINT32 m_sectionCount;
+		std::vector<BYTE> m_verified;	// 0 = not checked, 1 = good, 2 = bad
+	};
+};
@@ -0,0 +1,309 @@
+
+// IDA utility support: End of run performance report
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <psapi.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <nalt.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <RunReport.h>
+
+using namespace RunReport;
+
+// Bumped when fields change meaning, new fields don't need it
+static const UINT32 JSON_FORMAT = 1;
+
+ZONE_TIMES RunReport::zoneTimes[MAX_ZONES];
+
+static CLock zoneLock;
+static char zoneNames[MAX_ZONES][32] = { "Unregistered" };
+static UINT32 zonesUsed = 1;
+
+struct CPU_TIMES
+{
+	TIMESTAMP user, kernel;
+};
+
+// Run start
+static char pluginName[64] = "Plugin";
+static UINT32 pluginVersion = 0;
+static TIMESTAMP startTime = 0.0;
+static time_t startDate = 0;
+static CPU_TIMES startProcess = {}, startThread = {};
+
+// FILETIME is in 100ns units
+static TIMESTAMP fileTimeSeconds(const FILETIME &ft)
+{
+	return ((TIMESTAMP) (((UINT64) ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10000000.0);
+}
+
+static void getProcessTimes(__out CPU_TIMES &times)
+{
+	FILETIME creation, exit, kernel, user;
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		times = { fileTimeSeconds(user), fileTimeSeconds(kernel) };
+	else
+		times = {};
+}
+
+static void getThreadTimes(__out CPU_TIMES &times)
+{
+	FILETIME creation, exit, kernel, user;
+	if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		times = { fileTimeSeconds(user), fileTimeSeconds(kernel) };
+	else
+		times = {};
+}
+
+// Append 'text' as a JSON string
+static void jsonString(__inout qstring &json, LPCSTR text)
+{
+	json += '"';
+	for (; *text; text++)
+	{
+		BYTE c = (BYTE) *text;
+		if ((c == '"') || (c == '\\'))
+		{
+			json += '\\';
+			json += (char) c;
+		}
+		else
+		if (c < ' ')
+			json.cat_sprnt("\\u%04X", c);
+		else
+			json += (char) c;
+	}
+	json += '"';
+}
+
+static void defaultJsonPath(__out qstring &path)
+{
+	LPCSTR idbPath = get_path(PATH_TYPE_IDB);
+	LPCSTR dot = strrchr(idbPath, '.');
+	if (!dot || strchr(dot, '\\') || strchr(dot, '/'))
+		dot = (idbPath + strlen(idbPath));
+	path.sprnt("%.*s.%s.perf.json", (int) (dot - idbPath), idbPath, pluginName);
+}
+
+
+ZONE RunReport::registerZone(LPCSTR name)
+{
+	zoneLock.lock();
+	ZONE zone = UNREGISTERED;
+	for (UINT32 i = 1; i < zonesUsed; i++)
+	{
+		// Names are stored truncated, compare only what fits
+		if (strncmp(zoneNames[i], name, (sizeof(zoneNames[i]) - 1)) == 0)
+		{
+			zone = i;
+			break;
+		}
+	}
+	if ((zone == UNREGISTERED) && (zonesUsed < MAX_ZONES))
+	{
+		strncpy_s(zoneNames[zonesUsed], sizeof(zoneNames[zonesUsed]), name, _TRUNCATE);
+		zone = zonesUsed++;
+	}
+	zoneLock.unlock();
+	return zone;
+}
+
+void RunReport::begin(LPCSTR name, UINT32 version)
+{
+	strncpy_s(pluginName, sizeof(pluginName), name, _TRUNCATE);
+	pluginVersion = version;
+	for (UINT32 i = 0; i < MAX_ZONES; i++)
+	{
+		zoneTimes[i].calls.store(0, std::memory_order_relaxed);
+		zoneTimes[i].ticks.store(0, std::memory_order_relaxed);
+		zoneTimes[i].maxTicks.store(0, std::memory_order_relaxed);
+	}
+
+	startDate = time(NULL);
+	getProcessTimes(startProcess);
+	getThreadTimes(startThread);
+	startTime = GetTimeStamp();
+}
+
+BOOL RunReport::end(__in_opt LPCSTR jsonPath)
+{
+	TIMESTAMP wall = (GetTimeStamp() - startTime);
+	CPU_TIMES process, thread;
+	getProcessTimes(process);
+	getThreadTimes(thread);
+	process.user -= startProcess.user;
+	process.kernel -= startProcess.kernel;
+	thread.user -= startThread.user;
+	thread.kernel -= startThread.kernel;
+	TIMESTAMP processCpu = (process.user + process.kernel);
+	TIMESTAMP threadCpu = (thread.user + thread.kernel);
+	TIMESTAMP otherCpu = (processCpu - threadCpu);
+	if (otherCpu < 0.0)
+		otherCpu = 0.0;
+
+	PROCESS_MEMORY_COUNTERS memory = {};
+	memory.cb = sizeof(memory);
+	GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory));
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	double tickSeconds = (1.0 / (double) frequency.QuadPart);
+
+	qstring version;
+	GetVersionString(pluginVersion, version);
+	char date[32];
+	struct tm utc;
+	gmtime_s(&utc, &startDate);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+	qstring json;
+	json.sprnt("{\n  \"format\": %u,\n  \"plugin\": ", JSON_FORMAT);
+	jsonString(json, pluginName);
+	json += ",\n  \"version\": ";
+	jsonString(json, version.c_str());
+	json.cat_sprnt(",\n  \"date\": \"%s\",\n  \"idb\": ", date);
+	jsonString(json, get_path(PATH_TYPE_IDB));
+	json.cat_sprnt(",\n  \"wallSeconds\": %.6f,\n  \"cpu\": { \"user\": %.6f, \"kernel\": %.6f, \"mainThread\": %.6f, \"otherThreads\": %.6f },\n",
+		wall, process.user, process.kernel, threadCpu, otherCpu);
+	json.cat_sprnt("  \"memory\": { \"peakWorkingSet\": %llu, \"peakPagefile\": %llu }", (UINT64) memory.PeakWorkingSetSize, (UINT64) memory.PeakPagefileUsage);
+
+	// Run
+	char number1[33], number2[32];
+	msg("\n%s %s performance report:\n", pluginName, version.c_str());
+	msg("  Wall time:     %s\n", TimeString(wall));
+	msg("  CPU time:      %s", TimeString(processCpu));
+	msg(" (user %s,", TimeString(process.user));
+	msg(" kernel %s)\n", TimeString(process.kernel));
+	msg("  Main thread:   %s", TimeString(threadCpu));
+	msg(", other threads %s", TimeString(otherCpu));
+	msg(", %.1f cores average\n", ((wall > 0.0) ? (processCpu / wall) : 0.0));
+	msg("  Peak memory:   %s working set", byteSizeString(memory.PeakWorkingSetSize));
+	msg(", %s committed\n", byteSizeString(memory.PeakPagefileUsage));
+
+	// Zones
+	json += ",\n  \"zones\": [";
+	BOOL first = TRUE;
+	zoneLock.lock();
+	UINT32 zoneCount = zonesUsed;
+	zoneLock.unlock();
+	for (UINT32 i = 1; i < zoneCount; i++)
+	{
+		UINT64 calls = zoneTimes[i].calls.load(std::memory_order_relaxed);
+		if (!calls)
+			continue;
+		TIMESTAMP total = ((double) zoneTimes[i].ticks.load(std::memory_order_relaxed) * tickSeconds);
+		TIMESTAMP longest = ((double) zoneTimes[i].maxTicks.load(std::memory_order_relaxed) * tickSeconds);
+		if (first)
+			msg("  %-24s %14s %20s %6s %20s\n", "Zone", "Calls", "Total", "Wall%", "Longest");
+		// Totals add up across threads, parallel zones can pass 100% of the wall time.
+		// TimeString() returns a static buffer
+		char totalText[64];
+		strcpy_s(totalText, sizeof(totalText), TimeString(total));
+		msg("  %-24s %14s %20s %5.1f%% %20s\n", zoneNames[i], NumberCommaString(calls, number1), totalText, ((wall > 0.0) ? ((total * 100.0) / wall) : 0.0), TimeString(longest));
+
+		json += (first ? "\n    { \"name\": " : ",\n    { \"name\": ");
+		first = FALSE;
+		jsonString(json, zoneNames[i]);
+		json.cat_sprnt(", \"calls\": %llu, \"seconds\": %.6f, \"longestSeconds\": %.6f }", calls, total, longest);
+	}
+	json += (first ? "]" : "\n  ]");
+
+	// Counters, rates are run averages
+	json += ",\n  \"counters\": [";
+	first = TRUE;
+	UINT32 counterCount = PerfCounters::counterCount();
+	for (PerfCounters::ID i = 1; i < counterCount; i++)
+	{
+		if (first)
+			msg("  %-24s %20s %16s\n", "Counter", "Value", "Average/s");
+		LPCSTR name = PerfCounters::counterName(i);
+		json += (first ? "\n    { \"name\": " : ",\n    { \"name\": ");
+		first = FALSE;
+		jsonString(json, name);
+
+		PerfCounters::KIND kind = PerfCounters::counterKind(i);
+		if (kind == PerfCounters::KIND_RATIO)
+		{
+			double percent = PerfCounters::ratio(i);
+			msg("  %-24s %19.1f%%\n", name, percent);
+			json.cat_sprnt(", \"kind\": \"ratio\", \"percent\": %.3f }", percent);
+		}
+		else
+		{
+			INT64 value = PerfCounters::value(i);
+			// Signed for gauges that went below their set() level
+			signedCommaString(value, number1);
+
+			if (kind == PerfCounters::KIND_GAUGE)
+			{
+				msg("  %-24s %20s\n", name, number1);
+				json.cat_sprnt(", \"kind\": \"gauge\", \"value\": %lld }", value);
+			}
+			else
+			{
+				double rate = ((wall > 0.0) ? ((double) value / wall) : 0.0);
+				msg("  %-24s %20s %16s\n", name, number1, NumberCommaString((UINT64) ((rate > 0.0) ? rate : 0.0), number2));
+				json.cat_sprnt(", \"kind\": \"counter\", \"value\": %lld, \"perSecond\": %.3f }", value, rate);
+			}
+		}
+	}
+	json += (first ? "]" : "\n  ]");
+
+	// Tracked memory
+	json += ",\n  \"memoryTags\": [";
+	first = TRUE;
+	UINT32 tagCount = MemTrack::tagCount();
+	for (MemTrack::TAG i = 0; i < tagCount; i++)
+	{
+		MemTrack::STATS s;
+		MemTrack::getStats(i, s);
+		if (s.peak <= 0)
+			continue;
+		json += (first ? "\n    { \"name\": " : ",\n    { \"name\": ");
+		first = FALSE;
+		jsonString(json, MemTrack::tagName(i));
+		json.cat_sprnt(", \"current\": %lld, \"peak\": %lld, \"allocs\": %llu, \"frees\": %llu, \"largest\": %llu }", s.current, s.peak, s.allocs, s.frees, s.largest);
+	}
+	json += (first ? "]" : "\n  ]");
+	json += "\n}\n";
+	if (!first)
+		MemTrack::report();
+
+	// JSON twin
+	qstring path;
+	if (jsonPath)
+		path = jsonPath;
+	else
+		defaultJsonPath(path);
+
+	BOOL ok = FALSE;
+	if (FILE *fp = fopen(path.c_str(), "wb"))
+	{
+		ok = (fwrite(json.c_str(), 1, json.length(), fp) == json.length());
+		if (fclose(fp) != 0)
+			ok = FALSE;
+	}
+	if (ok)
+		msg("  Report JSON: \"%s\"\n", path.c_str());
+	else
+		msg("RunReport: Failed to write \"%s\".\n", path.c_str());
+	return ok;
+}
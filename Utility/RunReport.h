@@ -0,0 +1,69 @@
+
+// IDA utility support: End of run performance report
+#pragma once
+
+// One fixed format report per plugin run, so numbers from different plugins and versions line up and aggregate.
+// Call begin() when the plugin starts its work and end() at exit. end() prints wall and CPU times, the PROFILE_ZONE
+// timings, the PerfCounters totals and the MemTrack table, and writes the same data as JSON next to the IDB.
+// CPU time is split into the calling, main, thread and the rest of the process, since ParallelFor() workers have
+// exited by then.
+namespace RunReport
+{
+	typedef UINT32 ZONE;
+	static const ZONE UNREGISTERED = 0;
+	static const UINT32 MAX_ZONES = 64;
+
+	struct ALIGN(64) ZONE_TIMES
+	{
+		std::atomic<UINT64> calls;
+		std::atomic<UINT64> ticks;		// Total, in performance counter ticks
+		std::atomic<UINT64> maxTicks;	// Longest single call
+	};
+	extern ZONE_TIMES zoneTimes[MAX_ZONES];
+
+	// Get the zone for a name, the same name returns the same zone.
+	// Returns UNREGISTERED, which times nothing, if the table is full.
+	ZONE registerZone(LPCSTR name);
+
+	// Times its scope into a zone, I.E. a pass, a phase or a per function step. Atomic adds at scope exit so keep
+	// zones coarser than per instruction. Nested zones count inclusive time.
+	class ScopedZone
+	{
+	public:
+		ScopedZone(ZONE zone) : m_zone(zone)
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			m_start = now.QuadPart;
+		}
+		~ScopedZone()
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			UINT64 ticks = (UINT64) (now.QuadPart - m_start);
+			ZONE_TIMES &z = zoneTimes[m_zone];
+			z.calls.fetch_add(1, std::memory_order_relaxed);
+			z.ticks.fetch_add(ticks, std::memory_order_relaxed);
+			UINT64 longest = z.maxTicks.load(std::memory_order_relaxed);
+			while ((ticks > longest) && !z.maxTicks.compare_exchange_weak(longest, ticks, std::memory_order_relaxed)) {};
+		}
+
+	private:
+		ZONE m_zone;
+		INT64 m_start;
+	};
+
+	// Start the run clocks and clear the zone times
+	void begin(LPCSTR pluginName, UINT32 pluginVersion);
+
+	// Print the report and write the JSON twin, returns FALSE if the JSON file couldn't be written.
+	// 'jsonPath' defaults to "<idb>.<plugin name>.perf.json".
+	BOOL end(__in_opt LPCSTR jsonPath = NULL);
+};
+
+#define PROFILE_ZONE_CAT2(_a, _b) _a##_b
+#define PROFILE_ZONE_CAT(_a, _b) PROFILE_ZONE_CAT2(_a, _b)
+// Time the rest of the scope as zone '_name', I.E. PROFILE_ZONE("Find functions");
+#define PROFILE_ZONE(_name) \
+	static const RunReport::ZONE PROFILE_ZONE_CAT(_zoneId, __LINE__) = RunReport::registerZone(_name); \
+	RunReport::ScopedZone PROFILE_ZONE_CAT(_zone, __LINE__)(PROFILE_ZONE_CAT(_zoneId, __LINE__))
@@ -0,0 +1,246 @@
+
+// IDA utility support: Concurrent string interning pool
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <name.hpp>
+#include <segment.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <StringPool.h>
+
+// Max entries per stripe, limited by the handle bits
+static const UINT32 MAX_INDEX = ((1 << (32 - 6)) - 2);
+static const UINT32 FIRST_TABLE_SIZE = 1024;
+
+
+// Word at a time string hash. The stripe comes from the top bits, table slots from the low bits.
+static UINT64 hashString(LPCSTR str, size_t length)
+{
+	UINT64 h = (0x9E3779B97F4A7C15ull ^ length);
+	while (length >= sizeof(UINT64))
+	{
+		UINT64 v;
+		memcpy(&v, str, sizeof(UINT64));
+		h = ((h ^ v) * 0xFF51AFD7ED558CCDull);
+		h ^= (h >> 32);
+		str += sizeof(UINT64), length -= sizeof(UINT64);
+	}
+	if (length)
+	{
+		UINT64 v = 0;
+		memcpy(&v, str, length);
+		h = ((h ^ v) * 0xFF51AFD7ED558CCDull);
+		h ^= (h >> 32);
+	}
+	h *= 0xC4CEB9FE1A85EC53ull;
+	return (h ^ (h >> 29));
+}
+
+
+StringPool::StringPool()
+{
+	m_stripes = new STRIPE[STRIPES];
+	m_tag = MemTrack::registerTag("StringPool");
+}
+
+StringPool::~StringPool()
+{
+	clear();
+	delete[] m_stripes;
+}
+
+void StringPool::clear()
+{
+	for (UINT32 i = 0; i < STRIPES; i++)
+	{
+		STRIPE &s = m_stripes[i];
+		if (s.table)
+		{
+			free(s.table);
+			MemTrack::onFree(m_tag, ((s.tableMask + 1) * sizeof(UINT32)));
+		}
+		s.table = NULL;
+		s.tableMask = 0;
+		s.count = 0;
+		s.arena.clear();
+		for (UINT32 j = 0; j < MAX_CHUNKS; j++)
+		{
+			if (ENTRY *entries = s.chunks[j].load(std::memory_order_relaxed))
+			{
+				free(entries);
+				MemTrack::onFree(m_tag, ((FIRST_CHUNK << j) * sizeof(ENTRY)));
+			}
+			s.chunks[j].store(NULL, std::memory_order_relaxed);
+		}
+	}
+}
+
+// Find string in stripe table, returns handle or 0 with 'slot' set to the empty slot to insert it at.
+// Stripe lock must be held.
+STRID StringPool::lookup(STRIPE &s, UINT32 stripe, LPCSTR str, size_t length, UINT32 hash, __out UINT32 &slot)
+{
+	if (!s.table)
+	{
+		slot = 0;
+		return 0;
+	}
+
+	for (UINT32 i = (hash & s.tableMask);; i = ((i + 1) & s.tableMask))
+	{
+		UINT32 index = s.table[i];
+		if (!index)
+		{
+			slot = i;
+			return 0;
+		}
+
+		STRID id = ((index << STRIPE_BITS) | stripe);
+		const ENTRY &e = entry(id);
+		if ((e.hash == hash) && (e.length == length) && (memcmp(e.str, str, length) == 0))
+			return id;
+	}
+}
+
+// Double table size, rehashing from stored entry hashes. Stripe lock must be held.
+BOOL StringPool::growTable(STRIPE &s)
+{
+	UINT32 size = (s.table ? ((s.tableMask + 1) * 2) : FIRST_TABLE_SIZE);
+	UINT32 *table = (UINT32 *) calloc(size, sizeof(UINT32));
+	if (!table)
+		return FALSE;
+
+	UINT32 mask = (size - 1);
+	for (UINT32 index = 0; index < s.count; index++)
+	{
+		UINT32 offset, chunk = chunkOf(index, offset);
+		UINT32 i = (s.chunks[chunk].load(std::memory_order_relaxed)[offset].hash & mask);
+		while (table[i])
+			i = ((i + 1) & mask);
+		table[i] = (index + 1);
+	}
+
+	MemTrack::onRealloc(m_tag, (s.table ? ((s.tableMask + 1) * sizeof(UINT32)) : 0), (size * sizeof(UINT32)));
+	if (s.table)
+		free(s.table);
+	s.table = table;
+	s.tableMask = mask;
+	return TRUE;
+}
+
+STRID StringPool::intern(LPCSTR str, size_t length)
+{
+	UINT64 h = hashString(str, length);
+	UINT32 stripe = (UINT32) (h >> (64 - STRIPE_BITS)), hash = (UINT32) h;
+	STRIPE &s = m_stripes[stripe];
+
+	s.lock.lock();
+	UINT32 slot;
+	STRID id = lookup(s, stripe, str, length, hash, slot);
+	if (!id && (s.count < MAX_INDEX) && (length <= 0xFFFFFFFF))
+	{
+		// Keep load under 70%
+		BOOL ok = TRUE;
+		if (!s.table || (((UINT64) (s.count + 1) * 10) > ((UINT64) (s.tableMask + 1) * 7)))
+		{
+			if ((ok = growTable(s)))
+				lookup(s, stripe, str, length, hash, slot);
+		}
+
+		UINT32 index = s.count;
+		UINT32 offset, chunk = chunkOf(index, offset);
+		ENTRY *entries = s.chunks[chunk].load(std::memory_order_relaxed);
+		if (ok && !entries)
+		{
+			if ((entries = (ENTRY *) malloc((FIRST_CHUNK << chunk) * sizeof(ENTRY))))
+			{
+				MemTrack::onAlloc(m_tag, ((FIRST_CHUNK << chunk) * sizeof(ENTRY)));
+				s.chunks[chunk].store(entries, std::memory_order_release);
+			}
+		}
+
+		LPSTR copy = ((ok && entries) ? s.arena.copyString(str, length) : NULL);
+		if (copy)
+		{
+			entries[offset].str = copy;
+			entries[offset].length = (UINT32) length;
+			entries[offset].hash = hash;
+			s.table[slot] = (index + 1);
+			s.count++;
+			id = (((index + 1) << STRIPE_BITS) | stripe);
+		}
+	}
+	s.lock.unlock();
+	return id;
+}
+
+STRID StringPool::find(LPCSTR str, size_t length)
+{
+	UINT64 h = hashString(str, length);
+	UINT32 stripe = (UINT32) (h >> (64 - STRIPE_BITS)), slot;
+	STRIPE &s = m_stripes[stripe];
+
+	s.lock.lock();
+	STRID id = lookup(s, stripe, str, length, (UINT32) h, slot);
+	s.lock.unlock();
+	return id;
+}
+
+STRID StringPool::internName(ea_t ea, int gtnFlags)
+{
+	qstring name;
+	if (get_name(&name, ea, gtnFlags) > 0)
+		return intern(name);
+	return 0;
+}
+
+STRID StringPool::internSegmentName(segment_t *seg)
+{
+	qstring name;
+	if (seg && (get_segm_name(&name, seg) > 0))
+		return intern(name);
+	return 0;
+}
+
+size_t StringPool::count()
+{
+	size_t total = 0;
+	for (UINT32 i = 0; i < STRIPES; i++)
+		total += m_stripes[i].count;
+	return total;
+}
+
+size_t StringPool::memoryUsage()
+{
+	size_t total = (STRIPES * sizeof(STRIPE));
+	for (UINT32 i = 0; i < STRIPES; i++)
+	{
+		STRIPE &s = m_stripes[i];
+		s.lock.lock();
+		total += s.arena.reserved();
+		if (s.table)
+			total += ((s.tableMask + 1) * sizeof(UINT32));
+		for (UINT32 j = 0; j < MAX_CHUNKS; j++)
+		{
+			if (s.chunks[j].load(std::memory_order_relaxed))
+				total += ((FIRST_CHUNK << j) * sizeof(ENTRY));
+		}
+		s.lock.unlock();
+	}
+	return total;
+}
@@ -0,0 +1,99 @@
+
+// IDA utility support: Concurrent string interning pool
+#pragma once
+
+#include <atomic>
+
+// Interned string handle, zero is invalid. Equal strings from the same pool always get the same handle.
+typedef UINT32 STRID;
+
+// Thread safe string interning pool for names and other highly duplicated string data.
+// Each unique string is stored once in arena memory and identified by a stable 32bit handle, so name heavy passes can
+// compare and hash integers instead of strings.
+// Insertion is lock striped over 64 independent hash tables by string hash; handle to string lookup is lock free.
+class StringPool
+{
+public:
+	StringPool();
+	~StringPool();
+
+	// Get handle for string, adding it as needed. Returns 0 on allocation failure or pool full.
+	STRID intern(LPCSTR str, size_t length);
+	STRID intern(LPCSTR str) { return intern(str, strlen(str)); }
+	STRID intern(const qstring &str) { return intern(str.c_str(), str.length()); }
+
+	// Get handle for string if it is in the pool, else 0
+	STRID find(LPCSTR str, size_t length);
+
+	// String for handle, valid for the life of the pool. The 0 handle gets an empty string.
+	LPCSTR get(STRID id) { return (id ? entry(id).str : ""); }
+	UINT32 length(STRID id) { return (id ? entry(id).length : 0); }
+
+	// Intern name at address via get_name(), returns 0 if no name
+	STRID internName(ea_t ea, int gtnFlags = 0);
+
+	// Intern segment name, returns 0 if no name
+	STRID internSegmentName(segment_t *seg);
+
+	// Free all strings, invalidating all handles. Not thread safe.
+	void clear();
+
+	size_t count();
+	size_t memoryUsage();
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(StringPool);
+
+	// Entry chunks double in size starting from FIRST_CHUNK so small pools stay small
+	static const UINT32 STRIPE_BITS = 6, STRIPES = (1 << STRIPE_BITS);
+	static const UINT32 FIRST_CHUNK_BITS = 8, FIRST_CHUNK = (1 << FIRST_CHUNK_BITS);
+	static const UINT32 MAX_CHUNKS = ((32 - STRIPE_BITS) - FIRST_CHUNK_BITS + 1);
+
+	struct ENTRY
+	{
+		LPCSTR str;
+		UINT32 length;
+		UINT32 hash;
+	};
+
+	struct ALIGN(64) STRIPE
+	{
+		STRIPE() : table(NULL), tableMask(0), count(0), arena(64 * 1024, MemTrack::registerTag("StringPool"))
+		{
+			for (UINT32 i = 0; i < MAX_CHUNKS; i++)
+				chunks[i].store(NULL, std::memory_order_relaxed);
+		}
+
+		CLock lock;
+		UINT32 *table;				// Open addressing table of entry index + 1, zero empty
+		UINT32 tableMask;
+		UINT32 count;
+		Arena arena;				// String storage
+		std::atomic<ENTRY *> chunks[MAX_CHUNKS];	// Entries by index, chunks never move so readers need no lock
+	};
+
+	// Chunk and offset of entry index
+	static inline UINT32 chunkOf(UINT32 index, __out UINT32 &offset)
+	{
+		unsigned long bit;
+		UINT32 v = (index + FIRST_CHUNK);
+		_BitScanReverse(&bit, v);
+		UINT32 chunk = (bit - FIRST_CHUNK_BITS);
+		offset = (v - (FIRST_CHUNK << chunk));
+		return chunk;
+	}
+
+	// Handle is (index + 1) << STRIPE_BITS | stripe
+	inline const ENTRY &entry(STRID id)
+	{
+		STRIPE &s = m_stripes[id & (STRIPES - 1)];
+		UINT32 offset, chunk = chunkOf(((id >> STRIPE_BITS) - 1), offset);
+		return s.chunks[chunk].load(std::memory_order_acquire)[offset];
+	}
+
+	STRID lookup(STRIPE &s, UINT32 stripe, LPCSTR str, size_t length, UINT32 hash, __out UINT32 &slot);
+	BOOL growTable(STRIPE &s);
+
+	STRIPE *m_stripes;
+	MemTrack::TAG m_tag;		// Tables and entry chunks, the arenas account for themselves
+};
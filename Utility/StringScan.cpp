@@ -0,0 +1,437 @@
+
+// IDA utility support: SIMD string discovery
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <intrin.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <nalt.hpp>
+#include <name.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <IdbEditQueue.h>
+#include <StringScan.h>
+
+// Bytes per work item
+static const size_t CHUNK_SIZE = (4 * 1024 * 1024);
+// Bytes before each chunk, to tell if a run starts in it or continues from the previous one
+static const size_t LEAD = 2;
+// Fill for bytes outside the segment and the classify padding, neither text nor a terminator
+static const BYTE FILL = 0x01;
+
+using namespace StringScan;
+
+// A chunk's bytes, its view is [ea - LEAD, ea + size + tail)
+struct CHUNK
+{
+	ea_t ea;
+	size_t size;
+	std::vector<BYTE> data;
+	size_t length;		// Valid bytes in data
+	std::vector<STRING> found;
+};
+
+
+// SSE2 text classify of 64 bytes to bit masks
+static inline void classify64(const BYTE *p, BOOL controls, __out UINT64 &printable, __out UINT64 &high, __out UINT64 &zero)
+{
+	const __m128i low = _mm_set1_epi8(0x1F), del = _mm_set1_epi8(0x7F), nul = _mm_setzero_si128();
+	const __m128i tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+	printable = high = zero = 0;
+	for (UINT32 i = 0; i < 4; i++)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + (i * 16)));
+		// Signed compares, so bytes >= 0x80 fail the > 0x1F test
+		__m128i text = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, del));
+		if (controls)
+			text = _mm_or_si128(text, _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr))));
+		printable |= ((UINT64) (UINT32) _mm_movemask_epi8(text) << (i * 16));
+		high |= ((UINT64) (UINT32) _mm_movemask_epi8(v) << (i * 16));
+		zero |= ((UINT64) (UINT32) _mm_movemask_epi8(_mm_cmpeq_epi8(v, nul)) << (i * 16));
+	}
+}
+
+// SSE2 classify of 64 UTF-16LE units (128 bytes) to bit masks
+static inline void classify64Units(const BYTE *p, BOOL controls, __out UINT64 &printable, __out UINT64 &zero)
+{
+	const __m128i low = _mm_set1_epi16(0x1F), del = _mm_set1_epi16(0x7F), nul = _mm_setzero_si128();
+	const __m128i tab = _mm_set1_epi16('\t'), lf = _mm_set1_epi16('\n'), cr = _mm_set1_epi16('\r');
+	printable = zero = 0;
+	for (UINT32 i = 0; i < 4; i++)
+	{
+		// Two loads of 8 units each, the 16bit masks packed to bytes for one movemask
+		__m128i mask[2], zeroMask[2];
+		for (UINT32 j = 0; j < 2; j++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i *) (p + (i * 32) + (j * 16)));
+			__m128i text = _mm_and_si128(_mm_cmpgt_epi16(v, low), _mm_cmplt_epi16(v, del));
+			if (controls)
+				text = _mm_or_si128(text, _mm_or_si128(_mm_cmpeq_epi16(v, tab), _mm_or_si128(_mm_cmpeq_epi16(v, lf), _mm_cmpeq_epi16(v, cr))));
+			mask[j] = text;
+			zeroMask[j] = _mm_cmpeq_epi16(v, nul);
+		}
+		printable |= ((UINT64) (UINT32) _mm_movemask_epi8(_mm_packs_epi16(mask[0], mask[1])) << (i * 16));
+		zero |= ((UINT64) (UINT32) _mm_movemask_epi8(_mm_packs_epi16(zeroMask[0], zeroMask[1])) << (i * 16));
+	}
+}
+
+// Next position >= 'from' whose bit is 'value', or 'count' if none
+static size_t findBit(const UINT64 *bits, size_t from, size_t count, BOOL value)
+{
+	while (from < count)
+	{
+		size_t w = (from >> 6);
+		UINT64 word = (value ? bits[w] : ~bits[w]);
+		word &= (~0ull << (from & 63));
+		if (word)
+		{
+			unsigned long bit;
+			_BitScanForward64(&bit, word);
+			size_t position = ((w << 6) + bit);
+			return ((position < count) ? position : count);
+		}
+		from = ((w + 1) << 6);
+	}
+	return count;
+}
+
+// Mark the positions that start at least 'length' (capped at 64) consecutive set bits, so runs too short to be
+// a string are skipped without visiting them. The first mark in a long enough run is its start.
+static void markRuns(const std::vector<UINT64> &bits, UINT32 length, __out std::vector<UINT64> &starts)
+{
+	size_t words = bits.size();
+	starts.assign(bits.begin(), bits.end());
+	if (length > 64)
+		length = 64;
+	for (UINT32 k = 1; k < length; k++)
+	{
+		for (size_t w = 0; w < words; w++)
+		{
+			UINT64 next = (((w + 1) < words) ? bits[w + 1] : 0);
+			starts[w] &= ((bits[w] >> k) | (next << (64 - k)));
+		}
+	}
+}
+
+// Validate UTF-8 in [p, end), returns the character count or -1 if invalid
+static INT64 utf8Characters(const BYTE *p, const BYTE *end)
+{
+	INT64 characters = 0;
+	while (p < end)
+	{
+		BYTE c = *p;
+		size_t extra;
+		UINT32 min;
+		if (c < 0x80)
+			extra = 0, min = 0;
+		else
+		if ((c & 0xE0) == 0xC0)
+			extra = 1, min = 0x80;
+		else
+		if ((c & 0xF0) == 0xE0)
+			extra = 2, min = 0x800;
+		else
+		if ((c & 0xF8) == 0xF0)
+			extra = 3, min = 0x10000;
+		else
+			return -1;
+		if ((size_t) (end - p) <= extra)
+			return -1;
+
+		UINT32 cp = (c & (0x7F >> extra));
+		for (size_t i = 1; i <= extra; i++)
+		{
+			if ((p[i] & 0xC0) != 0x80)
+				return -1;
+			cp = ((cp << 6) | (p[i] & 0x3F));
+		}
+		// No overlong forms, surrogates, or past the Unicode range
+		if ((cp < min) || ((cp >= 0xD800) && (cp <= 0xDFFF)) || (cp > 0x10FFFF))
+			return -1;
+		p += (extra + 1);
+		characters++;
+	}
+	return characters;
+}
+
+
+class Scanner
+{
+public:
+	Scanner(const OPTIONS &options) : m_options(options)
+	{
+		// Plain STRTYPE_C until queueCreate() adds the encoding, the scan doesn't change the IDB
+		m_utf8Type = STRTYPE_C;
+		if (m_options.encodings & ENCODING_UTF8)
+		{
+			int encoding = find_encoding("UTF-8");
+			if (encoding > 0)
+				m_utf8Type = set_str_encoding_idx(STRTYPE_C, encoding);
+		}
+		if (!m_options.maxLength)
+			m_options.maxLength = defaultOptions().maxLength;
+		if (m_options.minLength > m_options.maxLength)
+			m_options.minLength = m_options.maxLength;
+		m_threads = (m_options.threads ? m_options.threads : std::thread::hardware_concurrency());
+		if (!m_threads)
+			m_threads = 1;
+		// Enough tail for a maximum length UTF-16 run and terminator
+		m_tail = (((size_t) m_options.maxLength * 2) + 2);
+	}
+
+	size_t scanRange(ea_t start, ea_t end, std::vector<STRING> &strings);
+
+private:
+	void scanChunk(CHUNK &chunk);
+	void scanBytes(CHUNK &chunk, std::vector<UINT64> &bits, std::vector<UINT64> &zeros, std::vector<UINT64> &starts);
+	void scanUnits(CHUNK &chunk, std::vector<UINT64> &bits, std::vector<UINT64> &zeros, std::vector<UINT64> &starts);
+	void emitBytes(CHUNK &chunk, size_t start, size_t end, BOOL utf8, INT64 characters);
+
+	OPTIONS m_options;
+	int m_utf8Type;
+	UINT32 m_threads;
+	size_t m_tail;
+};
+
+// Read a batch of chunks on this thread, classify them in parallel, repeat
+size_t Scanner::scanRange(ea_t start, ea_t end, std::vector<STRING> &strings)
+{
+	size_t first = strings.size();
+	std::vector<CHUNK> batch(m_threads * 2);
+	for (ea_t ea = start; ea < end;)
+	{
+		size_t count = 0;
+		for (; (count < batch.size()) && (ea < end); count++)
+		{
+			CHUNK &chunk = batch[count];
+			chunk.ea = ea;
+			chunk.size = (((end - ea) < CHUNK_SIZE) ? (size_t) (end - ea) : CHUNK_SIZE);
+			size_t tail = (((end - (ea + chunk.size)) < m_tail) ? (size_t) (end - (ea + chunk.size)) : m_tail);
+			size_t lead = (((ea - start) < LEAD) ? (size_t) (ea - start) : LEAD);
+
+			// Room for the classify passes to run past the end
+			chunk.data.resize(LEAD + chunk.size + tail + 192);
+			memset(chunk.data.data(), FILL, (LEAD - lead));
+			chunk.length = (LEAD + chunk.size + tail);
+			ssize_t read = idbAccess->getBytes(&chunk.data[LEAD - lead], (lead + chunk.size + tail), (ea - lead));
+			if (read < (ssize_t) (lead + chunk.size + tail))
+				chunk.length = ((read > 0) ? ((LEAD - lead) + (size_t) read) : 0);
+			memset(&chunk.data[chunk.length], FILL, (chunk.data.size() - chunk.length));
+			chunk.found.clear();
+			ea += chunk.size;
+		}
+
+		ParallelFor(count, [&](size_t i) { scanChunk(batch[i]); }, m_threads);
+		for (size_t i = 0; i < count; i++)
+			strings.insert(strings.end(), batch[i].found.begin(), batch[i].found.end());
+	}
+
+	// UTF-16 runs interleave the byte runs
+	std::sort((strings.begin() + first), strings.end(), [](const STRING &a, const STRING &b) { return ((a.ea != b.ea) ? (a.ea < b.ea) : (a.strtype < b.strtype)); });
+
+	if (m_options.skipDefined)
+	{
+		auto defined = [](const STRING &s)
+		{
+			flags64_t flags = idbAccess->getFlags(s.ea);
+			return (is_code(flags) || is_tail(flags) || is_strlit(flags));
+		};
+		strings.erase(std::remove_if((strings.begin() + first), strings.end(), defined), strings.end());
+	}
+	return (strings.size() - first);
+}
+
+void Scanner::scanChunk(CHUNK &chunk)
+{
+	std::vector<UINT64> bits, zeros, starts;
+	if (m_options.encodings & (ENCODING_ASCII | ENCODING_UTF8))
+		scanBytes(chunk, bits, zeros, starts);
+	if (m_options.encodings & ENCODING_UTF16LE)
+		scanUnits(chunk, bits, zeros, starts);
+}
+
+// Emit a single byte character run at data [start, end), cutting it at maxLength
+void Scanner::emitBytes(CHUNK &chunk, size_t start, size_t end, BOOL utf8, INT64 characters)
+{
+	const BYTE *data = chunk.data.data();
+	BOOL terminated = (data[end] == 0);
+	if ((UINT64) characters > m_options.maxLength)
+	{
+		characters = m_options.maxLength;
+		terminated = FALSE;
+		if (!utf8)
+			end = (start + m_options.maxLength);
+		else
+		{
+			end = start;
+			for (UINT32 i = 0; i <= m_options.maxLength; end++)
+			{
+				if ((data[end] & 0xC0) != 0x80)
+					i++;
+			}
+			end--;
+		}
+	}
+	if (((UINT64) characters < m_options.minLength) || (m_options.requireTerminator && !terminated))
+		return;
+
+	STRING s = { ((chunk.ea - LEAD) + start), (UINT32) ((end - start) + (terminated ? 1 : 0)), (UINT32) characters, (utf8 ? m_utf8Type : STRTYPE_C), utf8 };
+	chunk.found.push_back(s);
+}
+
+void Scanner::scanBytes(CHUNK &chunk, std::vector<UINT64> &bits, std::vector<UINT64> &zeros, std::vector<UINT64> &starts)
+{
+	const BYTE *data = chunk.data.data();
+	size_t count = chunk.length;
+	size_t words = ((count + 63) / 64);
+	bits.resize(words);
+	zeros.resize(words);
+	std::vector<UINT64> highs(words);
+
+	BOOL utf8 = ((m_options.encodings & ENCODING_UTF8) != 0);
+	BOOL ascii = ((m_options.encodings & ENCODING_ASCII) != 0);
+	for (size_t w = 0; w < words; w++)
+	{
+		UINT64 printable, high;
+		classify64(&data[w * 64], m_options.allowControls, printable, high, zeros[w]);
+		bits[w] = (utf8 ? (printable | high) : printable);
+		highs[w] = high;
+	}
+
+	// Runs that start in this chunk, earlier ones belong to the previous chunk
+	size_t ownEnd = (LEAD + chunk.size);
+	if (ownEnd > count)
+		ownEnd = count;
+	markRuns(bits, m_options.minLength, starts);
+	for (size_t start = findBit(starts.data(), 0, count, TRUE); start < ownEnd; start = findBit(starts.data(), start, count, TRUE))
+	{
+		size_t end = findBit(bits.data(), start, count, FALSE);
+		if (start >= LEAD)
+		{
+			BOOL hasHigh = (findBit(highs.data(), start, end, TRUE) < end);
+			INT64 characters = (hasHigh ? utf8Characters(&data[start], &data[end]) : -1);
+			if (characters > 0)
+				emitBytes(chunk, start, end, TRUE, characters);
+			else
+			if (!hasHigh)
+			{
+				if (ascii)
+					emitBytes(chunk, start, end, FALSE, (INT64) (end - start));
+			}
+			else
+			if (ascii)
+			{
+				// Not valid UTF-8, take the ASCII pieces between the high bytes
+				for (size_t a = start; a < end;)
+				{
+					size_t b = findBit(highs.data(), a, end, TRUE);
+					if (b > a)
+						emitBytes(chunk, a, b, FALSE, (INT64) (b - a));
+					a = findBit(highs.data(), b, end, FALSE);
+				}
+			}
+		}
+		start = end;
+	}
+}
+
+void Scanner::scanUnits(CHUNK &chunk, std::vector<UINT64> &bits, std::vector<UINT64> &zeros, std::vector<UINT64> &starts)
+{
+	// Units at even addresses
+	const BYTE *data = chunk.data.data();
+	size_t base = (size_t) ((chunk.ea - LEAD) & 1);
+	size_t count = ((chunk.length > base) ? ((chunk.length - base) / 2) : 0);
+	size_t words = ((count + 63) / 64);
+	bits.resize(words);
+	zeros.resize(words);
+	for (size_t w = 0; w < words; w++)
+		classify64Units(&data[base + (w * 128)], m_options.allowControls, bits[w], zeros[w]);
+
+	// First unit that starts at or after LEAD, and the first past this chunk
+	size_t ownStart = ((LEAD - base + 1) / 2);
+	size_t ownEnd = (((LEAD + chunk.size) - base + 1) / 2);
+	if (ownEnd > count)
+		ownEnd = count;
+	markRuns(bits, m_options.minLength, starts);
+	for (size_t start = findBit(starts.data(), 0, count, TRUE); start < ownEnd; start = findBit(starts.data(), start, count, TRUE))
+	{
+		size_t end = findBit(bits.data(), start, count, FALSE);
+		if (start >= ownStart)
+		{
+			size_t characters = (end - start);
+			BOOL terminated = ((end < count) && (zeros[end >> 6] & (1ull << (end & 63))));
+			if (characters > m_options.maxLength)
+			{
+				characters = m_options.maxLength;
+				terminated = FALSE;
+			}
+			if ((characters >= m_options.minLength) && (terminated || !m_options.requireTerminator))
+			{
+				STRING s = { ((chunk.ea - LEAD) + base + (start * 2)), (UINT32) ((characters + (terminated ? 1 : 0)) * 2), (UINT32) characters, STRTYPE_C_16, FALSE };
+				chunk.found.push_back(s);
+			}
+		}
+		start = end;
+	}
+}
+
+
+size_t StringScan::scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<STRING> &strings)
+{
+	Scanner scanner(options);
+	size_t found = 0;
+	UINT32 count = idbAccess->segmentCount();
+	for (UINT32 i = 0; i < count; i++)
+	{
+		IDB_SEGMENT segment;
+		if (idbAccess->getSegment(i, segment))
+		{
+			ea_t lo = ((start > segment.start) ? start : segment.start);
+			ea_t hi = ((end < segment.end) ? end : segment.end);
+			if (lo < hi)
+				found += scanner.scanRange(lo, hi, strings);
+		}
+	}
+	return found;
+}
+
+size_t StringScan::scanAll(const OPTIONS &options, __out std::vector<STRING> &strings)
+{
+	return scan(0, BADADDR, options, strings);
+}
+
+void StringScan::queueCreate(const std::vector<STRING> &strings, IdbEditQueue &queue)
+{
+	int utf8Type = -1;
+	for (const STRING &s: strings)
+	{
+		if (s.utf8)
+		{
+			// First UTF-8 string, add the encoding now that strings of it are being created
+			if (utf8Type == -1)
+			{
+				int encoding = find_encoding("UTF-8");
+				if (encoding <= 0)
+					encoding = add_encoding("UTF-8");
+				utf8Type = ((encoding > 0) ? set_str_encoding_idx(STRTYPE_C, encoding) : STRTYPE_C);
+			}
+			queue.createStrlit(s.ea, s.length, utf8Type);
+		}
+		else
+			queue.createStrlit(s.ea, s.length, s.strtype);
+	}
+}
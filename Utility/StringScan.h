@@ -0,0 +1,54 @@
+
+// IDA utility support: SIMD string discovery
+#pragma once
+
+#include <vector>
+
+class IdbEditQueue;
+
+// Finds printable ASCII, UTF-16LE and UTF-8 string runs in raw segment bytes, for when IDA's string list rebuild
+// is too slow (large memory dumps) or misses strings that aren't referenced.
+// Bytes are read through idbAccess on the calling thread in chunks, then classified 16 bytes at a time with SSE2
+// across worker threads. Candidates come back address sorted with their STRTYPE_* code, ready to queue for a
+// batched create_strlit() commit.
+namespace StringScan
+{
+	enum ENCODING
+	{
+		ENCODING_ASCII   = 1,
+		ENCODING_UTF16LE = 2,	// Even address, ASCII range characters
+		ENCODING_UTF8    = 4,	// Runs with valid multibyte UTF-8, pure ASCII runs stay ASCII
+		ENCODING_ALL     = 7
+	};
+
+	struct OPTIONS
+	{
+		UINT32 encodings;		// ENCODING_* bits
+		UINT32 minLength;		// Minimum characters
+		UINT32 maxLength;		// Longer runs are cut to this many characters, without a terminator
+		BOOL requireTerminator;	// Must end with a NUL character
+		BOOL allowControls;		// Count tab, CR and LF as printable
+		BOOL skipDefined;		// Drop candidates starting in code, in another item, or on an existing string
+		UINT32 threads;			// 0 for all hardware threads
+	};
+	inline OPTIONS defaultOptions() { return { ENCODING_ALL, 5, 4096, FALSE, TRUE, TRUE, 0 }; }
+
+	struct STRING
+	{
+		ea_t ea;
+		UINT32 length;		// Bytes, including the terminator if any
+		UINT32 characters;	// Sans terminator
+		int strtype;		// STRTYPE_C, STRTYPE_C_16, or STRTYPE_C with the UTF-8 encoding if the IDB has it
+		BOOL utf8;			// Multibyte UTF-8 run
+	};
+
+	// Scan [start, end) of the segments, appending address sorted candidates. Returns the count found.
+	size_t scan(ea_t start, ea_t end, const OPTIONS &options, __out std::vector<STRING> &strings);
+
+	// Scan every segment
+	size_t scanAll(const OPTIONS &options, __out std::vector<STRING> &strings);
+
+	// Queue a create_strlit() per candidate, commit with IdbEditQueue::commit().
+	// Adds the UTF-8 encoding to the IDB if there are UTF-8 candidates and it isn't there yet; scanning only reads.
+	void queueCreate(const std::vector<STRING> &strings, IdbEditQueue &queue);
+};
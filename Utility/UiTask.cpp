@@ -0,0 +1,201 @@
+
+// IDA utility support: Coroutine tasks that yield to the IDA UI
+#define WIN32_LEAN_AND_MEAN
+#define WINVER		 0x0A00 // _WIN32_WINNT_WIN10
+#define _WIN32_WINNT 0x0A00
+#include <windows.h>
+#include <stdlib.h>
+#include <crtdbg.h>
+
+// IDA libs
+#define USE_DANGEROUS_FUNCTIONS
+#define USE_STANDARD_FILE_FUNCTIONS
+#define NO_OBSOLETE_FUNCS
+#pragma warning(push)
+#pragma warning(disable:4244) // conversion from 'ssize_t' to 'int', possible loss of data
+#pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
+#pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
+#include <ida.hpp>
+#include <kernwin.hpp>
+#pragma warning(pop)
+
+#include <Utility.h>
+#include <UiTask.h>
+
+using namespace UiTask;
+
+// Milliseconds between ticks, the event loop runs in between
+static const int TICK_INTERVAL = 1;
+
+struct ENTRY
+{
+	ID id;
+	Task::handle_type task;			// Top level coroutine, owned
+	std::coroutine_handle<> resume;	// Where it, or a sub task it awaits, is suspended
+	BOOL canceled;
+};
+
+static std::vector<ENTRY> tasks;
+static ID nextId = 1;
+static qtimer_t timer = NULL;
+static UINT32 budget = DEFAULT_BUDGET;
+static BOOL inTick = FALSE;
+
+// Running task's slice end and yield point, in performance counter ticks
+static INT64 frequency = 0, deadline = 0;
+static std::coroutine_handle<> yielded;
+
+static INT64 counterNow()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+BOOL UiTask::timeUp()
+{
+	return (counterNow() >= deadline);
+}
+
+void UiTask::onYield(std::coroutine_handle<> handle)
+{
+	yielded = handle;
+}
+
+// Destroy the finished and canceled tasks
+static void purge()
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		ENTRY &entry = tasks[i];
+		if (entry.canceled || entry.task.done())
+		{
+			if (!entry.canceled && entry.task.promise().exception)
+				msg("UiTask: Task %u ended with an unhandled exception.\n", entry.id);
+			entry.task.destroy();
+		}
+		else
+			tasks[kept++] = entry;
+	}
+	tasks.resize(kept);
+}
+
+// Resume each task for its share of the budget, tasks started meanwhile wait for the next tick.
+// Returns FALSE when none are left.
+static BOOL runTick()
+{
+	if (!frequency)
+	{
+		LARGE_INTEGER large;
+		QueryPerformanceFrequency(&large);
+		frequency = large.QuadPart;
+	}
+
+	inTick = TRUE;
+	size_t count = tasks.size();
+	INT64 slice = ((count > 0) ? ((((INT64) budget * frequency) / 1000) / (INT64) count) : 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Copy, a task may start others and grow the vector
+		ENTRY entry = tasks[i];
+		if (entry.canceled)
+			continue;
+
+		deadline = (counterNow() + slice);
+		yielded = nullptr;
+		entry.resume.resume();
+		if (yielded)
+			tasks[i].resume = yielded;
+	}
+	inTick = FALSE;
+
+	purge();
+	return !tasks.empty();
+}
+
+static int idaapi timerCallback(void *ud)
+{
+	if (runTick())
+		return TICK_INTERVAL;
+
+	// Returning -1 unregisters the timer
+	timer = NULL;
+	return -1;
+}
+
+
+ID UiTask::start(Task task)
+{
+	ENTRY entry = { nextId++, task.release(), nullptr, FALSE };
+	_ASSERT(entry.task);
+	entry.resume = entry.task;
+	tasks.push_back(entry);
+
+	if (!timer)
+		timer = register_timer(TICK_INTERVAL, timerCallback, NULL);
+	return entry.id;
+}
+
+BOOL UiTask::isRunning(ID id)
+{
+	for (const ENTRY &entry: tasks)
+	{
+		if (entry.id == id)
+			return (!entry.canceled && !entry.task.done());
+	}
+	return FALSE;
+}
+
+BOOL UiTask::cancel(ID id)
+{
+	for (ENTRY &entry: tasks)
+	{
+		if ((entry.id == id) && !entry.canceled && !entry.task.done())
+		{
+			// A task can't be destroyed from inside a tick, purge() does it after
+			entry.canceled = TRUE;
+			if (!inTick)
+				purge();
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+size_t UiTask::count()
+{
+	size_t running = 0;
+	for (const ENTRY &entry: tasks)
+	{
+		if (!entry.canceled && !entry.task.done())
+			running++;
+	}
+	return running;
+}
+
+void UiTask::setBudget(UINT32 milliseconds)
+{
+	budget = (milliseconds ? milliseconds : 1);
+}
+
+void UiTask::runAll()
+{
+	_ASSERT(!inTick);
+	if (inTick)
+		return;
+	while (runTick()) {}
+}
+
+void UiTask::shutdown()
+{
+	_ASSERT(!inTick);
+	if (timer)
+	{
+		unregister_timer(timer);
+		timer = NULL;
+	}
+	for (ENTRY &entry: tasks)
+		entry.canceled = TRUE;
+	purge();
+}
@@ -0,0 +1,143 @@
+
+// IDA utility support: Coroutine tasks that yield to the IDA UI
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+// Cooperative tasks for long running work on the IDA UI thread, in place of hand placed WaitBox::isUpdateTime() and
+// processIdaEvents() calls. Write the work as a coroutine returning UiTask::Task, co_await UiTask::yield() in its
+// loops, and start() it. The await is one timer read and compare until the task's slice of the tick budget is used,
+// then the task suspends and the UI gets control back.
+// The scheduler resumes tasks from an IDA UI timer (register_timer()), which fires from the Qt event loop, so the
+// work never runs nested inside another event handler the way processEvents() reentrancy does.
+// Requires C++20 (/std:c++20). UI thread only.
+namespace UiTask
+{
+	typedef UINT32 ID;
+
+	// Default milliseconds of work per tick, shared by the running tasks
+	static const UINT32 DEFAULT_BUDGET = 8;
+
+	// Coroutine return type. A task can also co_await another Task to run it inline; yields inside it suspend both.
+	class Task
+	{
+	public:
+		struct promise_type
+		{
+			std::coroutine_handle<> continuation;
+			std::exception_ptr exception;
+
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			// Resume the awaiting task if any
+			struct FINAL
+			{
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+				{
+					std::coroutine_handle<> next = handle.promise().continuation;
+					return (next ? next : std::noop_coroutine());
+				}
+				void await_resume() noexcept {}
+			};
+			FINAL final_suspend() noexcept { return {}; }
+
+			void return_void() {}
+			void unhandled_exception() { exception = std::current_exception(); }
+		};
+		typedef std::coroutine_handle<promise_type> handle_type;
+
+		Task() : m_handle(nullptr) {}
+		Task(Task &&other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+		Task &operator=(Task &&other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_handle)
+					m_handle.destroy();
+				m_handle = other.m_handle;
+				other.m_handle = nullptr;
+			}
+			return *this;
+		}
+		~Task()
+		{
+			if (m_handle)
+				m_handle.destroy();
+		}
+
+		// co_await a sub task, its exception if any is rethrown in the awaiting task
+		bool await_ready() const noexcept { return (!m_handle || m_handle.done()); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			m_handle.promise().continuation = awaiting;
+			return m_handle;
+		}
+		void await_resume() const
+		{
+			if (m_handle && m_handle.promise().exception)
+				std::rethrow_exception(m_handle.promise().exception);
+		}
+
+		BOOL done() const { return (!m_handle || m_handle.done()); }
+
+		// Give up ownership of the coroutine frame
+		handle_type release()
+		{
+			handle_type handle = m_handle;
+			m_handle = nullptr;
+			return handle;
+		}
+
+	private:
+		Task(const Task &) = delete;
+		Task &operator=(const Task &) = delete;
+		explicit Task(handle_type handle) : m_handle(handle) {}
+
+		handle_type m_handle;
+	};
+
+	// TRUE once the running task's time slice is used
+	BOOL timeUp();
+	// Internal, records the suspended coroutine for the scheduler to resume
+	void onYield(std::coroutine_handle<> handle);
+
+	struct YIELD
+	{
+		BOOL always;
+
+		bool await_ready() const { return (!always && !timeUp()); }
+		void await_suspend(std::coroutine_handle<> handle) const { onYield(handle); }
+		void await_resume() const {}
+	};
+
+	// Suspend until the next tick if the time slice is used, else continue
+	inline YIELD yield() { return { FALSE }; }
+
+	// Suspend until the next tick, I.E. to let a queued UI refresh happen
+	inline YIELD nextTick() { return { TRUE }; }
+
+	// Queue a task, it first runs on the next tick. Returns its ID.
+	ID start(Task task);
+
+	// TRUE if the task hasn't finished or been canceled
+	BOOL isRunning(ID id);
+
+	// Destroy the task at its suspension point, its locals' destructors run. A task canceling itself stops at its
+	// next yield. Returns FALSE if it's not running.
+	BOOL cancel(ID id);
+
+	// Tasks running
+	size_t count();
+
+	// Milliseconds of work per tick
+	void setBudget(UINT32 milliseconds);
+
+	// Run the tasks to completion on this thread, for batch mode where the UI event loop isn't running
+	void runAll();
+
+	// Cancel every task and stop the timer, call from the plugin's term()
+	void shutdown();
+};
@@ -23,6 +23,9 @@
 #pragma warning(disable:4267) // conversion from 'size_t' to 'uint32', possible loss of data
 #pragma warning(disable:4018) // warning C4018: '<': signed/unsigned mismatch
 #include <ida.hpp>
+#include <bytes.hpp>
+#include <lines.hpp>
+#include <segment.hpp>
 #include <typeinf.hpp>
 #pragma warning(pop)
 
@@ -113,9 +116,9 @@ LPCSTR byteSizeString(UINT64 bytes)
 	    double fSize = ((double) bytes / (double) _Size); \
 	    double fIntegral; double fFractional = modf(fSize, &fIntegral); \
 	    if(fFractional > 0.05) \
-		    sprintf_s(buffer, sizeof(buffer), ("%.1f " ## _Suffix), fSize); \
+		    sprintf_s(buffer, sizeof(buffer), ("%.1f " _Suffix), fSize); \
                                                                 else \
-		    sprintf_s(buffer, sizeof(buffer), ("%.0f " ## _Suffix), fIntegral); \
+		    sprintf_s(buffer, sizeof(buffer), ("%.0f " _Suffix), fIntegral); \
             }
 
     static char buffer[32];
@@ -163,92 +166,72 @@ LPSTR GetErrorString(DWORD lastError, __out_bcount_z(1024) LPSTR buffer)
 
 
 // Dump byte range to debug output
-void DumpData(LPCVOID ptr, int size, BOOL showAscii)
+// Format DumpData() lines into 'text', the __try is here since it can't share a function with a qstring local
+static void formatDumpLines(PBYTE pSrc, int size, BOOL showAscii, __inout qstring &text)
 {
 	#define RUN 16
 
-	if(ptr && (size > 0))
+	__try
 	{
-		__try
+		static const char hexDigits[] = "0123456789ABCDEF";
+		int  uOffset = 0;
+
+		// Create offset string based on input size
+		char offsetStr[16];
+		int iDigits = (int) strlen(_itoa(size, offsetStr, 16));
+		sprintf(offsetStr, "[%%0%dX]: ", max(iDigits, 2));
+		text.reserve((size_t) (((size + (RUN - 1)) / RUN) * (iDigits + 6 + (RUN * 4) + 3)));
+
+		// Do runs, the last one may be short
+		char lineStr[256];
+		while(size > 0)
 		{
-			PBYTE pSrc = (PBYTE) ptr;
-			char lineStr[256] = {0};
-			int  uOffset = 0;
-
-			// Create offset string based on input size
-			char offsetStr[16];
-			int iDigits = (int) strlen(_itoa(size, offsetStr, 16));
-			sprintf(offsetStr, "[%%0%dX]: ", max(iDigits, 2));
-
-			// Do runs
-			char valueStr[(RUN + 1) * 3];
-			while(size >= RUN)
-			{
-				sprintf(lineStr, offsetStr, uOffset);
-
-				// Hex
-				BYTE *pLine = pSrc;
-				for(int i = 0; i < RUN; i++)
-				{
-					sprintf(valueStr, "%02X ", *pLine);
-					strcat(lineStr, valueStr);
-					++pLine;
-				}
-
-				// ASCII
-				if (showAscii)
-				{
-					strcat(lineStr, "  ");
-
-					pLine = pSrc;
-					for (int i = 0; i < RUN; i++)
-					{
-						sprintf(valueStr, "%c", (*pLine >= ' ') ? *pLine : '.');
-						strcat(lineStr, valueStr);
-						++pLine;
-					}
-				}
-
-				msg("%s\n", lineStr);
-				uOffset += RUN, pSrc += RUN, size -= RUN;
-			};
+			int count = ((size < RUN) ? size : RUN);
+			int length = sprintf(lineStr, offsetStr, uOffset);
 
-			// Final if not an even run line
-			if(size > 0)
+			// Hex
+			for(int i = 0; i < count; i++)
 			{
-				sprintf(lineStr, offsetStr, uOffset);
+				lineStr[length++] = hexDigits[pSrc[i] >> 4];
+				lineStr[length++] = hexDigits[pSrc[i] & 0xF];
+				lineStr[length++] = ' ';
+			}
 
-				// Hex
-				BYTE *pLine = pSrc;
-				for(int i = 0; i < size; i++)
+			// ASCII
+			if (showAscii)
+			{
+				// Pad out line
+				for (int i = count; i < RUN; i++)
 				{
-					sprintf(valueStr, "%02X ", *pLine);
-					strcat(lineStr, valueStr);
-					++pLine;
+					memcpy(&lineStr[length], "   ", 3);
+					length += 3;
 				}
+				lineStr[length++] = ' ';
+				lineStr[length++] = ' ';
 
-				if (showAscii)
-				{
-					// Pad out line
-					for (int i = 0; i < (RUN - size); i++) strcat(lineStr, "   ");
-					strcat(lineStr, "  ");
+				for (int i = 0; i < count; i++)
+					lineStr[length++] = ((pSrc[i] >= ' ') ? (char) pSrc[i] : '.');
+			}
 
-					// ASCII
-					pLine = pSrc;
-					for (int i = 0; i < size; i++)
-					{
-						sprintf(valueStr, "%c", (*pLine >= ' ') ? *pLine : '.');
-						strcat(lineStr, valueStr);
-						++pLine;
-					}
-				}
+			lineStr[length++] = '\n';
+			text.append(lineStr, length);
+			uOffset += count, pSrc += count, size -= count;
+		};
+	}__except(TRUE){}
 
-				msg("%s\n", lineStr);
-			}
+	#undef RUN
+}
 
-		}__except(TRUE){}
+void DumpData(LPCVOID ptr, int size, BOOL showAscii)
+{
+	if(ptr && (size > 0))
+	{
+		// One msg() for the whole dump, the output window repaints per call
+		qstring text;
+		formatDumpLines((PBYTE) ptr, size, showAscii, text);
+		if (!text.empty())
+			msg("%s", text.c_str());
 	}
-	#undef RUN
 }
 
 
@@ -300,22 +283,44 @@ void trace(const char *format, ...)
 }
 
 // Get a nice line of disassembled code text sans color tags
+void (*getDisasmTextHook)(ea_t ea, __out qstring &s) = NULL;
 void getDisasmText(ea_t ea, __out qstring &s)
 {
-    s.clear();
-	generate_disasm_line(&s, ea, (GENDSM_FORCE_CODE | GENDSM_REMOVE_TAGS));
+	if (getDisasmTextHook)
+		getDisasmTextHook(ea, s);
+	else
+		idbAccess->getDisasmLine(ea, s);
 }
 
 // Return true if passed string is only hex digits
 BOOL isHexStr(LPCSTR str)
 {
-    char c;
-    while (c = *str++)
+    // Scalar up to 16 byte alignment, then aligned 16 char blocks that can never cross into the next page
+    for (; ((UINT_PTR) str) & 15; str++)
     {
-        if (!isxdigit(c))
+        if (!*str)
+            return(TRUE);
+        if (!isxdigit((BYTE) *str))
+            return(FALSE);
+    };
+
+    const __m128i zero = _mm_setzero_si128(), caseBit = _mm_set1_epi8(0x20);
+    for (;; str += 16)
+    {
+        __m128i c = _mm_load_si128((const __m128i *) str);
+        __m128i lower = _mm_or_si128(c, caseBit);
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        UINT32 hexMask = (UINT32) _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+        if (UINT32 nulMask = (UINT32) _mm_movemask_epi8(_mm_cmpeq_epi8(c, zero)))
+        {
+            // Every char before the terminator must be hex
+            UINT32 before = ((nulMask & (0 - nulMask)) - 1);
+            return((hexMask & before) == before);
+        }
+        if (hexMask != 0xFFFF)
             return(FALSE);
     };
-    return(TRUE);
 }
 
 // Return file size for given file handle
@@ -340,6 +345,28 @@ long fsize(FILE *fp)
     return(result);
 }
 
+// Return 64bit file size for given file handle, for files over 2GB
+// Returns -1 on error
+INT64 fsize64(FILE *fp)
+{
+    INT64 psave, endpos;
+    INT64 result = -1;
+
+    if ((psave = _ftelli64(fp)) != -1LL)
+    {
+        if (_fseeki64(fp, 0, SEEK_END) == 0)
+        {
+            if ((endpos = _ftelli64(fp)) != -1LL)
+            {
+                _fseeki64(fp, psave, SEEK_SET);
+                result = endpos;
+            }
+        }
+    }
+
+    return(result);
+}
+
 // Replace or add a file extension in a path.
 LPSTR replaceExtInPath(__inout_bcount(MAX_PATH) LPSTR path, __in_z LPSTR pathNew)
 {
@@ -359,16 +386,51 @@ LPSTR ReplaceNameInPath(__inout_bcount(MAX_PATH) LPSTR path, __in_z LPSTR newNam
 }
 
 
+#ifdef _MSC_VER
+static UINT64 getXcr0() { return _xgetbv(0); }
+#else
+static UINT64 __attribute__((target("xsave"))) getXcr0() { return _xgetbv(0); }
+#endif
+
+static UINT32 cpuFeatures()
+{
+	enum { F_SSE42 = 1, F_AVX2 = 2, F_DONE = 0x80000000 };
+	static std::atomic<UINT32> features(0);
+	UINT32 f = features.load(std::memory_order_relaxed);
+	if (!f)
+	{
+		f = F_DONE;
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		if (info[2] & (1 << 20))
+			f |= F_SSE42;
+
+		// AVX2 needs the OS to save the YMM state too (OSXSAVE and XCR0 SSE/AVX bits)
+		BOOL osAvx = (((info[2] & (1 << 27)) && (info[2] & (1 << 28))) && ((getXcr0() & 6) == 6));
+		if (osAvx && (maxLeaf >= 7))
+		{
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5))
+				f |= F_AVX2;
+		}
+		features.store(f, std::memory_order_relaxed);
+	}
+	return f;
+}
+BOOL cpuHasSse42() { return ((cpuFeatures() & 1) != 0); }
+BOOL cpuHasAvx2() { return ((cpuFeatures() & 2) != 0); }
+
+
 // Pattern in style IDA binary search style "48 8D 15 ?? ?? ?? ?? 48 8D 0D" helper
 ea_t FindBinary(ea_t start_ea, ea_t end_ea, LPCSTR pattern, LPCSTR file, int lineNumber)
 {
-	compiled_binpat_vec_t searchVec;	
 	qstring errorStr;
-	if (parse_binpat_str(&searchVec, start_ea, pattern, 16, PBSENC_DEF1BPU, &errorStr))	
-		return bin_search(start_ea, end_ea, searchVec, (BIN_SEARCH_FORWARD | BIN_SEARCH_NOBREAK | BIN_SEARCH_NOSHOW));	
-	else
-		msg("** parse_binpat_str() failed! Reason: \"%s\" @ %s, line #%d **", errorStr.c_str(), __FILE__, __LINE__);
-	return BADADDR;
+	ea_t ea = idbAccess->findBinary(start_ea, end_ea, pattern, &errorStr);
+	if (!errorStr.empty())
+		msg("** FindBinary() pattern failed! Reason: \"%s\" @ %s, line #%d **\n", errorStr.c_str(), file, lineNumber);
+	return ea;
 }
 
 // Send text to the Windows clipboard for pasting
@@ -405,22 +467,87 @@ BOOL SetClipboard(LPCSTR text)
 
 // ----------------------------------------------------------------------------
 
+// Live IDB database access backend
+class IdaIdbAccess : public IdbAccess
+{
+public:
+	BOOL is64() { return inf_is_64bit(); }
+	ea_t minEa() { return inf_get_min_ea(); }
+	ea_t maxEa() { return inf_get_max_ea(); }
+
+	flags64_t getFlags(ea_t ea) { return get_flags(ea); }
+	BOOL isLoaded(ea_t ea) { return is_loaded(ea); }
+	UINT32 get32(ea_t ea) { return get_32bit(ea); }
+	UINT64 get64(ea_t ea) { return get_64bit(ea); }
+	ssize_t getBytes(PVOID buffer, size_t size, ea_t ea)
+	{
+		return get_bytes(buffer, (ssize_t) size, ea, GMB_READALL);
+	}
+	ea_t nextHead(ea_t ea, ea_t end) { return next_head(ea, end); }
+
+	void getDisasmLine(ea_t ea, __out qstring &s)
+	{
+		s.clear();
+		generate_disasm_line(&s, ea, (GENDSM_FORCE_CODE | GENDSM_REMOVE_TAGS));
+	}
+
+	int getStringType(ea_t ea)
+	{
+		opinfo_t oi;
+		if (get_opinfo(&oi, ea, 0, get_flags(ea)))
+			return(oi.strtype);
+		else
+			return(STRTYPE_C);
+	}
+
+	ea_t findBinary(ea_t start, ea_t end, LPCSTR pattern, __out_opt qstring *error)
+	{
+		compiled_binpat_vec_t searchVec;
+		qstring errorStr;
+		if (parse_binpat_str(&searchVec, start, pattern, 16, PBSENC_DEF1BPU, &errorStr))
+			return bin_search(start, end, searchVec, (BIN_SEARCH_FORWARD | BIN_SEARCH_NOBREAK | BIN_SEARCH_NOSHOW));
+		if (error)
+			*error = errorStr;
+		return BADADDR;
+	}
+
+	UINT32 segmentCount() { return (UINT32) get_segm_qty(); }
+	BOOL getSegment(UINT32 index, __out IDB_SEGMENT &segment)
+	{
+		if (segment_t *seg = getnseg((int) index))
+		{
+			segment.start = seg->start_ea;
+			segment.end = seg->end_ea;
+			segment.perm = seg->perm;
+			segment.type = seg->type;
+			segment.bitness = seg->bitness;
+			get_segm_name(&segment.name, seg);
+			return TRUE;
+		}
+		return FALSE;
+	}
+} static idaIdbAccess;
+
+IdbAccess *idbAccess = &idaIdbAccess;
+void setIdbAccess(IdbAccess *access) { idbAccess = (access ? access : &idaIdbAccess); }
+
+
 void PLAT::Configure()
 {
-	is64 = inf_is_64bit();
+	is64 = idbAccess->is64();
 	ptrSize = (is64 ? sizeof(UINT64) : sizeof(UINT32));
 
-	MaxAddress = inf_get_max_ea();
-	MinAddress = inf_get_min_ea();
+	MaxAddress = idbAccess->maxEa();
+	MinAddress = idbAccess->minEa();
 }
 
 // Get address/pointer value
 ea_t PLAT::getEa(ea_t ea)
 {
 	if (is64)
-		return (ea_t) get_64bit(ea);
+		return (ea_t) idbAccess->get64(ea);
 	else
-		return (ea_t) get_32bit(ea);
+		return (ea_t) idbAccess->get32(ea);
 }
 
 // Returns TRUE if ea_t sized value flags
@@ -655,6 +782,338 @@ void idaFlags2String(flags64_t f, __out qstring &s, BOOL withValue)
 void dumpFlags(ea_t ea, BOOL withValue)
 {
     qstring s;
-    idaFlags2String(get_flags(ea), s, withValue);
+    idaFlags2String(idbAccess->getFlags(ea), s, withValue);
     msg("%llX Flags: %s\n", ea, s.c_str());
 }
+
+
+// ----------------------------------------------------------------------------
+
+MemTrack::COUNTERS MemTrack::counters[MemTrack::MAX_TAGS];
+static char tagNames[MemTrack::MAX_TAGS][32] = { "Untagged" };
+static std::atomic<UINT32> tagsUsed(1);
+
+// Function local so it's constructed before any static allocator registers
+static CLock &tagLock()
+{
+    static CLock lock;
+    return(lock);
+}
+
+MemTrack::TAG MemTrack::registerTag(LPCSTR name)
+{
+    tagLock().lock();
+    TAG tag = UNTAGGED;
+    UINT32 used = tagsUsed.load();
+    for (UINT32 i = 1; i < used; i++)
+    {
+        // Names are stored truncated, compare only what fits
+        if (strncmp(tagNames[i], name, (sizeof(tagNames[i]) - 1)) == 0)
+        {
+            tag = i;
+            break;
+        }
+    }
+    if ((tag == UNTAGGED) && (used < MAX_TAGS))
+    {
+        strncpy_s(tagNames[used], sizeof(tagNames[used]), name, _TRUNCATE);
+        tag = used;
+        tagsUsed.store(used + 1);
+    }
+    tagLock().unlock();
+    return(tag);
+}
+
+LPCSTR MemTrack::tagName(TAG tag) { return((tag < tagsUsed.load()) ? tagNames[tag] : "?"); }
+UINT32 MemTrack::tagCount() { return(tagsUsed.load()); }
+
+void MemTrack::onLargeAlloc(TAG tag, size_t size)
+{
+    COUNTERS &c = counters[tag];
+    c.large.fetch_add(1, std::memory_order_relaxed);
+    UINT64 largest = c.largest.load(std::memory_order_relaxed);
+    while ((size > largest) && !c.largest.compare_exchange_weak(largest, size, std::memory_order_relaxed)) {};
+}
+
+void MemTrack::getStats(TAG tag, __out STATS &stats)
+{
+    COUNTERS &c = counters[tag];
+    stats.current = c.current.load(std::memory_order_relaxed);
+    stats.peak = c.peak.load(std::memory_order_relaxed);
+    stats.allocs = c.allocs.load(std::memory_order_relaxed);
+    stats.frees = c.frees.load(std::memory_order_relaxed);
+    stats.large = c.large.load(std::memory_order_relaxed);
+    stats.largest = c.largest.load(std::memory_order_relaxed);
+}
+
+void MemTrack::report(BOOL activeOnly)
+{
+    msg("Memory by subsystem:\n");
+    msg("  %-20s %10s %10s %14s %14s %6s %10s\n", "Tag", "Current", "Peak", "Allocs", "Frees", "Large", "Largest");
+
+    INT64 totalCurrent = 0, totalPeak = 0;
+    UINT32 count = tagCount();
+    for (UINT32 i = 0; i < count; i++)
+    {
+        STATS s;
+        getStats(i, s);
+        if (activeOnly && !s.peak)
+            continue;
+        totalCurrent += s.current;
+        totalPeak += s.peak;
+
+        // byteSizeString() returns a static buffer
+        char current[32], peak[32], largest[32], allocs[32], frees[32];
+        strcpy_s(current, sizeof(current), byteSizeString((UINT64) max(s.current, 0LL)));
+        strcpy_s(peak, sizeof(peak), byteSizeString((UINT64) s.peak));
+        strcpy_s(largest, sizeof(largest), (s.large ? byteSizeString(s.largest) : "-"));
+        msg("  %-20s %10s %10s %14s %14s %6u %10s\n", tagName(i), current, peak, NumberCommaString(s.allocs, allocs), NumberCommaString(s.frees, frees), (UINT32) s.large, largest);
+    }
+
+    // Sum of per tag peaks, not the process peak since tags peak at different times
+    char current[32], peak[32];
+    strcpy_s(current, sizeof(current), byteSizeString((UINT64) max(totalCurrent, 0LL)));
+    strcpy_s(peak, sizeof(peak), byteSizeString((UINT64) totalPeak));
+    msg("  %-20s %10s %10s\n", "Total", current, peak);
+}
+
+void MemTrack::resetPeaks()
+{
+    UINT32 count = tagCount();
+    for (UINT32 i = 0; i < count; i++)
+        counters[i].peak.store(counters[i].current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+
+PerfCounters::SLOTS PerfCounters::slots[PerfCounters::MAX_THREADS];
+thread_local UINT32 PerfCounters::threadSlot = 0;
+
+struct COUNTER_INFO
+{
+    char name[32];
+    PerfCounters::KIND kind;
+    PerfCounters::ID hits, misses;  // KIND_RATIO
+};
+static COUNTER_INFO counterInfo[PerfCounters::MAX_COUNTERS] = { { "Unregistered", PerfCounters::KIND_COUNTER, 0, 0 } };
+static std::atomic<UINT32> countersUsed(1);
+// Gauge set() bases, gauge levels are the base plus the slot deltas
+static std::atomic<INT64> gaugeBases[PerfCounters::MAX_COUNTERS];
+// Slot blocks of exited threads for reuse, their values stay in the sums
+static std::vector<UINT32> freeSlots;
+static UINT32 slotsUsed = 0;
+// Last two update() snapshots
+static PerfCounters::SNAPSHOT lastSnapshot = {}, priorSnapshot = {};
+
+static CLock &counterLock()
+{
+    static CLock lock;
+    return(lock);
+}
+
+// Give the slot block back when the thread exits, ParallelFor() threads come and go
+struct SLOT_RELEASE
+{
+    UINT32 slot;
+    ~SLOT_RELEASE()
+    {
+        if (slot && (slot < PerfCounters::MAX_THREADS))
+        {
+            counterLock().lock();
+            freeSlots.push_back(slot);
+            counterLock().unlock();
+        }
+    }
+};
+static thread_local SLOT_RELEASE slotRelease = { 0 };
+
+UINT32 PerfCounters::assignSlot()
+{
+    counterLock().lock();
+    UINT32 slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    if (slotsUsed < (MAX_THREADS - 1))
+        slot = ++slotsUsed;
+    else
+        slot = MAX_THREADS;
+    counterLock().unlock();
+
+    threadSlot = slot;
+    slotRelease.slot = slot;
+    return(slot);
+}
+
+static PerfCounters::ID registerName(LPCSTR name, PerfCounters::KIND kind, PerfCounters::ID hits, PerfCounters::ID misses)
+{
+    counterLock().lock();
+    PerfCounters::ID id = PerfCounters::UNREGISTERED;
+    UINT32 used = countersUsed.load();
+    for (UINT32 i = 1; i < used; i++)
+    {
+        // Names are stored truncated, compare only what fits
+        if (strncmp(counterInfo[i].name, name, (sizeof(counterInfo[i].name) - 1)) == 0)
+        {
+            id = i;
+            break;
+        }
+    }
+    if ((id == PerfCounters::UNREGISTERED) && (used < PerfCounters::MAX_COUNTERS))
+    {
+        strncpy_s(counterInfo[used].name, sizeof(counterInfo[used].name), name, _TRUNCATE);
+        counterInfo[used].kind = kind;
+        counterInfo[used].hits = hits;
+        counterInfo[used].misses = misses;
+        id = used;
+        countersUsed.store(used + 1);
+    }
+    counterLock().unlock();
+    return(id);
+}
+
+PerfCounters::ID PerfCounters::registerCounter(LPCSTR name, KIND kind) { return(registerName(name, ((kind == KIND_RATIO) ? KIND_COUNTER : kind), UNREGISTERED, UNREGISTERED)); }
+PerfCounters::ID PerfCounters::registerRatio(LPCSTR name, ID hits, ID misses) { return(registerName(name, KIND_RATIO, hits, misses)); }
+LPCSTR PerfCounters::counterName(ID id) { return((id < countersUsed.load()) ? counterInfo[id].name : "?"); }
+PerfCounters::KIND PerfCounters::counterKind(ID id) { return((id < countersUsed.load()) ? counterInfo[id].kind : KIND_COUNTER); }
+UINT32 PerfCounters::counterCount() { return(countersUsed.load()); }
+
+INT64 PerfCounters::value(ID id)
+{
+    INT64 sum = gaugeBases[id].load(std::memory_order_relaxed);
+    for (UINT32 i = 0; i < MAX_THREADS; i++)
+        sum += slots[i].values[id].load(std::memory_order_relaxed);
+    return(sum);
+}
+
+void PerfCounters::set(ID id, INT64 level)
+{
+    INT64 base = gaugeBases[id].load(std::memory_order_relaxed);
+    INT64 deltas = (value(id) - base);
+    gaugeBases[id].store((level - deltas), std::memory_order_relaxed);
+}
+
+static double ratioOf(INT64 hits, INT64 misses)
+{
+    INT64 total = (hits + misses);
+    return((total > 0) ? (((double) hits * 100.0) / (double) total) : 0.0);
+}
+
+double PerfCounters::ratio(ID id)
+{
+    if (counterKind(id) != KIND_RATIO)
+        return(0.0);
+    return(ratioOf(value(counterInfo[id].hits), value(counterInfo[id].misses)));
+}
+
+void PerfCounters::snapshot(__out SNAPSHOT &snapshot)
+{
+    snapshot.time = GetTimeStamp();
+    UINT32 count = counterCount();
+    for (UINT32 i = 0; i < MAX_COUNTERS; i++)
+        snapshot.values[i] = ((i < count) ? value(i) : 0);
+}
+
+double PerfCounters::rate(const SNAPSHOT &now, const SNAPSHOT &before, ID id)
+{
+    TIMESTAMP elapsed = (now.time - before.time);
+    return((elapsed > 0.0) ? ((double) (now.values[id] - before.values[id]) / elapsed) : 0.0);
+}
+
+BOOL PerfCounters::update(TIMESTAMP interval)
+{
+    TIMESTAMP now = GetTimeStamp();
+    if ((now - lastSnapshot.time) < interval)
+        return(FALSE);
+    priorSnapshot = lastSnapshot;
+    snapshot(lastSnapshot);
+    // The first has no prior for rates
+    if (priorSnapshot.time == 0.0)
+        priorSnapshot = lastSnapshot;
+    return(TRUE);
+}
+
+// Comma formatted value with a sign if negative
+LPSTR signedCommaString(INT64 n, __out_bcount_z(33) LPSTR buffer)
+{
+    if (n >= 0)
+        return(NumberCommaString((UINT64) n, buffer));
+    buffer[0] = '-';
+    NumberCommaString((UINT64) -n, (buffer + 1));
+    return(buffer);
+}
+
+// Value column text of counter 'id' in the last update() snapshot
+static void formatValue(PerfCounters::ID id, BOOL withRate, __out_bcount_z(80) LPSTR buffer)
+{
+    const COUNTER_INFO &info = counterInfo[id];
+    char number[33], rateStr[33];
+    switch (info.kind)
+    {
+        case PerfCounters::KIND_COUNTER:
+        {
+            signedCommaString(lastSnapshot.values[id], number);
+            if (withRate)
+            {
+                double rate = PerfCounters::rate(lastSnapshot, priorSnapshot, id);
+                signedCommaString((INT64) rate, rateStr);
+                sprintf_s(buffer, 80, "%s (%s/s)", number, rateStr);
+            }
+            else
+                strcpy_s(buffer, 80, number);
+        }
+        break;
+
+        case PerfCounters::KIND_GAUGE:
+        strcpy_s(buffer, 80, signedCommaString(lastSnapshot.values[id], number));
+        break;
+
+        case PerfCounters::KIND_RATIO:
+        sprintf_s(buffer, 80, "%.1f%%", ratioOf(lastSnapshot.values[info.hits], lastSnapshot.values[info.misses]));
+        break;
+    };
+}
+
+void PerfCounters::formatLine(__out qstring &text)
+{
+    text.clear();
+    char value[80];
+    UINT32 count = counterCount();
+    for (UINT32 i = 1; i < count; i++)
+    {
+        formatValue(i, TRUE, value);
+        text.cat_sprnt("%s%s: %s", (text.empty() ? "" : ", "), counterInfo[i].name, value);
+    }
+}
+
+void PerfCounters::report()
+{
+    msg("Performance counters:\n");
+    msg("  %-24s %20s %16s\n", "Counter", "Value", "Rate/s");
+
+    char value[80], rateStr[33];
+    UINT32 count = counterCount();
+    for (UINT32 i = 1; i < count; i++)
+    {
+        formatValue(i, FALSE, value);
+        if (counterInfo[i].kind == KIND_COUNTER)
+            msg("  %-24s %20s %16s\n", counterInfo[i].name, value, signedCommaString((INT64) rate(lastSnapshot, priorSnapshot, i), rateStr));
+        else
+            msg("  %-24s %20s\n", counterInfo[i].name, value);
+    }
+}
+
+void PerfCounters::reset()
+{
+    for (UINT32 t = 0; t < MAX_THREADS; t++)
+    {
+        for (UINT32 i = 0; i < MAX_COUNTERS; i++)
+            slots[t].values[i].store(0, std::memory_order_relaxed);
+    }
+    for (UINT32 i = 0; i < MAX_COUNTERS; i++)
+        gaugeBases[i].store(0, std::memory_order_relaxed);
+    memset(&lastSnapshot, 0, sizeof(lastSnapshot));
+    memset(&priorSnapshot, 0, sizeof(priorSnapshot));
+}
@@ -2,6 +2,14 @@
 // IDA utility support
 #pragma once
 
+#include <intrin.h>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 typedef double TIMESTAMP;
 #define SECOND 1
 #define MINUTE (60 * SECOND)
@@ -20,6 +28,7 @@ TIMESTAMP GetTimeStamp();
 TIMESTAMP GetTimeStampMS();
 LPCSTR  TimeString(TIMESTAMP Time);
 LPSTR   NumberCommaString(UINT64 n, __bcount(32) LPSTR buffer);
+LPSTR   signedCommaString(INT64 n, __bcount(33) LPSTR buffer);
 LPCSTR  bitsStr(LPSTR buffer, int buffLen, ULONG64 value, int bits);
 LPCSTR byteSizeString(UINT64 uSize);
 UINT32 getChracterLength(int strtype, UINT32 byteCount);
@@ -31,10 +40,14 @@ LPSTR GetErrorString(DWORD lastError, __out_bcount_z(1024) LPSTR buffer);
 void DumpData(LPCVOID ptr, int size, BOOL showAscii = TRUE);
 BOOL isHexStr(LPCSTR str);
 long fsize(FILE *fp);
+INT64 fsize64(FILE *fp);
 LPSTR ReplaceNameInPath(__inout_bcount(MAX_PATH) LPSTR path, __in_z LPSTR newName);
 LPSTR replaceExtInPath(__inout_bcount(MAX_PATH) LPSTR path, __in_z LPSTR pathNew);
 LPSTR GetEaFormatString(ea_t largestAddress, __out_bcount_z(17) LPSTR formatBuffer, BOOL leadingZero = TRUE);
 
+// Optional getDisasmText() line source, set while the DisasmCache module is started
+extern void (*getDisasmTextHook)(ea_t ea, __out qstring &s);
+
 // Semantic versioning for storage 32bit UINT32, using 10 bits (for 0 to 1023) for major, minor, and patch numbers
 // Then 2 bits to (for up to 4 states) to indicate alpha, beta, etc.
 enum VERSION_STAGE
@@ -56,20 +69,58 @@ ea_t FindBinary(ea_t start_ea, ea_t end_ea, LPCSTR pattern, LPCSTR file, int lin
 #define FIND_BINARY(_start, _end, _pattern) FindBinary((_start), (_end), (_pattern), __FILE__, __LINE__)
 //#define FIND_BINARY(_start, _end, _pattern) find_binary((_start), (_end), (_pattern), 16, (SEARCH_DOWN | SEARCH_NOBRK | SEARCH_NOSHOW));
 
+// Database access used by the Utility helpers (PLAT, FindBinary, getDisasmText, isString, etc.)
+// Defaults to the live IDB. A stand-in backend, like IdbSnapshot, can be swapped in so the helpers and scanners run
+// headless outside of IDA. Per address calls are virtual, use getBytes() for bulk reads in hot loops.
+struct IDB_SEGMENT
+{
+    ea_t start, end;
+    UINT32 perm;     // SEGPERM_*
+    UINT32 type;     // SEG_*
+    UINT32 bitness;  // 0 = 16, 1 = 32, 2 = 64
+    qstring name;
+};
+
+class IdbAccess
+{
+public:
+    virtual ~IdbAccess() {}
+
+    virtual BOOL is64() = 0;
+    virtual ea_t minEa() = 0;
+    virtual ea_t maxEa() = 0;
+
+    virtual flags64_t getFlags(ea_t ea) = 0;
+    virtual BOOL isLoaded(ea_t ea) = 0;
+    virtual UINT32 get32(ea_t ea) = 0;
+    virtual UINT64 get64(ea_t ea) = 0;
+    // Read up to 'size' bytes, returns bytes read or -1 on error. Unloaded bytes have no defined value, check isLoaded().
+    virtual ssize_t getBytes(PVOID buffer, size_t size, ea_t ea) = 0;
+    // Next item head after 'ea' and below 'end', BADADDR if none. Walk items with this, not getFlags() per byte.
+    virtual ea_t nextHead(ea_t ea, ea_t end) = 0;
+
+    // Disassembly line sans color tags
+    virtual void getDisasmLine(ea_t ea, __out qstring &s) = 0;
+    // String literal type at address, STRTYPE_C if none
+    virtual int getStringType(ea_t ea) = 0;
+    // IDA style "48 8D 15 ?? ?? ?? ??" pattern search, returns BADADDR if not found
+    virtual ea_t findBinary(ea_t start, ea_t end, LPCSTR pattern, __out_opt qstring *error = NULL) = 0;
+
+    virtual UINT32 segmentCount() = 0;
+    virtual BOOL getSegment(UINT32 index, __out IDB_SEGMENT &segment) = 0;
+};
+
+// Current backend, and swap in another one, NULL restores the live IDB backend
+extern IdbAccess *idbAccess;
+void setIdbAccess(IdbAccess *access);
+
 // Return TRUE if at address is a string (ASCII, Unicode, etc.)
-inline BOOL isString(ea_t ea){ return is_strlit(get_flags(ea)); }
+inline BOOL isString(ea_t ea){ return is_strlit(idbAccess->getFlags(ea)); }
 
 // Get string type by address
 // Should process the result with "get_str_type_code()" to filter any
 // potential string encoding from the base type.
-inline int getStringType(ea_t ea)
-{
-    opinfo_t oi;
-    if (get_opinfo(&oi, ea, 0, get_flags(ea)))
-        return(oi.strtype);
-    else
-        return(STRTYPE_C);
-}
+inline int getStringType(ea_t ea) { return(idbAccess->getStringType(ea)); }
 
 // Size of string sans terminator
 #define SIZESTR(_x) (((sizeof(_x) / sizeof(_x[0])) - 1) - 1)
@@ -77,6 +128,20 @@ inline int getStringType(ea_t ea)
 // Set object (data or function) alignment
 #define ALIGN(_x_) __declspec(align(_x_))
 
+// Runtime CPU feature checks for SIMD code path dispatch, cached after the first call
+BOOL cpuHasSse42();
+BOOL cpuHasAvx2();
+
+// Mark a function as using a newer instruction set than the build targets, so a SIMD path can sit next to its
+// fallback and be picked at runtime with the checks above. MSVC emits any intrinsic as is, GCC/Clang need the attribute.
+#ifdef _MSC_VER
+#define TARGET_SSE42
+#define TARGET_AVX2
+#else
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 #undef CATCH
 #define CATCH() \
 	catch(std::exception &ex) \
@@ -123,8 +188,8 @@ struct PLAT
 
     BOOL isEa(flags64_t f);
 	ea_t getEa(ea_t ea);
-    inline EA_32 getEa32(ea_t ea){ return get_32bit(ea); }
-    inline ea_t getEa64(ea_t ea){ return get_64bit(ea); }
+    inline EA_32 getEa32(ea_t ea){ return idbAccess->get32(ea); }
+    inline ea_t getEa64(ea_t ea){ return idbAccess->get64(ea); }
     // Return TRUE if address is outside of IDB
     inline BOOL isBadAddress(ea_t addr) { return (addr < MinAddress || addr > MaxAddress); }
   
@@ -135,7 +200,7 @@ struct PLAT
 };
 extern PLAT plat;
 
-#define IS_VALID_ADDR(_addr) (!plat.isBadAddress(_addr) && is_loaded(_addr))
+#define IS_VALID_ADDR(_addr) (!plat.isBadAddress(_addr) && idbAccess->isLoaded(_addr))
 
 // ----------------------------------------------------------------------------
 
@@ -155,12 +220,227 @@ private:
 };
 
 
+// Call f(index) for every index in [0, count) across worker threads, the caller being one of them.
+// Indexes are handed out one at a time so uneven work balances; 'threads' 0 for all hardware threads.
+// Runs inline for a single thread or item. Worker threads must not call the IDA API, and f must not throw.
+template <class F> void ParallelFor(size_t count, F &&f, UINT32 threads = 0)
+{
+    if (!threads)
+        threads = std::thread::hardware_concurrency();
+    if ((size_t) threads > count)
+        threads = (UINT32) count;
+    if (threads <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            f(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+            f(i);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (UINT32 i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t: pool)
+        t.join();
+}
+
+
+// Memory accounting by subsystem tag.
+// Allocators report against a tag from registerTag(), I.E. "DisasmCache", "StringPool", so a report shows current and
+// peak bytes per subsystem. Counters are relaxed atomics, cheap enough to leave on, safe from any thread.
+namespace MemTrack
+{
+    typedef UINT32 TAG;
+    static const TAG UNTAGGED = 0;
+    static const UINT32 MAX_TAGS = 64;
+    // Allocations of this size or larger are also counted as large allocation events
+    static const size_t LARGE_ALLOC = (64 * 1024 * 1024);
+
+    struct ALIGN(64) COUNTERS
+    {
+        std::atomic<INT64> current, peak;
+        std::atomic<UINT64> allocs, frees, large, largest;
+    };
+    extern COUNTERS counters[MAX_TAGS];
+
+    // Get tag for subsystem name, the same name returns the same tag.
+    // Returns UNTAGGED if the tag table is full.
+    TAG registerTag(LPCSTR name);
+    LPCSTR tagName(TAG tag);
+
+    void onLargeAlloc(TAG tag, size_t size);
+    inline void onAlloc(TAG tag, size_t size)
+    {
+        COUNTERS &c = counters[tag];
+        INT64 now = (c.current.fetch_add((INT64) size, std::memory_order_relaxed) + (INT64) size);
+        INT64 peak = c.peak.load(std::memory_order_relaxed);
+        while ((now > peak) && !c.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {};
+        c.allocs.fetch_add(1, std::memory_order_relaxed);
+        if (size >= LARGE_ALLOC)
+            onLargeAlloc(tag, size);
+    }
+    inline void onFree(TAG tag, size_t size)
+    {
+        counters[tag].current.fetch_sub((INT64) size, std::memory_order_relaxed);
+        counters[tag].frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    // A resize in place or by move, I.E. a growing buffer, adjusts the bytes but isn't an alloc or free event
+    inline void onRealloc(TAG tag, size_t oldSize, size_t newSize)
+    {
+        if (!oldSize)
+        {
+            if (newSize)
+                onAlloc(tag, newSize);
+        }
+        else
+        if (!newSize)
+            onFree(tag, oldSize);
+        else
+        {
+            COUNTERS &c = counters[tag];
+            INT64 delta = ((INT64) newSize - (INT64) oldSize);
+            INT64 now = (c.current.fetch_add(delta, std::memory_order_relaxed) + delta);
+            INT64 peak = c.peak.load(std::memory_order_relaxed);
+            while ((now > peak) && !c.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {};
+            if ((newSize >= LARGE_ALLOC) && (oldSize < LARGE_ALLOC))
+                onLargeAlloc(tag, newSize);
+        }
+    }
+
+    struct STATS
+    {
+        INT64 current, peak;
+        UINT64 allocs, frees, large, largest;
+    };
+    void getStats(TAG tag, __out STATS &stats);
+    UINT32 tagCount();
+
+    // Print per tag table, optionally only tags with a non zero peak
+    void report(BOOL activeOnly = TRUE);
+    // Restart peaks from current values, I.E. at the start of a new analysis pass
+    void resetPeaks();
+};
+
+// STL allocator adapter that accounts against a MemTrack tag.
+// I.E.: std::vector<ea_t, TrackedAllocator<ea_t>> v(TrackedAllocator<ea_t>(MemTrack::registerTag("Xrefs")));
+template <class T> class TrackedAllocator
+{
+public:
+    typedef T value_type;
+
+    TrackedAllocator(MemTrack::TAG tag = MemTrack::UNTAGGED) : m_tag(tag) {}
+    template <class U> TrackedAllocator(const TrackedAllocator<U> &other) : m_tag(other.tag()) {}
+
+    T *allocate(size_t n)
+    {
+        T *p = (T *) ::operator new(n * sizeof(T));
+        MemTrack::onAlloc(m_tag, (n * sizeof(T)));
+        return p;
+    }
+    void deallocate(T *p, size_t n)
+    {
+        MemTrack::onFree(m_tag, (n * sizeof(T)));
+        ::operator delete(p);
+    }
+
+    MemTrack::TAG tag() const { return(m_tag); }
+    template <class U> bool operator==(const TrackedAllocator<U> &other) const { return(m_tag == other.tag()); }
+    template <class U> bool operator!=(const TrackedAllocator<U> &other) const { return(m_tag != other.tag()); }
+
+private:
+    MemTrack::TAG m_tag;
+};
+
+
+// Named 64bit performance counters and gauges, I.E. items processed, cache hits and misses, queue depth.
+// Each thread adds into its own cache line padded block of slots, so counting is a plain load and store with no
+// shared cache lines; reading a value sums the blocks. Threads past MAX_THREADS share the last block with atomic
+// adds. update() takes a periodic snapshot for per second rates, formatLine() fits a wait box label.
+namespace PerfCounters
+{
+    typedef UINT32 ID;
+    static const ID UNREGISTERED = 0;
+    static const UINT32 MAX_COUNTERS = 64;
+    static const UINT32 MAX_THREADS = 64;
+
+    enum KIND
+    {
+        KIND_COUNTER,   // Running total, reported with a per second rate
+        KIND_GAUGE,     // Current level, I.E. a queue depth, set() or add()/sub() deltas
+        KIND_RATIO      // Percentage of two counters, hits / (hits + misses)
+    };
+
+    struct ALIGN(64) SLOTS
+    {
+        std::atomic<INT64> values[MAX_COUNTERS];
+    };
+    extern SLOTS slots[MAX_THREADS];
+    // This thread's slots index + 1, 0 until its first add
+    extern thread_local UINT32 threadSlot;
+    UINT32 assignSlot();
+
+    // Get the ID for a name, the same name returns the same ID.
+    // Returns UNREGISTERED, which counts nothing, if the table is full.
+    ID registerCounter(LPCSTR name, KIND kind = KIND_COUNTER);
+    ID registerRatio(LPCSTR name, ID hits, ID misses);
+    LPCSTR counterName(ID id);
+    KIND counterKind(ID id);
+    UINT32 counterCount();
+
+    inline void add(ID id, INT64 n = 1)
+    {
+        UINT32 slot = threadSlot;
+        if (!slot)
+            slot = assignSlot();
+        std::atomic<INT64> &value = slots[slot - 1].values[id];
+        if (slot < MAX_THREADS)
+            value.store((value.load(std::memory_order_relaxed) + n), std::memory_order_relaxed);
+        else
+            value.fetch_add(n, std::memory_order_relaxed);
+    }
+    inline void sub(ID id, INT64 n = 1) { add(id, -n); }
+
+    // Set a gauge, from one thread at a time
+    void set(ID id, INT64 value);
+
+    // Current total or level
+    INT64 value(ID id);
+    // A ratio's percentage, 0 without hits or misses
+    double ratio(ID id);
+
+    struct SNAPSHOT
+    {
+        TIMESTAMP time;
+        INT64 values[MAX_COUNTERS];
+    };
+    void snapshot(__out SNAPSHOT &snapshot);
+    // Per second change of a counter between two snapshots
+    double rate(const SNAPSHOT &now, const SNAPSHOT &before, ID id);
+
+    // Take a new snapshot if 'interval' seconds passed since the last, returns TRUE if it did
+    BOOL update(TIMESTAMP interval = 1.0);
+    // One line summary of the last update(), I.E. for WaitBox::setLabelText()
+    void formatLine(__out qstring &text);
+    // Print per counter table of the last update()
+    void report();
+    // Zero the counters and gauges, I.E. at the start of a new analysis pass. No adds should be running.
+    void reset();
+};
+
+
 // Simple cache aligned expanding buffer
 // For the performance benefit of skipping of alloc/free calls plus base cache alignment
 template <class T, const size_t t_reserveElementCount = 0, const size_t t_elementExpandSize = 1024> class SlideBuffer
 {
 public:
-    SlideBuffer() : m_dataPtr(NULL), m_elementCount(0)
+    SlideBuffer() : m_dataPtr(NULL), m_elementCount(0), m_tag(MemTrack::UNTAGGED)
     {
         // Initial reserved buffer size if any
         if (t_reserveElementCount)
@@ -178,6 +458,7 @@ public:
             //msg("GrowBuffer: %08X expand from %u to %u element count.\n", m_dataPtr, m_elementCount, wantedElementCount);
             if (T *dataPtr = (T *) _aligned_realloc(m_dataPtr, (sizeof(T) * wantedElementCount), 16))
             {
+                MemTrack::onRealloc(m_tag, (sizeof(T) * m_elementCount), (sizeof(T) * wantedElementCount));
                 m_dataPtr = dataPtr;
                 m_elementCount = wantedElementCount;
             }
@@ -192,7 +473,10 @@ public:
     void clear()
     {
         if (m_dataPtr)
+        {
             _aligned_free(m_dataPtr);
+            MemTrack::onFree(m_tag, (sizeof(T) * m_elementCount));
+        }
         m_dataPtr = NULL;
         m_elementCount = 0;
     }
@@ -200,10 +484,440 @@ public:
     // Return element size of current buffer
     size_t size(){ return(m_elementCount); }
 
+    // Account buffer memory to a MemTrack tag, set before first use
+    void setTag(MemTrack::TAG tag) { _ASSERT(!m_dataPtr); m_tag = tag; }
+
 private:
     DISALLOW_COPY_AND_ASSIGN(SlideBuffer);
 
     T *m_dataPtr;
     size_t m_elementCount;
+    MemTrack::TAG m_tag;
 };
 
+
+// Simple bump allocator over large blocks for many small objects freed all at once.
+// Individual allocations are not freed, only the whole arena on clear(). Not thread safe.
+class Arena
+{
+public:
+    Arena(size_t blockSize = (1024 * 1024), MemTrack::TAG tag = MemTrack::UNTAGGED) : m_head(NULL), m_ptr(NULL), m_end(NULL), m_blockSize(blockSize), m_reserved(0), m_used(0), m_tag(tag) {}
+    ~Arena() { clear(); }
+
+    // Allocate 'size' bytes with power of 2 alignment, or NULL on allocation failure
+    PVOID alloc(size_t size, size_t alignment = 8)
+    {
+        BYTE *ptr = (BYTE *) (((UINT_PTR) m_ptr + (alignment - 1)) & ~(UINT_PTR) (alignment - 1));
+        if (!m_ptr || ((ptr + size) > m_end))
+        {
+            // Oversized requests get their own block so the current one keeps filling
+            if (size > (m_blockSize / 4))
+            {
+                BLOCK *block = newBlock(size + alignment);
+                if (!block)
+                    return NULL;
+                if (m_head)
+                {
+                    block->next = m_head->next;
+                    m_head->next = block;
+                }
+                else
+                    m_head = block;
+                m_used += size;
+                return (PVOID) (((UINT_PTR) (block + 1) + (alignment - 1)) & ~(UINT_PTR) (alignment - 1));
+            }
+
+            BLOCK *block = newBlock(m_blockSize);
+            if (!block)
+                return NULL;
+            block->next = m_head;
+            m_head = block;
+            m_ptr = (BYTE *) (block + 1);
+            m_end = (m_ptr + m_blockSize);
+            ptr = (BYTE *) (((UINT_PTR) m_ptr + (alignment - 1)) & ~(UINT_PTR) (alignment - 1));
+        }
+        m_ptr = (ptr + size);
+        m_used += size;
+        return ptr;
+    }
+
+    // Copy of string of 'length' characters plus terminator
+    LPSTR copyString(LPCSTR str, size_t length)
+    {
+        LPSTR copy = (LPSTR) alloc((length + 1), 1);
+        if (copy)
+        {
+            memcpy(copy, str, length);
+            copy[length] = 0;
+        }
+        return copy;
+    }
+
+    // Free all blocks
+    void clear()
+    {
+        while (m_head)
+        {
+            BLOCK *next = m_head->next;
+            MemTrack::onFree(m_tag, (sizeof(BLOCK) + m_head->size));
+            _aligned_free(m_head);
+            m_head = next;
+        }
+        m_ptr = m_end = NULL;
+        m_reserved = m_used = 0;
+    }
+
+    // Bytes allocated from the system, and bytes handed out
+    size_t reserved() { return(m_reserved); }
+    size_t used() { return(m_used); }
+
+    // Account block memory to a MemTrack tag, set before first use
+    void setTag(MemTrack::TAG tag) { _ASSERT(!m_head); m_tag = tag; }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Arena);
+
+    struct BLOCK
+    {
+        BLOCK *next;
+        size_t size;
+    };
+
+    BLOCK *newBlock(size_t size)
+    {
+        BLOCK *block = (BLOCK *) _aligned_malloc((sizeof(BLOCK) + size), 64);
+        if (block)
+        {
+            block->next = NULL;
+            block->size = size;
+            m_reserved += (sizeof(BLOCK) + size);
+            MemTrack::onAlloc(m_tag, (sizeof(BLOCK) + size));
+        }
+        return block;
+    }
+
+    BLOCK *m_head;
+    BYTE *m_ptr, *m_end;
+    size_t m_blockSize, m_reserved, m_used;
+    MemTrack::TAG m_tag;
+};
+
+
+// ----------------------------------------------------------------------------
+
+// Cheap address key mixer. Addresses are clustered and aligned so their low bits alone make poor bucket indexes.
+// The multiply spreads every key bit up into the high bits and the fold brings them back down.
+inline UINT64 eaHash(ea_t ea)
+{
+	UINT64 h = (ea * 0x9E3779B97F4A7C15ull);
+	return (h ^ (h >> 32));
+}
+
+// Flat open addressing hash map keyed on ea_t
+// Linear probing over separate key, value and one byte control arrays; no per entry allocations.
+// Lookups compare 16 control bytes (7 bit hash tags) at a time with SSE2, Swiss table style.
+// Erase backward shifts the rest of the probe run instead of leaving tombstones, so probe lengths don't degrade
+// with churn. Max load factor is 7/8. Storage is accounted against the MemTrack 'tag'. Not thread safe.
+template <class T> class EaHashMap
+{
+public:
+    EaHashMap(size_t expectedCount = 0, MemTrack::TAG tag = MemTrack::UNTAGGED) : m_ctrl(NULL), m_keys(NULL), m_values(NULL), m_mask(0), m_size(0), m_growAt(0), m_tag(tag)
+    {
+        reserve(expectedCount ? expectedCount : 1);
+    }
+    ~EaHashMap() { release(); }
+
+    // Size for an expected element count so inserts up to it don't rehash
+    void reserve(size_t expectedCount)
+    {
+        size_t wanted = (((expectedCount * 8) / 7) + 1), capacity = MIN_CAPACITY;
+        while (capacity < wanted)
+            capacity <<= 1;
+        if (capacity > (m_mask + 1) || !m_ctrl)
+            rehash(capacity);
+    }
+
+    // Return pointer to value for key, or NULL if not found
+    T *find(ea_t key)
+    {
+        size_t i = findSlot(key);
+        return ((i != NOT_FOUND) ? &valueAt(i) : NULL);
+    }
+
+    BOOL contains(ea_t key) { return (findSlot(key) != NOT_FOUND); }
+
+    // Get value for key, inserting a default constructed one if not present
+    T &operator[](ea_t key)
+    {
+        size_t i = findSlot(key);
+        if (i == NOT_FOUND)
+            i = insertSlot(key, T());
+        return valueAt(i);
+    }
+
+    // Insert or overwrite, returns TRUE if the key was new
+    BOOL insert(ea_t key, const T &value)
+    {
+        size_t i = findSlot(key);
+        if (i != NOT_FOUND)
+        {
+            valueAt(i) = value;
+            return FALSE;
+        }
+        insertSlot(key, value);
+        return TRUE;
+    }
+
+    // Remove key, returns TRUE if it was present
+    BOOL erase(ea_t key)
+    {
+        size_t i = findSlot(key);
+        if (i == NOT_FOUND)
+            return FALSE;
+
+        destroyValue(i);
+        size_t j = i;
+        for (;;)
+        {
+            j = ((j + 1) & m_mask);
+            if (m_ctrl[j] == CTRL_EMPTY)
+                break;
+
+            // Entry at 'j' stays put if its home slot is cyclically within (i, j]
+            size_t home = (eaHash(m_keys[j]) & m_mask);
+            if ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)))
+                continue;
+
+            setCtrl(i, m_ctrl[j]);
+            m_keys[i] = m_keys[j];
+            moveValue(i, j);
+            i = j;
+        }
+        setCtrl(i, CTRL_EMPTY);
+        m_size--;
+        return TRUE;
+    }
+
+    // Remove all elements, keeping the capacity
+    void clear()
+    {
+        if (m_ctrl)
+        {
+            forEachSlot([this](size_t i) { destroyValue(i); });
+            memset(m_ctrl, CTRL_EMPTY, (m_mask + 1 + GROUP_SIZE));
+        }
+        m_size = 0;
+    }
+
+    // Call f(ea_t key, T &value) for every element, in no particular order
+    template <class F> void forEach(F f) { forEachSlot([&](size_t i) { f(m_keys[i], valueAt(i)); }); }
+
+    size_t size() { return(m_size); }
+    size_t capacity() { return(m_mask + 1); }
+    size_t memoryUsage() { return(storageSize(m_mask + 1)); }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(EaHashMap);
+
+    static const size_t GROUP_SIZE = 16, MIN_CAPACITY = 16, NOT_FOUND = ((size_t) -1);
+    static const BYTE CTRL_EMPTY = 0x80;
+    static const BOOL HAS_VALUE = !std::is_empty<T>::value;
+
+    // Control byte for hash, the top 7 bits which are independent of the low bits used for the slot index
+    static inline BYTE hashTag(UINT64 h) { return (BYTE) (h >> 57); }
+    // Bytes of the control, key and value arrays for a capacity
+    static inline size_t storageSize(size_t capacity) { return((capacity * (sizeof(ea_t) + (HAS_VALUE ? sizeof(T) : 0) + 1)) + GROUP_SIZE); }
+
+    inline T &valueAt(size_t i)
+    {
+        if constexpr (HAS_VALUE)
+            return m_values[i];
+        else
+        {
+            static T none;
+            return none;
+        }
+    }
+    inline void destroyValue(size_t i)
+    {
+        if constexpr (HAS_VALUE && !std::is_trivially_destructible<T>::value)
+            m_values[i].~T();
+    }
+    inline void moveValue(size_t to, size_t from)
+    {
+        if constexpr (HAS_VALUE)
+        {
+            new(&m_values[to]) T(std::move(m_values[from]));
+            destroyValue(from);
+        }
+    }
+
+    // Set a control byte. The first group is mirrored past the end so group loads never wrap.
+    inline void setCtrl(size_t i, BYTE value)
+    {
+        m_ctrl[i] = value;
+        if (i < GROUP_SIZE)
+            m_ctrl[m_mask + 1 + i] = value;
+    }
+
+    size_t findSlot(ea_t key)
+    {
+        UINT64 h = eaHash(key);
+        __m128i tag = _mm_set1_epi8((char) hashTag(h));
+        size_t pos = (h & m_mask);
+        for (;;)
+        {
+            __m128i group = _mm_loadu_si128((const __m128i *) &m_ctrl[pos]);
+            UINT32 match = (UINT32) _mm_movemask_epi8(_mm_cmpeq_epi8(group, tag));
+            UINT32 empty = (UINT32) _mm_movemask_epi8(group);
+
+            // Linear probing, so the key can only be before the first empty slot
+            if (empty)
+                match &= ((empty & (0 - empty)) - 1);
+            while (match)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, match);
+                size_t i = ((pos + bit) & m_mask);
+                if (m_keys[i] == key)
+                    return i;
+                match &= (match - 1);
+            }
+            if (empty)
+                return NOT_FOUND;
+            pos = ((pos + GROUP_SIZE) & m_mask);
+        }
+    }
+
+    // Place a key known not to be in the table
+    template <class V> size_t insertSlot(ea_t key, V &&value)
+    {
+        if (m_size >= m_growAt)
+        {
+            // 'value' may be an element of this map, copy it before the rehash frees it
+            T copy(std::forward<V>(value));
+            rehash((m_mask + 1) * 2);
+            return insertSlot(key, std::move(copy));
+        }
+
+        UINT64 h = eaHash(key);
+        size_t pos = (h & m_mask);
+        for (;;)
+        {
+            UINT32 empty = (UINT32) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) &m_ctrl[pos]));
+            if (empty)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, empty);
+                size_t i = ((pos + bit) & m_mask);
+                setCtrl(i, hashTag(h));
+                m_keys[i] = key;
+                if constexpr (HAS_VALUE)
+                    new(&m_values[i]) T(std::forward<V>(value));
+                m_size++;
+                return i;
+            }
+            pos = ((pos + GROUP_SIZE) & m_mask);
+        }
+    }
+
+    template <class F> void forEachSlot(F f)
+    {
+        size_t capacity = (m_mask + 1);
+        for (size_t pos = 0; pos < capacity; pos += GROUP_SIZE)
+        {
+            UINT32 full = (~(UINT32) _mm_movemask_epi8(_mm_load_si128((const __m128i *) &m_ctrl[pos])) & 0xFFFF);
+            while (full)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, full);
+                f(pos + bit);
+                full &= (full - 1);
+            }
+        }
+    }
+
+    void rehash(size_t capacity)
+    {
+        // Allocate everything before touching the map, so a failure leaves it as it was
+        BYTE *ctrl = (BYTE *) _aligned_malloc((capacity + GROUP_SIZE), 16);
+        ea_t *keys = (ea_t *) _aligned_malloc((capacity * sizeof(ea_t)), 16);
+        T *values = (HAS_VALUE ? (T *) _aligned_malloc((capacity * sizeof(T)), 16) : NULL);
+        if (!ctrl || !keys || (HAS_VALUE && !values))
+        {
+            _aligned_free(ctrl);
+            _aligned_free(keys);
+            _aligned_free(values);
+            throw std::bad_alloc();
+        }
+
+        BYTE *oldCtrl = m_ctrl;
+        ea_t *oldKeys = m_keys;
+        T *oldValues = m_values;
+        size_t oldCapacity = (oldCtrl ? (m_mask + 1) : 0);
+        m_ctrl = ctrl, m_keys = keys, m_values = values;
+        memset(m_ctrl, CTRL_EMPTY, (capacity + GROUP_SIZE));
+        m_mask = (capacity - 1);
+        m_growAt = ((capacity / 8) * 7);
+        m_size = 0;
+        MemTrack::onRealloc(m_tag, (oldCapacity ? storageSize(oldCapacity) : 0), storageSize(capacity));
+
+        for (size_t i = 0; i < oldCapacity; i++)
+        {
+            if (oldCtrl[i] != CTRL_EMPTY)
+            {
+                if constexpr (HAS_VALUE)
+                {
+                    insertSlot(oldKeys[i], std::move(oldValues[i]));
+                    if constexpr (!std::is_trivially_destructible<T>::value)
+                        oldValues[i].~T();
+                }
+                else
+                    insertSlot(oldKeys[i], T());
+            }
+        }
+
+        if (oldCtrl)
+        {
+            _aligned_free(oldCtrl);
+            _aligned_free(oldKeys);
+            if (oldValues)
+                _aligned_free(oldValues);
+        }
+    }
+
+    void release()
+    {
+        if (m_ctrl)
+        {
+            clear();
+            MemTrack::onFree(m_tag, storageSize(m_mask + 1));
+            _aligned_free(m_ctrl);
+            _aligned_free(m_keys);
+            if (m_values)
+                _aligned_free(m_values);
+        }
+        m_ctrl = NULL, m_keys = NULL, m_values = NULL;
+        m_mask = m_size = m_growAt = 0;
+    }
+
+    BYTE *m_ctrl;
+    ea_t *m_keys;
+    T *m_values;
+    size_t m_mask, m_size, m_growAt;
+    MemTrack::TAG m_tag;
+};
+
+// Flat open addressing hash set keyed on ea_t, see EaHashMap
+struct EA_HASH_NO_VALUE {};
+class EaHashSet : public EaHashMap<EA_HASH_NO_VALUE>
+{
+public:
+    EaHashSet(size_t expectedCount = 0, MemTrack::TAG tag = MemTrack::UNTAGGED) : EaHashMap<EA_HASH_NO_VALUE>(expectedCount, tag) {}
+
+    // Returns TRUE if the key was new
+    BOOL insert(ea_t key) { return EaHashMap<EA_HASH_NO_VALUE>::insert(key, EA_HASH_NO_VALUE()); }
+
+    // Call f(ea_t key) for every element, in no particular order
+    template <class F> void forEach(F f) { EaHashMap<EA_HASH_NO_VALUE>::forEach([&](ea_t key, EA_HASH_NO_VALUE &) { f(key); }); }
+};
@@ -0,0 +1,611 @@
+
+// Utility primitives micro benchmark
+// Builds on Linux against the thin Win32/IDA SDK stand-ins in ./stub, see Makefile.
+// Each case is calibrated to a minimum sample time then sampled repeatedly; reports the median ns/op with the
+// median absolute deviation (MAD) so a noisy CI box doesn't skew the numbers like a mean would.
+#include <windows.h>
+#include <ida.hpp>
+#include <Utility.h>
+#include <IdbSnapshot.h>
+#include <PointerScan.h>
+#include <StringScan.h>
+#include <Hash.h>
+#include <FingerprintIndex.h>
+#include <FillerScan.h>
+#include <EntropyProfile.h>
+#include <MsgSink.h>
+
+// Keep the optimizer from discarding a result
+template <class T> static inline void keep(T const &value) { __asm__ __volatile__("" : : "r,m"(value) : "memory"); }
+
+static struct OPTIONS
+{
+	UINT32 samples;
+	double sampleTime;	// Minimum seconds per sample
+	LPCSTR filter;		// Only cases containing this string
+	LPCSTR snapshot;	// IdbSnapshot file for the database cases
+	BOOL csv;
+	BOOL check;			// Run the self checks instead
+} options = { 21, 0.002, NULL, NULL, FALSE, FALSE };
+
+// UtilityCheck.cpp, returns the number of failed checks
+UINT32 runChecks();
+
+struct RESULT
+{
+	double median, mad;	// ns/op
+	UINT64 iterations;	// Per sample
+};
+
+static double now() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+// Time 'body(count)', which runs 'count' operations
+template <class F> static double timeRun(F &body, UINT64 count)
+{
+	double start = now();
+	body(count);
+	return (now() - start);
+}
+
+static double median(std::vector<double> &v)
+{
+	std::sort(v.begin(), v.end());
+	size_t half = (v.size() / 2);
+	return ((v.size() & 1) ? v[half] : ((v[half - 1] + v[half]) / 2.0));
+}
+
+template <class F> static RESULT measure(F &&body, double sampleTime)
+{
+	// Calibrate iteration count, warming caches and branch predictors on the way
+	UINT64 count = 1;
+	for (;;)
+	{
+		double t = timeRun(body, count);
+		if (t >= sampleTime)
+			break;
+		count = ((t > (sampleTime / 64)) ? (UINT64) ((count * (sampleTime / t) * 1.05) + 1) : (count * 8));
+	}
+
+	std::vector<double> ns(options.samples);
+	for (double &v: ns)
+		v = ((timeRun(body, count) * 1e9) / (double) count);
+
+	RESULT r;
+	r.iterations = count;
+	r.median = median(ns);
+	for (double &v: ns)
+		v = fabs(v - r.median);
+	r.mad = median(ns);
+	return r;
+}
+
+static BOOL selected(LPCSTR name) { return (!options.filter || strstr(name, options.filter)); }
+
+static void report(LPCSTR name, const RESULT &r, double bytesPerOp = 0)
+{
+	double mbs = (bytesPerOp ? ((bytesPerOp * 1e9) / r.median / (1024.0 * 1024.0)) : 0);
+	if (options.csv)
+		printf("%s,%.3f,%.3f,%.1f\n", name, r.median, r.mad, mbs);
+	else
+	{
+		char mbsStr[32] = "";
+		if (bytesPerOp >= 1)
+		{
+			if (mbs >= 1024.0)
+				sprintf_s(mbsStr, sizeof(mbsStr), "%10.2f GB/s", (mbs / 1024.0));
+			else
+				sprintf_s(mbsStr, sizeof(mbsStr), "%10.1f MB/s", mbs);
+		}
+		printf("%-34s %12.2f ns/op  +/- %6.2f (%4.1f%%)  %s\n", name, r.median, r.mad, ((r.mad * 100.0) / r.median), mbsStr);
+	}
+}
+
+template <class F> static void run(LPCSTR name, F &&body, double bytesPerOp = 0, double sampleTime = 0)
+{
+	if (selected(name))
+		report(name, measure(body, (sampleTime ? sampleTime : options.sampleTime)), bytesPerOp);
+}
+
+// ----------------------------------------------------------------------------
+
+static const UINT32 INPUTS = 1024;	// Power of 2
+static UINT64 numbers[INPUTS];
+static TIMESTAMP times[INPUTS];
+static flags64_t flagValues[INPUTS];
+
+static void makeInputs()
+{
+	std::mt19937_64 rng(0x1DA);
+	for (UINT32 i = 0; i < INPUTS; i++)
+	{
+		// Spread over all magnitudes
+		numbers[i] = (rng() >> (rng() % 64));
+		times[i] = (std::ldexp((double) (rng() & 0xFFFF), -(int) (rng() % 24)) * 4.0);
+
+		// Plausible code and data flags
+		static const flags64_t base[] = { 0x00000600, 0x00000400, 0x20000400, 0x30000400, 0x50000400, 0x10010600, 0x00000200, 0x00000000 };
+		flagValues[i] = (base[rng() % _countof(base)] | (rng() & 0x000FF9FF & ~0x600));
+	}
+}
+
+static void benchStrings()
+{
+	run("NumberCommaString", [](UINT64 count)
+	{
+		char buffer[32];
+		for (UINT64 i = 0; i < count; i++)
+			keep(NumberCommaString(numbers[i & (INPUTS - 1)], buffer));
+	});
+
+	run("TimeString", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(TimeString(times[i & (INPUTS - 1)]));
+	});
+
+	run("byteSizeString", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(byteSizeString(numbers[i & (INPUTS - 1)]));
+	});
+
+	run("idaFlags2String", [](UINT64 count)
+	{
+		qstring s;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			idaFlags2String(flagValues[i & (INPUTS - 1)], s, TRUE);
+			keep(s.c_str());
+		}
+	});
+
+	static BYTE dumpData[256];
+	for (UINT32 i = 0; i < sizeof(dumpData); i++)
+		dumpData[i] = (BYTE) (i * 7);
+	stubMsgMuted = true;
+	run("DumpData 256 bytes", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			DumpData(dumpData, sizeof(dumpData), TRUE);
+	}, sizeof(dumpData));
+
+	run("msg line", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			msg("Found string at %llX: \"%s\"\n", (0x140001000ull + (i * 16)), "some text");
+	});
+	run("MsgSink::print line", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			MsgSink::print("Found string at %llX: \"%s\"\n", (0x140001000ull + (i * 16)), "some text");
+	});
+	stubMsgMuted = false;
+}
+
+static void benchHex()
+{
+	static ALIGN(16) char hex8[] = "1400A3F0";
+	static ALIGN(16) char hex64[] = "0123456789ABCDEFabcdef01234567890123456789ABCDEFabcdef0123456789";
+	static std::string hex4k;
+	hex4k.assign(4096, 'a');
+
+	run("isHexStr 8 chars", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(isHexStr(hex8));
+	}, SIZESTR(hex8) + 1);
+
+	run("isHexStr 64 chars", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(isHexStr(hex64 + (i & 1)));
+	}, SIZESTR(hex64) + 1);
+
+	run("isHexStr 4K chars", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(isHexStr(hex4k.c_str()));
+	}, 4096);
+}
+
+static void benchHash()
+{
+	static std::vector<BYTE> data(1024 * 1024);
+	std::mt19937_64 rng(0x1DA);
+	for (BYTE &b: data)
+		b = (BYTE) rng();
+
+	static const size_t sizes[] = { 16, 256, 4096, (1024 * 1024) };
+	for (size_t size: sizes)
+	{
+		char name[64], sizeStr[16];
+		if (size >= 1024)
+			sprintf_s(sizeStr, sizeof(sizeStr), "%uK", (UINT32) (size / 1024));
+		else
+			sprintf_s(sizeStr, sizeof(sizeStr), "%u", (UINT32) size);
+
+		sprintf_s(name, sizeof(name), "Hash::crc32c %s", sizeStr);
+		run(name, [size](UINT64 count)
+		{
+			for (UINT64 i = 0; i < count; i++)
+				keep(Hash::crc32c(data.data(), size));
+		}, (double) size);
+
+		sprintf_s(name, sizeof(name), "Hash::hash64 %s", sizeStr);
+		run(name, [size](UINT64 count)
+		{
+			for (UINT64 i = 0; i < count; i++)
+				keep(Hash::hash64(data.data(), size));
+		}, (double) size);
+
+		sprintf_s(name, sizeof(name), "Hash::hash128 %s", sizeStr);
+		run(name, [size](UINT64 count)
+		{
+			for (UINT64 i = 0; i < count; i++)
+				keep(Hash::hash128(data.data(), size));
+		}, (double) size);
+	}
+
+	// Streaming in instruction sized pieces, like hashing a normalized instruction stream
+	run("Hash::Stream 1MB in 4 byte updates", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+		{
+			Hash::Stream stream;
+			for (size_t offset = 0; offset < data.size(); offset += 4)
+				stream.update(&data[offset], 4);
+			keep(stream.digest64());
+		}
+	}, (double) data.size());
+}
+
+// Library detection workload: 200K function fingerprints against a 5M function corpus, about 1 in 4 known
+static void benchFingerprintIndex()
+{
+	if (!selected("FingerprintIndex"))
+		return;
+
+	static FingerprintIndex library, queries;
+	std::mt19937_64 rng(0x1DA);
+	std::vector<UINT64> known;
+	for (UINT32 i = 0; i < 5000000; i++)
+	{
+		UINT64 hash = rng();
+		library.add(hash, 64, i, "");
+		if ((i % 25) == 0)
+			known.push_back(hash);
+	}
+	library.finalize();
+	for (UINT32 i = 0; i < 200000; i++)
+		queries.add(((i & 3) ? rng() : known[rng() % known.size()]), 64, i, "");
+	queries.finalize();
+
+	run("FingerprintIndex match 200K/5M", [](UINT64 count)
+	{
+		std::vector<FingerprintIndex::MATCH> matches;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			matches.clear();
+			keep(library.match(queries, matches));
+		}
+	}, 0, 0.05);
+
+	run("FingerprintIndex find", [](UINT64 count)
+	{
+		const FingerprintIndex::ENTRY *entries = queries.entries();
+		for (UINT64 i = 0; i < count; i++)
+		{
+			size_t found;
+			keep(library.find(entries[i % queries.size()].hash, found));
+		}
+	});
+
+	library.clear();
+	queries.clear();
+}
+
+static void benchSlideBuffer()
+{
+	// Fresh buffer grown to 1MB in 4KB steps
+	run("SlideBuffer grow to 1MB", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+		{
+			SlideBuffer<BYTE> buffer;
+			for (size_t size = 4096; size <= (1024 * 1024); size += 4096)
+				keep(buffer.get(size));
+		}
+	}, (1024 * 1024));
+
+	run("SlideBuffer get() no growth", [](UINT64 count)
+	{
+		static SlideBuffer<BYTE> buffer;
+		buffer.get(64 * 1024);
+		for (UINT64 i = 0; i < count; i++)
+			keep(buffer.get(i & 0xFFFF));
+	});
+}
+
+static void benchCLock()
+{
+	static CLock lock;
+	static volatile UINT64 shared = 0;
+
+	UINT32 cores = max(std::thread::hardware_concurrency(), 1u);
+	for (UINT32 threads = 1; threads <= min(cores, 16u); threads *= 2)
+	{
+		char name[64];
+		sprintf_s(name, sizeof(name), "CLock lock/unlock %u thread%s", threads, ((threads == 1) ? "" : "s"));
+
+		// ns/op is wall time per lock/unlock pair across all threads; longer samples hide thread start cost
+		run(name, [threads](UINT64 count)
+		{
+			UINT64 perThread = max((count / threads), 1ull);
+			std::vector<std::thread> workers;
+			for (UINT32 t = 0; t < threads; t++)
+			{
+				workers.emplace_back([perThread]()
+				{
+					for (UINT64 i = 0; i < perThread; i++)
+					{
+						lock.lock();
+						shared = (shared + 1);
+						lock.unlock();
+					}
+				});
+			}
+			for (std::thread &w: workers)
+				w.join();
+		}, 0, 0.02);
+	}
+}
+
+static void benchPerfCounters()
+{
+	static PerfCounters::ID items = PerfCounters::registerCounter("Bench items");
+
+	UINT32 cores = max(std::thread::hardware_concurrency(), 1u);
+	for (UINT32 threads = 1; threads <= min(cores, 16u); threads *= 2)
+	{
+		char name[64];
+		sprintf_s(name, sizeof(name), "PerfCounters::add %u thread%s", threads, ((threads == 1) ? "" : "s"));
+
+		// Same shape as the CLock case, per thread slots should scale where the lock doesn't
+		run(name, [threads](UINT64 count)
+		{
+			UINT64 perThread = max((count / threads), 1ull);
+			std::vector<std::thread> workers;
+			for (UINT32 t = 0; t < threads; t++)
+			{
+				workers.emplace_back([perThread]()
+				{
+					for (UINT64 i = 0; i < perThread; i++)
+						PerfCounters::add(items);
+				});
+			}
+			for (std::thread &w: workers)
+				w.join();
+		}, 0, 0.02);
+	}
+
+	run("PerfCounters::value", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(PerfCounters::value(items));
+	});
+}
+
+// Database helpers replayed against a snapshot of a real IDB
+static BOOL benchIdb()
+{
+	static IdbSnapshot snapshot;
+	ResultCache::STATUS status = snapshot.load(options.snapshot);
+	if (status != ResultCache::CACHE_OK)
+	{
+		printf("Failed to load snapshot \"%s\": %s\n", options.snapshot, ResultCache::statusString(status));
+		return FALSE;
+	}
+	setIdbAccess(&snapshot);
+	plat.Configure();
+
+	// Random addresses inside segments
+	static std::vector<ea_t> addresses;
+	UINT64 imageSize = 0;
+	std::mt19937_64 rng(0x1DA);
+	for (UINT32 i = 0; i < snapshot.segmentCount(); i++)
+	{
+		IDB_SEGMENT segment;
+		snapshot.getSegment(i, segment);
+		imageSize += (segment.end - segment.start);
+	}
+	for (UINT32 i = 0; (i < INPUTS) && imageSize; i++)
+	{
+		UINT64 offset = (rng() % imageSize);
+		for (UINT32 j = 0; j < snapshot.segmentCount(); j++)
+		{
+			IDB_SEGMENT segment;
+			snapshot.getSegment(j, segment);
+			if (offset < (segment.end - segment.start))
+			{
+				addresses.push_back(segment.start + offset);
+				break;
+			}
+			offset -= (segment.end - segment.start);
+		}
+	}
+	if (addresses.empty())
+	{
+		printf("Snapshot \"%s\" has no segments.\n", options.snapshot);
+		return FALSE;
+	}
+	if (!options.csv)
+		printf("Snapshot: %u segments, %s.\n", snapshot.segmentCount(), byteSizeString(imageSize));
+
+	run("IDB PLAT::getEa", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(plat.getEa(addresses[i & (INPUTS - 1)]));
+	});
+
+	run("IDB isString", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(isString(addresses[i & (INPUTS - 1)]));
+	});
+
+	run("IDB getBytes 4K", [](UINT64 count)
+	{
+		static BYTE buffer[4096];
+		for (UINT64 i = 0; i < count; i++)
+			keep(idbAccess->getBytes(buffer, sizeof(buffer), addresses[i & (INPUTS - 1)]));
+	}, 4096);
+
+	// Whole image scan for a pattern that shouldn't be there
+	run("IDB FindBinary miss", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+			keep(FIND_BINARY(plat.MinAddress, plat.MaxAddress, "DE AD ?? BE EF 13 37 C0 DE"));
+	}, (double) imageSize, 0.05);
+
+	// Pointer sweep, the classic per address loop vs the SIMD scanner
+	run("IDB getEa+IS_VALID_ADDR loop", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+		{
+			size_t found = 0;
+			for (UINT32 j = 0; j < idbAccess->segmentCount(); j++)
+			{
+				IDB_SEGMENT segment;
+				idbAccess->getSegment(j, segment);
+				for (ea_t ea = segment.start; (ea + plat.ptrSize) <= segment.end; ea += plat.ptrSize)
+				{
+					ea_t target = plat.getEa(ea);
+					if (IS_VALID_ADDR(target))
+						found++;
+				}
+			}
+			keep(found);
+		}
+	}, (double) imageSize, 0.05);
+
+	run("IDB PointerScan::scanAll", [](UINT64 count)
+	{
+		std::vector<PointerScan::RUN> runs;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			runs.clear();
+			keep(PointerScan::scanAll(PointerScan::defaultOptions(), runs));
+		}
+	}, (double) imageSize, 0.05);
+
+	run("IDB StringScan::scanAll", [](UINT64 count)
+	{
+		std::vector<StringScan::STRING> strings;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			strings.clear();
+			keep(StringScan::scanAll(StringScan::defaultOptions(), strings));
+		}
+	}, (double) imageSize, 0.05);
+
+	run("IDB FillerScan::scanAll", [](UINT64 count)
+	{
+		std::vector<FillerScan::RUN> runs;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			runs.clear();
+			keep(FillerScan::scanAll(FillerScan::defaultOptions(), runs));
+		}
+	}, (double) imageSize, 0.05);
+
+	run("IDB EntropyProfile::profileAll", [](UINT64 count)
+	{
+		EntropyProfile::PROFILE profile;
+		for (UINT64 i = 0; i < count; i++)
+		{
+			EntropyProfile::profileAll(EntropyProfile::defaultOptions(), profile);
+			keep(profile.levels.size());
+		}
+	}, (double) imageSize, 0.05);
+
+	run("IDB Hash::hashRange64 image", [](UINT64 count)
+	{
+		for (UINT64 i = 0; i < count; i++)
+		{
+			UINT64 h = 0;
+			for (UINT32 j = 0; j < idbAccess->segmentCount(); j++)
+			{
+				IDB_SEGMENT segment;
+				idbAccess->getSegment(j, segment);
+				UINT64 segmentHash;
+				if (Hash::hashRange64(segment.start, segment.end, segmentHash, j))
+					h ^= segmentHash;
+			}
+			keep(h);
+		}
+	}, (double) imageSize, 0.05);
+
+	setIdbAccess(NULL);
+	return TRUE;
+}
+
+static void usage()
+{
+	printf("UtilityBench [-f filter] [-s samples] [-t sampleSeconds] [-i snapshot] [--csv] [--check]\n");
+}
+
+int main(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-f") == 0) && ((i + 1) < argc))
+			options.filter = argv[++i];
+		else
+		if ((strcmp(argv[i], "-s") == 0) && ((i + 1) < argc))
+		{
+			// Note: min/max are macros, don't pass side effects
+			UINT32 samples = (UINT32) atoi(argv[++i]);
+			options.samples = max(samples, 3u);
+		}
+		else
+		if ((strcmp(argv[i], "-t") == 0) && ((i + 1) < argc))
+		{
+			double sampleTime = atof(argv[++i]);
+			options.sampleTime = max(sampleTime, 0.0001);
+		}
+		else
+		if ((strcmp(argv[i], "-i") == 0) && ((i + 1) < argc))
+			options.snapshot = argv[++i];
+		else
+		if (strcmp(argv[i], "--csv") == 0)
+			options.csv = TRUE;
+		else
+		if (strcmp(argv[i], "--check") == 0)
+			options.check = TRUE;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (options.check)
+		return ((runChecks() == 0) ? 0 : 1);
+
+	if (options.csv)
+		printf("name,ns_per_op,mad_ns,mb_per_s\n");
+	else
+		printf("Utility benchmark: %u samples, %.1f ms minimum per sample, %u hardware threads.\n", options.samples, (options.sampleTime * 1000.0), std::thread::hardware_concurrency());
+
+	makeInputs();
+	benchStrings();
+	benchHex();
+	benchHash();
+	benchFingerprintIndex();
+	benchSlideBuffer();
+	benchCLock();
+	benchPerfCounters();
+	if (options.snapshot && !benchIdb())
+		return 1;
+	return 0;
+}
@@ -0,0 +1,681 @@
+// Utility primitives self checks, UtilityBench --check
+// Asserts results rather than timing them: the SIMD paths against their portable counterparts and a scalar
+// reference, the chunked scanners across their read boundaries on synthetic IdbSnapshot files, and the compact
+// containers against the std ones on random operations. Fixed seeds so a failure reproduces.
+#include <windows.h>
+#include <ida.hpp>
+#include <segment.hpp>
+#include <nalt.hpp>
+#include <Utility.h>
+#include <IdbSnapshot.h>
+#include <PointerScan.h>
+#include <StringScan.h>
+#include <Hash.h>
+#include <FillerScan.h>
+#include <EaBitmap.h>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+static UINT32 failures = 0;
+
+// Report the first few failures of each check, count all of them
+#define CHECK(_expression, ...) \
+	do { if (!(_expression)) { if (++failures <= 20) { printf("  FAIL %s:%d: %s ", __FILE__, __LINE__, #_expression); printf(__VA_ARGS__); printf("\n"); } } } while (0)
+
+static void begin(LPCSTR name)
+{
+	printf("%-34s ", name);
+	fflush(stdout);
+}
+
+static void end(UINT32 before)
+{
+	printf("%s\n", ((failures == before) ? "ok" : "FAILED"));
+}
+
+static void randomBytes(std::mt19937_64 &rng, __out std::vector<BYTE> &v, size_t size)
+{
+	v.resize(size);
+	for (BYTE &b: v)
+		b = (BYTE) rng();
+}
+
+// Synthetic snapshot made current for the scanner checks, removed on destruction
+class SyntheticIdb
+{
+public:
+	SyntheticIdb(LPCSTR path) : m_path(path), m_ok(FALSE) {}
+	~SyntheticIdb()
+	{
+		setIdbAccess(NULL);
+		m_snapshot.close();
+		remove(m_path);
+	}
+
+	BOOL create(BOOL is64, const std::vector<IDB_SEGMENT> &segments, const std::vector<BYTE> &bytes, const std::vector<flags64_t> &flags)
+	{
+		m_ok = (IdbSnapshot::save(m_path, is64, segments, bytes, flags) && (m_snapshot.load(m_path) == ResultCache::CACHE_OK));
+		if (m_ok)
+		{
+			setIdbAccess(&m_snapshot);
+			plat.Configure();
+		}
+		return m_ok;
+	}
+
+private:
+	LPCSTR m_path;
+	BOOL m_ok;
+	IdbSnapshot m_snapshot;
+};
+
+static IDB_SEGMENT makeSegment(ea_t start, ea_t end, LPCSTR name)
+{
+	IDB_SEGMENT segment = { start, end, SEGPERM_READ, SEG_DATA, 2, name };
+	return segment;
+}
+
+// ----------------------------------------------------------------------------
+
+static void checkCrc32c()
+{
+	UINT32 before = failures;
+	begin("Hash::crc32c");
+
+	static const char check[] = "123456789";
+	for (BOOL baseline = FALSE; baseline <= TRUE; baseline++)
+	{
+		Hash::setBaseline(baseline);
+		UINT32 crc = Hash::crc32c(check, (sizeof(check) - 1));
+		CHECK((crc == 0xE3069283), "baseline %d got %08X", baseline, crc);
+	}
+
+	// SSE4.2 vs slicing-by-8 over every short size and a spread of long ones and alignments, plus continuation
+	std::mt19937_64 rng(0xC3C);
+	std::vector<BYTE> data;
+	randomBytes(rng, data, (256 * 1024));
+	for (UINT32 i = 0; i < 3000; i++)
+	{
+		size_t size = ((i < 2048) ? i : (size_t) (rng() % (data.size() - 64)));
+		size_t offset = (size_t) (rng() % 64);
+		UINT32 seed = ((i & 1) ? (UINT32) rng() : 0);
+
+		Hash::setBaseline(FALSE);
+		UINT32 fast = Hash::crc32c(&data[offset], size, seed);
+		Hash::setBaseline(TRUE);
+		UINT32 slow = Hash::crc32c(&data[offset], size, seed);
+		CHECK((fast == slow), "size %llu offset %llu: %08X vs %08X", (UINT64) size, (UINT64) offset, fast, slow);
+
+		size_t split = (size ? (size_t) (rng() % size) : 0);
+		UINT32 joined = Hash::crc32c(&data[offset + split], (size - split), Hash::crc32c(&data[offset], split, seed));
+		CHECK((joined == slow), "size %llu split %llu", (UINT64) size, (UINT64) split);
+	}
+	Hash::setBaseline(FALSE);
+	end(before);
+}
+
+static void checkHashStream()
+{
+	UINT32 before = failures;
+	begin("Hash::Stream");
+
+	std::mt19937_64 rng(0x5EED);
+	std::vector<BYTE> data;
+	randomBytes(rng, data, (64 * 1024));
+
+	// Sizes around the short path limits, the stream buffer and the scramble block, then random ones
+	static const size_t edges[] = { 0, 1, 3, 4, 8, 9, 16, 17, 128, 129, 239, 240, 241, 255, 256, 257, 511, 512, 513, 1023, 1024, 1025, 4096, 4097, 16383, 16384, 16385 };
+	for (UINT32 i = 0; i < 600; i++)
+	{
+		size_t size = ((i < _countof(edges)) ? edges[i] : (size_t) (rng() % data.size()));
+		UINT64 seed = ((i & 1) ? rng() : 0);
+		Hash::setBaseline((i & 2) != 0);
+
+		UINT64 one64 = Hash::hash64(data.data(), size, seed);
+		Hash::HASH128 one128 = Hash::hash128(data.data(), size, seed);
+
+		// AVX2 lanes vs SSE2 ones
+		if (!(i & 2))
+		{
+			Hash::setBaseline(TRUE);
+			CHECK((Hash::hash64(data.data(), size, seed) == one64), "hash64 SSE2 vs AVX2, size %llu", (UINT64) size);
+			CHECK((Hash::hash128(data.data(), size, seed) == one128), "hash128 SSE2 vs AVX2, size %llu", (UINT64) size);
+			Hash::setBaseline(FALSE);
+		}
+
+		// Whole, byte at a time for the short ones, and random splits
+		for (UINT32 split = 0; split < 4; split++)
+		{
+			Hash::Stream stream(seed);
+			if (split == 0)
+				stream.update(data.data(), size);
+			else
+			if ((split == 1) && (size <= 1024))
+			{
+				for (size_t j = 0; j < size; j++)
+					stream.update(&data[j], 1);
+			}
+			else
+			{
+				for (size_t pos = 0; pos < size;)
+				{
+					size_t piece = (size_t) (rng() % ((rng() & 1) ? 300 : (size - pos + 1)));
+					if (piece > (size - pos))
+						piece = (size - pos);
+					stream.update(&data[pos], piece);
+					pos += piece;
+				}
+			}
+			CHECK((stream.digest64() == one64), "digest64 size %llu split %u", (UINT64) size, split);
+			CHECK((stream.digest128() == one128), "digest128 size %llu split %u", (UINT64) size, split);
+		}
+	}
+	Hash::setBaseline(FALSE);
+	end(before);
+}
+
+// ----------------------------------------------------------------------------
+
+static void checkPointerScan()
+{
+	UINT32 before = failures;
+	begin("PointerScan SSE2/AVX2/scalar");
+
+	std::mt19937_64 rng(0x9F7);
+	for (BOOL is64 = FALSE; is64 <= TRUE; is64++)
+	{
+		// Three segments with gaps, the middle one partly unloaded
+		ea_t base = (is64 ? 0x140000000ull : 0x400000ull);
+		std::vector<IDB_SEGMENT> segments = { makeSegment(base, (base + 0x21000), ".text"), makeSegment((base + 0x30000), (base + 0x48003), ".data"), makeSegment((base + 0x50000), (base + 0x51000), ".bss") };
+		size_t total = 0;
+		for (IDB_SEGMENT &segment: segments)
+			total += (size_t) (segment.end - segment.start);
+
+		// Values in and around the segments, at the edges where the biased compares could go wrong, and noise
+		std::vector<ea_t> interesting;
+		for (IDB_SEGMENT &segment: segments)
+		{
+			interesting.push_back(segment.start - 1);
+			interesting.push_back(segment.start);
+			interesting.push_back(segment.end - 1);
+			interesting.push_back(segment.end);
+		}
+		interesting.push_back(0);
+		interesting.push_back(is64 ? ~0ull : 0xFFFFFFFFull);
+		interesting.push_back(is64 ? (base | 0x8000000000000000ull) : (base | 0x80000000ull));
+		interesting.push_back(is64 ? (base + 0x100000000ull) : 0);
+
+		std::vector<BYTE> bytes(total);
+		std::vector<flags64_t> flags(total, (FF_DATA_ | FF_IVL));
+		UINT32 ptrSize = (is64 ? 8 : 4);
+		for (size_t pos = 0; pos < total;)
+		{
+			ea_t value;
+			UINT32 pick = (UINT32) (rng() % 8);
+			if (pick < 4)
+			{
+				const IDB_SEGMENT &segment = segments[rng() % segments.size()];
+				value = (segment.start + (rng() % (segment.end - segment.start)));
+			}
+			else
+			if (pick < 6)
+				value = interesting[rng() % interesting.size()];
+			else
+				value = (ea_t) rng();
+
+			// Mostly aligned, some at odd offsets
+			size_t step = ((rng() & 7) ? ptrSize : (1 + (rng() % ptrSize)));
+			for (UINT32 k = 0; (k < ptrSize) && ((pos + k) < total); k++)
+				bytes[pos + k] = (BYTE) (value >> (k * 8));
+			pos += step;
+		}
+		size_t unloaded = ((size_t) (segments[0].end - segments[0].start) + 0x8000);
+		for (size_t i = unloaded; i < (unloaded + 0x1000); i++)
+			flags[i] = 0;
+
+		SyntheticIdb idb("UtilityCheck.pointers.idbsnap");
+		if (!idb.create(is64, segments, bytes, flags))
+		{
+			CHECK(FALSE, "synthetic snapshot");
+			break;
+		}
+
+		auto valid = [&](ea_t value, BOOL checkLoaded) -> BOOL
+		{
+			for (IDB_SEGMENT &segment: segments)
+			{
+				if ((value >= segment.start) && (value < segment.end))
+					return (!checkLoaded || idbAccess->isLoaded(value));
+			}
+			return FALSE;
+		};
+
+		for (UINT32 alignment = 1; alignment <= ptrSize; alignment *= 2)
+		{
+			for (BOOL checkLoaded = FALSE; checkLoaded <= TRUE; checkLoaded++)
+			{
+				// Scalar reference, the pointer addresses
+				std::set<ea_t> expected;
+				for (IDB_SEGMENT &segment: segments)
+				{
+					for (ea_t ea = segment.start; (ea + ptrSize) <= segment.end; ea++)
+					{
+						if (!(ea % alignment) && valid(plat.getEa(ea), checkLoaded))
+							expected.insert(ea);
+					}
+				}
+
+				std::vector<PointerScan::RUN> runs[2];
+				for (BOOL noAvx2 = FALSE; noAvx2 <= TRUE; noAvx2++)
+				{
+					PointerScan::OPTIONS options = { alignment, 1, checkLoaded, noAvx2 };
+					size_t found = PointerScan::scanAll(options, runs[noAvx2]);
+					std::set<ea_t> got;
+					for (PointerScan::RUN &run: runs[noAvx2])
+					{
+						for (UINT32 k = 0; k < run.count; k++)
+							got.insert(run.start + (k * ptrSize));
+					}
+					CHECK(((found == expected.size()) && (got == expected)), "is64 %d alignment %u checkLoaded %d noAvx2 %d: %llu found, %llu expected",
+						  is64, alignment, checkLoaded, noAvx2, (UINT64) found, (UINT64) expected.size());
+				}
+				BOOL same = (runs[0].size() == runs[1].size());
+				for (size_t i = 0; same && (i < runs[0].size()); i++)
+					same = ((runs[0][i].start == runs[1][i].start) && (runs[0][i].count == runs[1][i].count));
+				CHECK(same, "is64 %d alignment %u: AVX2 and SSE2 runs differ", is64, alignment);
+			}
+		}
+	}
+	end(before);
+}
+
+// ----------------------------------------------------------------------------
+
+// StringScan reads 4MB chunks, FillerScan 1MB ones. Both start chunking at the scan start, so sliding the start
+// moves the chunk boundaries across the planted strings and filler runs.
+static const size_t STRING_CHUNK = (4 * 1024 * 1024);
+static const size_t FILLER_CHUNK = (1024 * 1024);
+
+struct PLANTED
+{
+	ea_t ea;
+	UINT32 length, characters;
+	int strtype;
+};
+
+static void checkStringScan()
+{
+	UINT32 before = failures;
+	begin("StringScan chunk boundaries");
+
+	// The strings sit past the first chunk on a non printable background, nothing else looks like a string
+	ea_t base = 0x10000000;
+	size_t size = (STRING_CHUNK + 0x20000);
+	std::vector<IDB_SEGMENT> segments = { makeSegment(base, (base + size), ".rdata") };
+	std::vector<BYTE> bytes(size, 0x01);
+	std::vector<flags64_t> flags(size, FF_IVL);
+
+	std::mt19937_64 rng(0x57E);
+	std::vector<PLANTED> planted;
+	size_t pos = (STRING_CHUNK + 0x100);
+	for (UINT32 i = 0; i < 24; i++)
+	{
+		UINT32 characters = (UINT32) (5 + (rng() % 56));
+		if (i & 1)
+		{
+			// UTF-16LE, at an even address
+			pos = ((pos + 1) & ~(size_t) 1);
+			for (UINT32 k = 0; k < characters; k++)
+			{
+				bytes[pos + (k * 2)] = (BYTE) ('A' + (rng() % 26));
+				bytes[pos + (k * 2) + 1] = 0;
+			}
+			bytes[pos + (characters * 2)] = bytes[pos + (characters * 2) + 1] = 0;
+			planted.push_back({ (base + pos), ((characters + 1) * 2), characters, STRTYPE_C_16 });
+			pos += ((characters + 1) * 2);
+		}
+		else
+		{
+			for (UINT32 k = 0; k < characters; k++)
+				bytes[pos + k] = (BYTE) ('a' + (rng() % 26));
+			bytes[pos + characters] = 0;
+			planted.push_back({ (base + pos), (characters + 1), characters, STRTYPE_C });
+			pos += (characters + 1);
+		}
+		pos += (3 + (rng() % 8));
+	}
+
+	// One running into the segment end, unterminated
+	UINT32 lastCharacters = 12;
+	for (UINT32 k = 0; k < lastCharacters; k++)
+		bytes[size - lastCharacters + k] = 'z';
+	planted.push_back({ (base + size - lastCharacters), lastCharacters, lastCharacters, STRTYPE_C });
+
+	SyntheticIdb idb("UtilityCheck.strings.idbsnap");
+	if (!idb.create(TRUE, segments, bytes, flags))
+	{
+		CHECK(FALSE, "synthetic snapshot");
+		end(before);
+		return;
+	}
+
+	// Boundary just before, at, inside, at the end and after the terminator of each string, at both parities
+	std::vector<ea_t> boundaries;
+	for (PLANTED &p: planted)
+	{
+		static const INT32 offsets[] = { -2, -1, 0, 1, 2, 3 };
+		for (INT32 offset: offsets)
+			boundaries.push_back(p.ea + offset);
+		boundaries.push_back(p.ea + (p.length / 2));
+		boundaries.push_back(p.ea + p.length - 1);
+		boundaries.push_back(p.ea + p.length);
+	}
+
+	for (ea_t boundary: boundaries)
+	{
+		ea_t start = (boundary - STRING_CHUNK);
+		for (UINT32 variant = 0; variant < 2; variant++)
+		{
+			StringScan::OPTIONS options = StringScan::defaultOptions();
+			options.skipDefined = FALSE;
+			options.maxLength = ((variant == 0) ? options.maxLength : 64);
+			options.threads = ((variant == 0) ? 1 : 4);
+
+			std::vector<StringScan::STRING> strings;
+			size_t found = StringScan::scan(start, (base + size), options, strings);
+			BOOL match = ((found == planted.size()) && (strings.size() == planted.size()));
+			for (size_t i = 0; match && (i < planted.size()); i++)
+			{
+				const StringScan::STRING &s = strings[i];
+				match = ((s.ea == planted[i].ea) && (s.length == planted[i].length) && (s.characters == planted[i].characters) && (s.strtype == planted[i].strtype));
+				CHECK(match, "boundary %llX: string %llu at %llX length %u, expected %llX length %u", (UINT64) boundary, (UINT64) i, (UINT64) s.ea, s.length, (UINT64) planted[i].ea, planted[i].length);
+			}
+			CHECK((found == planted.size()), "boundary %llX variant %u: %llu found, %llu expected", (UINT64) boundary, variant, (UINT64) found, (UINT64) planted.size());
+		}
+	}
+	end(before);
+}
+
+// Scalar reference: runs of filler bytes in [start, end), single valued unless 'mixed'
+static void referenceFiller(const std::vector<BYTE> &bytes, ea_t base, ea_t start, ea_t end, const FillerScan::OPTIONS &options, __out std::vector<FillerScan::RUN> &runs)
+{
+	auto isFiller = [&](BYTE value)
+	{
+		for (UINT32 k = 0; k < options.valueCount; k++)
+		{
+			if (options.values[k] == value)
+				return TRUE;
+		}
+		return FALSE;
+	};
+
+	for (ea_t ea = start; ea < end;)
+	{
+		BYTE value = bytes[(size_t) (ea - base)];
+		if (!isFiller(value))
+		{
+			ea++;
+			continue;
+		}
+		ea_t runEnd = (ea + 1);
+		while ((runEnd < end) && isFiller(bytes[(size_t) (runEnd - base)]) && (options.mixed || (bytes[(size_t) (runEnd - base)] == value)))
+			runEnd++;
+		if ((runEnd - ea) >= options.minLength)
+			runs.push_back({ ea, (UINT32) (runEnd - ea), value });
+		ea = runEnd;
+	}
+}
+
+static void checkFillerScan()
+{
+	UINT32 before = failures;
+	begin("FillerScan SSE2/AVX2/boundaries");
+
+	// Runs of filler and other bytes, long enough to span whole 64 byte blocks and chunks
+	ea_t base = 0x20000000;
+	size_t size = ((2 * FILLER_CHUNK) + 0x10000 + 77);
+	std::vector<IDB_SEGMENT> segments = { makeSegment(base, (base + size), ".data") };
+	std::vector<BYTE> bytes(size);
+	std::vector<flags64_t> flags(size, (FF_DATA_ | FF_IVL));
+
+	std::mt19937_64 rng(0xF11);
+	static const BYTE fill[] = { 0xCC, 0x90, 0x00, 0xCC };
+	for (size_t pos = 0; pos < size;)
+	{
+		size_t length = ((rng() & 15) ? (1 + (rng() % 24)) : (1 + (rng() % 300)));
+		UINT32 pick = (UINT32) (rng() % 8);
+		for (size_t k = 0; (k < length) && (pos < size); k++, pos++)
+			bytes[pos] = ((pick < 4) ? fill[pick] : ((pick < 6) ? fill[rng() % 3] : (BYTE) rng()));
+	}
+
+	SyntheticIdb idb("UtilityCheck.filler.idbsnap");
+	if (!idb.create(TRUE, segments, bytes, flags))
+	{
+		CHECK(FALSE, "synthetic snapshot");
+		end(before);
+		return;
+	}
+
+	for (UINT32 i = 0; i < 48; i++)
+	{
+		// Random starts, odd and even, so runs straddle the chunk and block boundaries in every phase
+		ea_t start = (base + ((i == 0) ? 0 : (rng() % 0x10000)));
+		FillerScan::OPTIONS options = FillerScan::defaultOptions();
+		options.valueCount = (1 + (i % 3));
+		options.minLength = ((i & 4) ? 1 : (1 + (UINT32) (rng() % 20)));
+		options.mixed = ((i & 8) != 0);
+
+		std::vector<FillerScan::RUN> expected;
+		referenceFiller(bytes, base, start, (base + size), options, expected);
+
+		for (BOOL noAvx2 = FALSE; noAvx2 <= TRUE; noAvx2++)
+		{
+			options.noAvx2 = noAvx2;
+			std::vector<FillerScan::RUN> runs;
+			size_t found = FillerScan::scan(start, (base + size), options, runs);
+			BOOL match = ((found == expected.size()) && (runs.size() == expected.size()));
+			for (size_t j = 0; match && (j < runs.size()); j++)
+				match = ((runs[j].start == expected[j].start) && (runs[j].length == expected[j].length) && (runs[j].value == expected[j].value));
+			CHECK(match, "start %llX values %u minLength %u mixed %d noAvx2 %d: %llu found, %llu expected", (UINT64) start, options.valueCount, options.minLength,
+				  options.mixed, noAvx2, (UINT64) found, (UINT64) expected.size());
+		}
+	}
+	end(before);
+}
+
+// ----------------------------------------------------------------------------
+
+static void checkEaBitmap()
+{
+	UINT32 before = failures;
+	begin("EaBitmap vs std::set");
+
+	std::mt19937_64 rng(0xB17);
+	for (UINT32 round = 0; round < 8; round++)
+	{
+		// A few 64K containers so they churn through the array, bitmap and run encodings
+		ea_t base = (0x140000000ull + ((rng() % 16) << 16));
+		ea_t span = (4 * 0x10000);
+		EaBitmap bitmap, other;
+		std::set<ea_t> reference, otherReference;
+
+		for (UINT32 op = 0; op < 20000; op++)
+		{
+			ea_t ea = (base + (rng() % span));
+			switch (rng() % 8)
+			{
+				case 0:
+				case 1:
+				bitmap.add(ea);
+				reference.insert(ea);
+				break;
+
+				case 2:
+				{
+					ea_t rangeEnd = (ea + ((rng() & 63) ? (rng() % 64) : (rng() % 0x18000)));
+					bitmap.addRange(ea, rangeEnd);
+					for (ea_t i = ea; i < rangeEnd; i++)
+						reference.insert(i);
+				}
+				break;
+
+				case 3:
+				case 4:
+				CHECK((bitmap.remove(ea) == (reference.erase(ea) != 0)), "remove %llX", (UINT64) ea);
+				break;
+
+				case 5:
+				{
+					other.add(ea);
+					otherReference.insert(ea);
+				}
+				break;
+
+				default:
+				CHECK((bitmap.contains(ea) == (reference.count(ea) != 0)), "contains %llX", (UINT64) ea);
+				break;
+			}
+
+			if ((op % 5000) == 4999)
+			{
+				if (rng() & 1)
+					bitmap.optimize();
+
+				CHECK((bitmap.count() == reference.size()), "count %llu vs %llu", bitmap.count(), (UINT64) reference.size());
+				std::vector<ea_t> elements;
+				bitmap.forEach([&](ea_t e) { elements.push_back(e); });
+				CHECK((elements == std::vector<ea_t>(reference.begin(), reference.end())), "forEach round %u op %u", round, op);
+
+				std::set<ea_t> fromRanges;
+				ea_t lastEnd = 0;
+				BOOL disjoint = TRUE;
+				bitmap.forEachRange([&](ea_t start, ea_t end)
+				{
+					disjoint = (disjoint && (start > lastEnd || !lastEnd) && (start < end));
+					lastEnd = end;
+					for (ea_t e = start; e < end; e++)
+						fromRanges.insert(e);
+				});
+				CHECK((fromRanges == reference), "forEachRange round %u op %u", round, op);
+				CHECK(disjoint, "forEachRange ranges not sorted, merged and disjoint");
+			}
+		}
+
+		// Set operations
+		if (round & 1)
+		{
+			bitmap.orWith(other);
+			reference.insert(otherReference.begin(), otherReference.end());
+		}
+		else
+		{
+			bitmap.andWith(other);
+			std::set<ea_t> both;
+			for (ea_t e: reference)
+			{
+				if (otherReference.count(e))
+					both.insert(e);
+			}
+			reference.swap(both);
+		}
+		std::vector<ea_t> elements;
+		bitmap.forEach([&](ea_t e) { elements.push_back(e); });
+		CHECK((elements == std::vector<ea_t>(reference.begin(), reference.end())), "%s round %u", ((round & 1) ? "orWith" : "andWith"), round);
+		CHECK((bitmap.count() == reference.size()), "count after set operation");
+	}
+	end(before);
+}
+
+static void checkEaHashMap()
+{
+	UINT32 before = failures;
+	begin("EaHashMap vs std::unordered_map");
+
+	std::mt19937_64 rng(0x4A5);
+	for (UINT32 round = 0; round < 6; round++)
+	{
+		// Narrow key ranges collide and cluster, wide ones don't
+		ea_t span = ((round & 1) ? 0x1000 : 0x100000000ull);
+		EaHashMap<UINT64> map((round & 2) ? 0 : 5000);
+		EaHashSet set;
+		std::unordered_map<ea_t, UINT64> reference;
+		std::unordered_set<ea_t> setReference;
+
+		for (UINT32 op = 0; op < 100000; op++)
+		{
+			ea_t key = (0x400000 + ((rng() % span) * ((round & 4) ? 0x1000 : 1)));
+			UINT64 value = rng();
+			switch (rng() % 6)
+			{
+				case 0:
+				CHECK((map.insert(key, value) == reference.insert_or_assign(key, value).second), "insert %llX", (UINT64) key);
+				break;
+
+				case 1:
+				map[key] += value;
+				reference[key] += value;
+				break;
+
+				case 2:
+				CHECK((map.erase(key) == (reference.erase(key) != 0)), "erase %llX", (UINT64) key);
+				break;
+
+				case 3:
+				CHECK((set.insert(key) == setReference.insert(key).second), "set insert %llX", (UINT64) key);
+				break;
+
+				case 4:
+				CHECK((set.erase(key) == (setReference.erase(key) != 0)), "set erase %llX", (UINT64) key);
+				break;
+
+				default:
+				{
+					UINT64 *found = map.find(key);
+					auto it = reference.find(key);
+					CHECK(((found != NULL) == (it != reference.end())) && (!found || (*found == it->second)), "find %llX", (UINT64) key);
+					CHECK((set.contains(key) == (setReference.count(key) != 0)), "set contains %llX", (UINT64) key);
+				}
+				break;
+			}
+		}
+
+		CHECK((map.size() == reference.size()), "size %llu vs %llu", (UINT64) map.size(), (UINT64) reference.size());
+		size_t visited = 0;
+		map.forEach([&](ea_t key, UINT64 &value)
+		{
+			auto it = reference.find(key);
+			CHECK(((it != reference.end()) && (it->second == value)), "forEach %llX", (UINT64) key);
+			visited++;
+		});
+		CHECK((visited == reference.size()), "forEach visited %llu", (UINT64) visited);
+
+		CHECK((set.size() == setReference.size()), "set size");
+		set.forEach([&](ea_t key) { CHECK(setReference.count(key), "set forEach %llX", (UINT64) key); });
+
+		map.clear();
+		CHECK(((map.size() == 0) && !map.find(0x400000)), "clear");
+	}
+	end(before);
+}
+
+// ----------------------------------------------------------------------------
+
+// Returns the number of failed assertions
+UINT32 runChecks()
+{
+	printf("Utility self checks: AVX2 %s, SSE4.2 %s.\n", (cpuHasAvx2() ? "yes" : "no"), (cpuHasSse42() ? "yes" : "no"));
+	checkCrc32c();
+	checkHashStream();
+	checkPointerScan();
+	checkStringScan();
+	checkFillerScan();
+	checkEaBitmap();
+	checkEaHashMap();
+
+	if (failures)
+		printf("%u check(s) FAILED.\n", failures);
+	else
+		printf("All checks passed.\n");
+	return failures;
+}
@@ -0,0 +1,5 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+inline bool enable_auto(bool enable) { return !enable; }
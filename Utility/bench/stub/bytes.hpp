@@ -0,0 +1,3 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
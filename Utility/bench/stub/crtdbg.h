@@ -0,0 +1,3 @@
+
+// Empty MSVC CRT header stand-in
+#pragma once
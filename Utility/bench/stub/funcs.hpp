@@ -0,0 +1,18 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+// Functions, none
+struct range_t { ea_t start_ea, end_ea; };
+#define FUNC_THUNK 0x00000080
+struct func_t : range_t { uint64 flags; int tailqty; };
+inline size_t get_func_qty() { return 0; }
+inline func_t *getn_func(size_t) { return NULL; }
+inline ssize_t get_func_name(qstring *buf, ea_t) { buf->clear(); return -1; }
+struct func_tail_iterator_t
+{
+	func_tail_iterator_t(func_t *, ea_t = BADADDR) {}
+	bool first() { return false; }
+	bool next() { return false; }
+	const range_t &chunk() const { static range_t none = {}; return none; }
+};
@@ -0,0 +1,170 @@
+
+// Thin IDA SDK stand-in for building the Utility sources outside of IDA.
+// Just the types and calls Utility.h/.cpp use. The "database" is empty: no flags, no bytes, no matches.
+#pragma once
+
+typedef unsigned long long ea_t, flags64_t, asize_t, tid_t, uval_t;
+typedef long long sval_t, adiff_t;
+typedef uint32_t flags_t;
+typedef unsigned char uchar;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef unsigned long long uint64;
+typedef int32_t int32;
+typedef long long int64;
+#define BADADDR ea_t(-1)
+#define idaapi
+
+// Growable string, the subset of the SDK qstring interface in use
+class qstring
+{
+public:
+	qstring() {}
+	qstring(const char *s) : m_s(s) {}
+	const char *c_str() const { return m_s.c_str(); }
+	size_t length() const { return m_s.length(); }
+	size_t size() const { return (m_s.length() + 1); }
+	bool empty() const { return m_s.empty(); }
+	void clear() { m_s.clear(); }
+	void qclear() { m_s.clear(); m_s.shrink_to_fit(); }
+	void resize(size_t n) { m_s.resize(n); }
+	void reserve(size_t n) { m_s.reserve(n); }
+	char *begin() { return &m_s[0]; }
+	char &operator[](size_t i) { return m_s[i]; }
+	char operator[](size_t i) const { return m_s[i]; }
+	qstring &append(const char *s, size_t n) { m_s.append(s, n); return *this; }
+	qstring &operator+=(const char *s) { m_s += s; return *this; }
+	qstring &operator+=(char c) { m_s += c; return *this; }
+	qstring &operator+=(const qstring &s) { m_s += s.m_s; return *this; }
+	bool operator==(const qstring &s) const { return (m_s == s.m_s); }
+	bool operator!=(const qstring &s) const { return (m_s != s.m_s); }
+
+	qstring &sprnt(const char *format, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list va;
+		va_start(va, format);
+		m_s.clear();
+		vcat(format, va);
+		va_end(va);
+		return *this;
+	}
+	qstring &cat_sprnt(const char *format, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list va;
+		va_start(va, format);
+		vcat(format, va);
+		va_end(va);
+		return *this;
+	}
+
+private:
+	void vcat(const char *format, va_list va)
+	{
+		va_list copy;
+		va_copy(copy, va);
+		int length = vsnprintf(NULL, 0, format, copy);
+		va_end(copy);
+		if (length > 0)
+		{
+			size_t start = m_s.length();
+			m_s.resize(start + length);
+			vsnprintf(&m_s[start], (length + 1), format, va);
+		}
+	}
+
+	std::string m_s;
+};
+
+template <class T> class qvector : public std::vector<T>
+{
+public:
+	using std::vector<T>::push_back;
+	T &push_back() { this->emplace_back(); return this->back(); }
+};
+typedef qvector<qstring> qstrvec_t;
+typedef qvector<ea_t> eavec_t;
+
+// Output window, to stdout unless muted
+inline bool stubMsgMuted = false;
+inline int vmsg(const char *format, va_list va)
+{
+	if (stubMsgMuted)
+	{
+		// Still pay the formatting cost
+		char buffer[1024];
+		return vsnprintf(buffer, sizeof(buffer), format, va);
+	}
+	return vprintf(format, va);
+}
+inline int msg(const char *format, ...) __attribute__((format(printf, 1, 2)));
+inline int msg(const char *format, ...)
+{
+	va_list va;
+	va_start(va, format);
+	int result = vmsg(format, va);
+	va_end(va);
+	return result;
+}
+
+// Flags
+#define MS_CLS  0x00000600
+#define FF_CODE_ 0x00000600
+#define FF_DATA_ 0x00000400
+#define FF_TAIL_ 0x00000200
+#define MS_DTYPE_ 0xF0000000
+#define FF_IVL   0x00000100
+inline bool is_code(flags64_t f) { return ((f & MS_CLS) == FF_CODE_); }
+inline bool is_data(flags64_t f) { return ((f & MS_CLS) == FF_DATA_); }
+inline bool is_tail(flags64_t f) { return ((f & MS_CLS) == FF_TAIL_); }
+inline bool is_head(flags64_t f) { return ((f & FF_DATA_) != 0); }
+inline bool is_dword(flags64_t f) { return (is_data(f) && ((f & MS_DTYPE_) == 0x20000000)); }
+inline bool is_qword(flags64_t f) { return (is_data(f) && ((f & MS_DTYPE_) == 0x30000000)); }
+inline bool is_strlit(flags64_t f) { return (is_data(f) && ((f & MS_DTYPE_) == 0x50000000)); }
+
+// Database access
+inline flags64_t get_flags(ea_t) { return 0; }
+inline bool is_loaded(ea_t) { return false; }
+inline uchar get_byte(ea_t) { return 0; }
+inline uint32 get_32bit(ea_t) { return 0; }
+inline uint64 get_64bit(ea_t) { return 0; }
+#define GMB_READALL 1
+inline ssize_t get_bytes(void *buf, ssize_t size, ea_t, int = 0) { memset(buf, 0, size); return 0; }
+inline ea_t next_head(ea_t, ea_t) { return BADADDR; }
+inline asize_t get_item_size(ea_t) { return 1; }
+inline bool is_off(flags64_t, int) { return false; }
+inline bool inf_is_64bit() { return true; }
+inline ea_t inf_get_min_ea() { return 0x140000000; }
+inline ea_t inf_get_max_ea() { return 0x140100000; }
+
+// Edits, the database is read only
+inline bool create_data(ea_t, flags64_t, asize_t, tid_t) { return false; }
+inline bool create_strlit(ea_t, size_t, int32) { return false; }
+inline bool create_align(ea_t, asize_t, int) { return false; }
+#define DELIT_SIMPLE 0
+inline bool del_items(ea_t, int = 0, asize_t = 1) { return false; }
+inline bool set_cmt(ea_t, const char *, bool) { return false; }
+
+// Segments, none
+struct segment_t { ea_t start_ea, end_ea; uchar perm, type, bitness; };
+inline int get_segm_qty() { return 0; }
+inline segment_t *getnseg(int) { return NULL; }
+inline ssize_t get_segm_name(qstring *buf, const segment_t *, int = 0) { buf->clear(); return -1; }
+
+// Strings
+#define STRTYPE_C 0
+struct opinfo_t { int32 strtype; };
+inline opinfo_t *get_opinfo(opinfo_t *, ea_t, int, flags64_t) { return NULL; }
+inline size_t get_strtype_bpu(int32 strtype) { return (size_t) (1 << (strtype & 3)); }
+
+// Disassembly and search
+#define GENDSM_FORCE_CODE  1
+#define GENDSM_REMOVE_TAGS 2
+inline bool generate_disasm_line(qstring *buf, ea_t, int = 0) { *buf = "nop"; return true; }
+
+#define PBSENC_DEF1BPU      0
+#define BIN_SEARCH_FORWARD  0
+#define BIN_SEARCH_NOBREAK  1
+#define BIN_SEARCH_NOSHOW   2
+struct compiled_binpat_vec_t {};
+inline bool parse_binpat_str(compiled_binpat_vec_t *, ea_t, const char *, int, int = 0, qstring *errbuf = NULL) { if (errbuf) *errbuf = "not supported"; return false; }
+inline ea_t bin_search(ea_t, ea_t, const compiled_binpat_vec_t &, int) { return BADADDR; }
@@ -0,0 +1,19 @@
+
+// MSVC intrinsics used by the Utility sources, mapped to GCC/Clang builtins
+#pragma once
+#include <x86intrin.h>
+
+inline unsigned char _BitScanForward(unsigned long *index, unsigned long mask) { if (!mask) return 0; *index = __builtin_ctzl(mask); return 1; }
+inline unsigned char _BitScanForward64(unsigned long *index, unsigned long long mask) { if (!mask) return 0; *index = __builtin_ctzll(mask); return 1; }
+inline unsigned char _BitScanReverse(unsigned long *index, unsigned long mask) { if (!mask) return 0; *index = (63 - __builtin_clzl(mask)); return 1; }
+inline unsigned char _BitScanReverse64(unsigned long *index, unsigned long long mask) { if (!mask) return 0; *index = (63 - __builtin_clzll(mask)); return 1; }
+inline unsigned int __popcnt(unsigned int v) { return __builtin_popcount(v); }
+inline unsigned long long __popcnt64(unsigned long long v) { return __builtin_popcountll(v); }
+inline unsigned long long _rotl64(unsigned long long v, int shift) { return __rolq(v, shift); }
+inline unsigned long long _rotr64(unsigned long long v, int shift) { return __rorq(v, shift); }
+inline unsigned long long _byteswap_uint64(unsigned long long v) { return __builtin_bswap64(v); }
+inline unsigned long _byteswap_ulong(unsigned long v) { return __builtin_bswap32((unsigned int) v); }
+inline unsigned short _byteswap_ushort(unsigned short v) { return __builtin_bswap16(v); }
+inline void __cpuidex(int info[4], int leaf, int subLeaf) { __asm__ __volatile__("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(leaf), "c"(subLeaf)); }
+inline void __cpuid(int info[4], int leaf) { __cpuidex(info, leaf, 0); }
+inline unsigned long long _umul128(unsigned long long a, unsigned long long b, unsigned long long *hi) { unsigned __int128 r = ((unsigned __int128) a * b); *hi = (unsigned long long) (r >> 64); return (unsigned long long) r; }
@@ -0,0 +1,6 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+#define IWID_ALL 0xFFFFFFFF
+inline void request_refresh(uint64, bool = true) {}
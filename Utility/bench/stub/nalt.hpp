@@ -0,0 +1,14 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+// No IDB or input file
+enum path_type_t { PATH_TYPE_CMD, PATH_TYPE_IDB, PATH_TYPE_ID0 };
+inline const char *get_path(path_type_t) { return ""; }
+inline bool retrieve_input_file_sha256(uchar *) { return false; }
+
+// String types
+#define STRTYPE_C_16 1
+inline int add_encoding(const char *) { return 1; }
+inline int find_encoding(const char *) { return 0; }
+inline int32 set_str_encoding_idx(int32 strtype, int encoding) { return (strtype | (encoding << 24)); }
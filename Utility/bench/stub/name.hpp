@@ -0,0 +1,8 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+#define SN_NOWARN 0x100
+#define BADNODE nodeidx_t(-1)
+typedef ea_t nodeidx_t;
+inline bool set_name(ea_t, const char *, int = 0) { return false; }
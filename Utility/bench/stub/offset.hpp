@@ -0,0 +1,5 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+inline bool op_offset(ea_t, int, uint32, ea_t = BADADDR, ea_t = 0, adiff_t = 0) { return false; }
@@ -0,0 +1,9 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+// Segment permission and type values in use
+#define SEGPERM_EXEC 1
+#define SEGPERM_READ 4
+#define SEG_CODE 2
+#define SEG_DATA 3
@@ -0,0 +1,4 @@
+
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
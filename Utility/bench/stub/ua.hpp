@@ -0,0 +1,10 @@
+// IDA SDK stand-in, see ida.hpp
+#pragma once
+#include "ida.hpp"
+
+// Instruction decoding, nothing decodes
+#define UA_MAXOP 8
+enum { o_void, o_reg, o_mem, o_phrase, o_displ, o_imm, o_far, o_near };
+struct op_t { uchar n, type; char offb, offo; };
+struct insn_t { ea_t ea; uint16 size; op_t ops[UA_MAXOP]; };
+inline int decode_insn(insn_t *insn, ea_t) { memset(insn, 0, sizeof(*insn)); return 0; }
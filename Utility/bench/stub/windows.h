@@ -0,0 +1,211 @@
+
+// Thin Win32/MSVC CRT stand-in so the Utility sources build with GCC/Clang on Linux for benchmarking.
+// Only what the Utility sources actually use; UI/OS features (clipboard, FormatMessage, etc.) just fail.
+#pragma once
+
+// Standard headers up front since the min/max macros below break them if included later
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Types
+typedef int BOOL;
+typedef unsigned char BYTE, BOOLEAN, *PBYTE;
+typedef uint8_t UINT8;
+typedef int8_t INT8;
+typedef uint16_t WORD, UINT16;
+typedef int16_t INT16;
+typedef uint32_t DWORD, UINT32, UINT, ULONG;
+typedef int32_t INT32, LONG;
+typedef unsigned long long UINT64, ULONG64, DWORD64, ULONGLONG;
+typedef long long INT64, LONGLONG;
+typedef uintptr_t UINT_PTR, ULONG_PTR, SIZE_T;
+typedef intptr_t INT_PTR, LONG_PTR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef void *PVOID, *LPVOID, *HANDLE, *HGLOBAL, *HWND;
+typedef const void *LPCVOID;
+union LARGE_INTEGER { struct { DWORD LowPart; LONG HighPart; }; LONGLONG QuadPart; };
+
+#define TRUE  1
+#define FALSE 0
+#define MAX_PATH   260
+#define _MAX_DRIVE 3
+#define _MAX_DIR   256
+#define _MAX_FNAME 256
+#define _MAX_EXT   256
+#define _TRUNCATE  ((size_t) -1)
+#define INFINITE   0xFFFFFFFF
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+// Compiler extensions
+#define __declspec(_x) __stub_declspec_##_x
+#define __stub_declspec_align(_n) __attribute__((aligned(_n)))
+#define __stub_declspec_noinline __attribute__((noinline))
+#define __forceinline inline __attribute__((always_inline))
+#define __try try
+#define __except(_x) catch(...)
+#define CALLBACK
+#define WINAPI
+
+// SAL annotations
+#define __in
+#define __in_z
+#define __in_opt
+#define __out
+#define __out_opt
+#define __inout
+#define __bcount(_x)
+#define __in_bcount(_x)
+#define __out_bcount(_x)
+#define __out_bcount_z(_x)
+#define __inout_bcount(_x)
+#define __in_ecount(_x)
+#define __out_ecount(_x)
+
+// CRT
+#define _ASSERT(_x) ((void) 0)
+#define _countof(_a) (sizeof(_a) / sizeof((_a)[0]))
+#define ZeroMemory(_p, _n) memset((_p), 0, (_n))
+#define sprintf_s snprintf
+#define _vsnprintf_s(_b, _s, _c, _f, _v) vsnprintf((_b), (_s), (_f), (_v))
+#define _ftelli64 ftello
+#define _fseeki64 fseeko
+
+inline int strcpy_s(char *dst, size_t size, const char *src)
+{
+	size_t length = strlen(src);
+	if (length >= size)
+		length = (size - 1);
+	memcpy(dst, src, length);
+	dst[length] = 0;
+	return 0;
+}
+inline int strncpy_s(char *dst, size_t size, const char *src, size_t count)
+{
+	size_t length = strlen(src);
+	if (count < length)
+		length = count;
+	if (length >= size)
+		length = (size - 1);
+	memcpy(dst, src, length);
+	dst[length] = 0;
+	return 0;
+}
+inline char *_strrev(char *s) { std::reverse(s, (s + strlen(s))); return s; }
+inline char *_itoa(int value, char *buffer, int radix) { sprintf(buffer, ((radix == 16) ? "%x" : "%d"), value); return buffer; }
+inline char *_ui64toa(uint64_t value, char *buffer, int radix) { sprintf(buffer, ((radix == 16) ? "%llx" : "%llu"), (unsigned long long) value); return buffer; }
+
+inline void *_aligned_malloc(size_t size, size_t alignment)
+{
+	void *p = NULL;
+	if (posix_memalign(&p, ((alignment < sizeof(void *)) ? sizeof(void *) : alignment), (size ? size : 1)) != 0)
+		return NULL;
+	return p;
+}
+inline void _aligned_free(void *p) { free(p); }
+inline void *_aligned_realloc(void *p, size_t size, size_t alignment)
+{
+	void *n = _aligned_malloc(size, alignment);
+	if (n && p)
+	{
+		size_t oldSize = malloc_usable_size(p);
+		memcpy(n, p, ((oldSize < size) ? oldSize : size));
+		free(p);
+	}
+	return n;
+}
+
+// Path splitting, drive is always empty
+inline void _splitpath(const char *path, char *drive, char *dir, char *name, char *ext)
+{
+	const char *slash = strrchr(path, '/');
+	const char *base = (slash ? (slash + 1) : path);
+	const char *dot = strrchr(base, '.');
+	if (!dot)
+		dot = (base + strlen(base));
+	if (drive) drive[0] = 0;
+	if (dir) { memcpy(dir, path, (base - path)); dir[base - path] = 0; }
+	if (name) { memcpy(name, base, (dot - base)); name[dot - base] = 0; }
+	if (ext) strcpy(ext, dot);
+}
+inline void _splitpath_s(const char *path, char *drive, size_t, char *dir, size_t, char *name, size_t, char *ext, size_t) { _splitpath(path, drive, dir, name, ext); }
+inline void _makepath(char *path, const char *drive, const char *dir, const char *name, const char *ext)
+{
+	snprintf(path, MAX_PATH, "%s%s%s%s%s", (drive ? drive : ""), (dir ? dir : ""), (name ? name : ""), ((ext && *ext && (*ext != '.')) ? "." : ""), (ext ? ext : ""));
+}
+inline void _makepath_s(char *path, size_t, const char *drive, const char *dir, const char *name, const char *ext) { _makepath(path, drive, dir, name, ext); }
+
+// Time
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency) { frequency->QuadPart = 1000000000LL; return TRUE; }
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER *counter)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	counter->QuadPart = (((LONGLONG) ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+	return TRUE;
+}
+inline ULONGLONG GetTickCount64()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (((ULONGLONG) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+inline void Sleep(DWORD ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// Threads and locks
+struct CRITICAL_SECTION { pthread_mutex_t mutex; };
+inline BOOL InitializeCriticalSectionAndSpinCount(CRITICAL_SECTION *cs, DWORD) { pthread_mutex_init(&cs->mutex, NULL); return TRUE; }
+inline void DeleteCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_destroy(&cs->mutex); }
+inline void EnterCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_lock(&cs->mutex); }
+inline void LeaveCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_unlock(&cs->mutex); }
+inline DWORD GetCurrentThreadId() { return (DWORD) pthread_self(); }
+
+// Error strings and debug output
+#define FORMAT_MESSAGE_FROM_SYSTEM    0x1000
+#define FORMAT_MESSAGE_IGNORE_INSERTS 0x0200
+#define LANG_NEUTRAL    0
+#define SUBLANG_DEFAULT 1
+#define MAKELANGID(_p, _s) ((((WORD) (_s)) << 10) | (WORD) (_p))
+inline DWORD FormatMessageA(DWORD, LPCVOID, DWORD, DWORD, LPSTR, DWORD, va_list *) { return 0; }
+inline DWORD GetLastError() { return 0; }
+inline void OutputDebugStringA(LPCSTR) {}
+
+// Clipboard, not available
+#define CF_TEXT 1
+#define GMEM_MOVEABLE 2
+inline BOOL OpenClipboard(HWND) { return FALSE; }
+inline BOOL EmptyClipboard() { return FALSE; }
+inline BOOL CloseClipboard() { return TRUE; }
+inline HANDLE SetClipboardData(UINT, HANDLE) { return NULL; }
+inline HGLOBAL GlobalAlloc(UINT, SIZE_T) { return NULL; }
+inline LPVOID GlobalLock(HGLOBAL) { return NULL; }
+inline BOOL GlobalUnlock(HGLOBAL) { return FALSE; }